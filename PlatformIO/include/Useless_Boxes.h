@@ -3,23 +3,53 @@
 
 // ------------------------------------------------------------------
 // Hardware pin mappings — supplied by include/board_pins.h
-// Select the active mapping by setting a build flag (e.g. -DBOARD_MICHAEL)
+// Select the board by setting a build flag (e.g. -DBOARD_ID=MICHAEL, see boards.def)
 // or by providing your own `include/board_pins.h` in the project.
 // ------------------------------------------------------------------
 #include "board_pins.h"
+#include "peer_registry.h"
+#include "claim_clock.h"
+#include "motion_profile.h"
 
 // ------------------------------------------------------------------
 // Configurable defaults (change these compile-time defaults to tune
 // product defaults; runtime values are initialized from these)
 // ------------------------------------------------------------------
 constexpr unsigned long DEFAULT_LONG_PRESS_TIME = 500;   // ms  // Adjustable
-constexpr unsigned long DEFAULT_DEBOUNCE_TIME   = 50;     // ms  // Adjustable
+constexpr unsigned long DEFAULT_DEBOUNCE_TIME   = 50;     // ms  // Adjustable (settings button)
+constexpr unsigned long SWITCH_DEBOUNCE_TIME    = 5;      // ms  // Adjustable (switch + limit)
 constexpr unsigned long DEFAULT_MENU_TIMEOUT_MS = 10000; // ms  // Adjustable
 constexpr unsigned long DEFAULT_MOTOR_UPDATE_INTERVAL = 1; // ms // Adjustable
 constexpr int RGB_UPDATE_INTERVAL = 20; // ms // Adjustable
 
 constexpr int DEFAULT_RGB_BRIGHTNESS_PERCENTAGE = 100; // % // Setting
 
+// ------------------------------------------------------------------
+// Motor PWM backend
+// EN1 is driven by the ESP32 LEDC peripheral by default, so the carrier
+// runs in hardware with no CPU time per cycle. Build with -DMOTOR_SOFT_PWM
+// to fall back to the bit-banged cycle for boards without a free channel.
+// ------------------------------------------------------------------
+#if !defined(MOTOR_SOFT_PWM)
+  #ifndef MOTOR_PWM_FREQUENCY_HZ
+    #define MOTOR_PWM_FREQUENCY_HZ 20000  // keep above audible range
+  #endif
+  #ifndef MOTOR_PWM_RESOLUTION_BITS
+    #define MOTOR_PWM_RESOLUTION_BITS 10
+  #endif
+constexpr uint32_t MOTOR_PWM_FREQUENCY  = MOTOR_PWM_FREQUENCY_HZ;    // Hz   // Adjustable
+constexpr uint8_t  MOTOR_PWM_RESOLUTION = MOTOR_PWM_RESOLUTION_BITS; // bits // Adjustable
+constexpr uint32_t MOTOR_PWM_MAX_DUTY   = (1UL << MOTOR_PWM_RESOLUTION) - 1;
+// LEDC channel map: the buzzer uses channel 0 (timer 0) and analogWrite()
+// allocates from channel 7 downwards, so channel 2 keeps timer 1 to itself.
+constexpr uint8_t  MOTOR_LEDC_CHANNEL   = 2;
+
+static_assert(MOTOR_PWM_RESOLUTION >= 10 && MOTOR_PWM_RESOLUTION <= 12,
+              "Motor PWM resolution must be 10-12 bits");
+static_assert(MOTOR_PWM_FREQUENCY <= (80000000UL >> MOTOR_PWM_RESOLUTION),
+              "Motor PWM frequency too high for the selected resolution (80 MHz APB clock)");
+#endif
+
 // ------------------------------------------------------------------
 // Runtime-configurable settings (modifiable during development)
 // Use the setters below to ensure side-effects are applied.
@@ -36,18 +66,39 @@ void setMenuTimeout(unsigned long ms);
 void setMotorUpdateInterval(unsigned long ms);
 
 
-// Menu structure
+// Menu structure: one constexpr descriptor per setting, driven by a
+// single show/adjust/confirm implementation (see menuItems[]).
 struct MenuItem {
-  const char* name;
-  void (*onShow)();
-  void (*onAdjust)();
-  void (*onConfirm)();
+  const char* name;                 // "> Setting n: <name>"
+  const char* label;                // "<label>: <value>" while showing
+  int* value;                       // the setting itself
+  int16_t min, max, step;           // adjust: value + step, past max wraps to min
+  const char* unit;                 // printed after a number ("%"); "" for none
+  const char* (*names)(int value);  // value -> name, or nullptr to print the number
+  void (*set)(int value);           // validating setter (marks the settings dirty)
+  void (*onShow)(int value);        // live preview while shown; may be nullptr
+  void (*onAdjust)(int value);      // feedback after a change (beep/demo); may be nullptr
+  void (*onConfirm)();              // after a long-press save; may be nullptr
 };
-extern MenuItem menuItems[];
+extern const MenuItem menuItems[];
+extern const int totalMenus;
 
 // Menu handlers
 void handleSerialMenu();
 void showMenu();
+void showMenuValue(const MenuItem& item);
+size_t formatMenu(char* out, size_t size);  // every setting as one JSON object
+
+// Line-based commands typed into the serial monitor (e.g. "help")
+struct SerialCommand {
+  const char* name;
+  const char* help;
+  void (*handler)(const char* args);  // args = text after the first space
+};
+extern const SerialCommand serialCommands[];
+constexpr size_t SERIAL_COMMAND_MAX_LEN = 128; // fits a "buzz" pattern of ~8 steps
+
+void handleSerialCommands();
 
 // ===== RGB LED CONTROL =====
 enum RGBMode {
@@ -69,7 +120,26 @@ extern int breathValue;
 extern int breathDir;
 
 void updateRGBModeFromBoxState();
+const char* rgbModeLabel(int mode);   // "RAINBOW", ...; "UNKNOWN" out of range
 void setRGB(uint8_t r, uint8_t g, uint8_t b);
+void rebuildRGBDutyTable(); // call after rgb_brightness_percentage changes
+
+// Hardware fades (-DRGB_HW_FADE): breathing and active/inactive colour
+// changes are programmed into the LEDC fade engine (ledc_set_fade_with_time)
+// so the CPU only steps in at fade endpoints.
+#if defined(RGB_HW_FADE)
+constexpr uint8_t  RGB_LEDC_CHANNEL_R = 5;     // timer 2 (channel 4 left unused)
+constexpr uint8_t  RGB_LEDC_CHANNEL_G = 6;     // timer 3
+constexpr uint8_t  RGB_LEDC_CHANNEL_B = 7;     // timer 3
+constexpr uint32_t RGB_PWM_FREQUENCY  = 1000;  // Hz (matches analogWrite())
+constexpr uint32_t RGB_CROSSFADE_MS   = 300;   // ms // Adjustable
+constexpr uint32_t RGB_BREATH_SEGMENT_MS = 490; // ms per fade segment // Adjustable
+constexpr int      RGB_BREATH_SEGMENT_STEP = 49; // 5 segments per 5..250 ramp (~2.45 s, as before)
+constexpr unsigned long RGB_FADE_TIMEOUT_MS = 100; // ms grace past the expected fade end
+
+bool rgbFadeBusy();
+void fadeRGBTo(uint8_t r, uint8_t g, uint8_t b, uint32_t ms);
+#endif
 void applyRGBMode();
 void updateAnimations();
 
@@ -80,18 +150,72 @@ enum BuzzerPattern {
   BUZZER_CHIRP,
   BUZZER_LOOP,
   BUZZER_SOS,
+  BUZZER_CUSTOM,        // user-defined steps pushed via `buzzer_pattern` / "buzz"
   BUZZER_PATTERN_COUNT
 };
 
 extern int currentBuzzerPattern;    // playback state for active buzzer pattern (played by presets)
-extern bool buzzerState;           // internal on/off used by loops
-extern unsigned long buzzerLast;   // last toggle time
+extern bool buzzerState;           // current step is in its on-phase
+extern unsigned long buzzerLast;   // start of the current phase
 extern unsigned int buzzerStep;    // step in sequence
 
 constexpr unsigned long BUZZER_INTERVAL = 250; // ms
 
+// One buzzer step: a tone followed by silence. Used both by the patterns
+// below and by the one-shot tone queue.
+struct BuzzerTone {
+  uint16_t freq;        // Hz (0 = silent step)
+  uint16_t duration_ms; // tone on-time
+  uint16_t pause_ms;    // silence after the tone
+};
+
+// Patterns are data: updateBuzzerAlarm() walks the step list with a single
+// deadline compare per call. A new pattern needs an enum entry and a row in
+// BUZZER_PATTERNS[] (Useless_Boxes.cpp), nothing else.
+struct BuzzerPatternDef {
+  const char* name;
+  const BuzzerTone* steps;
+  uint8_t count;
+  bool loop;            // restart at step 0 instead of stopping
+};
+constexpr uint8_t BUZZER_CUSTOM_MAX_STEPS = 16;
+
+const char* buzzerPatternName(int pattern);
+// "[loop ]freq:on:off[,freq:on:off...]" — empty clears. Safe from any task;
+// the control task picks the new steps up on its next pass.
+bool setCustomBuzzerPattern(const char* spec);
+extern String buzzer_pattern;       // cloud copy of the custom pattern spec
+void onBuzzerPatternChange();       // cloud callback (network task)
+
+// ------------------------------------------------------------------
+// Buzzer output backend
+// BUZZER_PIN stays attached to its own LEDC channel; a step only retunes
+// the timer and sets the duty, and nothing touches the peripheral while
+// the output is unchanged. Volume is the duty cycle (50% = loudest).
+// Build with -DBUZZER_TONE_API to fall back to tone()/noTone() (no volume).
+// ------------------------------------------------------------------
+constexpr int DEFAULT_BUZZER_VOLUME = 100; // % // Setting
+#if !defined(BUZZER_TONE_API)
+constexpr uint8_t  BUZZER_LEDC_CHANNEL   = 0;    // timer 0, shared with channel 1 (unused)
+constexpr uint8_t  BUZZER_PWM_RESOLUTION = 10;   // bits
+constexpr uint32_t BUZZER_MAX_DUTY       = 1UL << (BUZZER_PWM_RESOLUTION - 1); // 50%
+constexpr uint32_t BUZZER_DEFAULT_FREQUENCY = 1000; // Hz, until the first step retunes it
+uint32_t buzzerDutyForVolume(int percent);
+#endif
+void refreshBuzzerVolume();  // re-apply duty after a volume change
+
+// Queued one-shot tones (menu feedback beeps). Drained by updateBuzzerAlarm()
+// without blocking; while the queue is playing it pre-empts the active pattern.
+constexpr uint8_t BUZZER_QUEUE_CAPACITY = 32; // entries (power of two)
+static_assert((BUZZER_QUEUE_CAPACITY & (BUZZER_QUEUE_CAPACITY - 1)) == 0,
+              "BUZZER_QUEUE_CAPACITY must be a power of two");
+
+bool enqueueBuzzerTone(uint16_t freq, uint16_t duration_ms, uint16_t pause_ms); // false when full
+void clearBuzzerQueue();
+bool buzzerQueueBusy();
+
 void stopBuzzer();
-void beepBuzzer(int quantity, int duration_ms=100, int pause_ms=100, int toneFreq=1000);
+void beepBuzzer(int quantity, int duration_ms=100, int pause_ms=100, int toneFreq=1000); // enqueues, never blocks
 void updateBuzzerAlarm();
 void triggerBuzzerPattern(int pattern);
 void demoBuzzerPattern(int pattern);
@@ -104,6 +228,7 @@ extern int rgb_brightness_percentage;
 extern int activeBuzzerSetting;   // buzzer pattern to play when active
 extern int inactiveBuzzerSetting; // buzzer pattern to play when inactive
 extern int motorSpeed; // Motor speed control (0-100%)
+extern int buzzerVolume; // Buzzer volume (0-100%)
 
 // Setter APIs for Active/Inactive presets
 void setActiveRGBSetting(int mode);
@@ -112,46 +237,214 @@ void setRGBBrightness(int percent);
 void setActiveBuzzerSetting(int pattern);
 void setInactiveBuzzerSetting(int pattern);
 void setMotorSpeed(int speed);
+void setBuzzerVolume(int percent);
 
-// Menu handlers for Active/Inactive presets
-void showActiveRGB();
-void adjustActiveRGB();
-void confirmActiveRGB();
+// Settings cache: setters mark it dirty, commitSettings() writes one blob
+constexpr unsigned long SETTINGS_COMMIT_DELAY_MS = 5000; // ms — idle time before an unconfirmed change is saved // Adjustable
+void commitSettings();                      // write now if anything changed
+void serviceSettingsCommit(unsigned long now);
+void scheduleSettingsWake();
 
-void showInactiveRGB();
-void adjustInactiveRGB();
-void confirmInactiveRGB();
-
-void showRGBBrightness();
-void adjustRGBBrightness();
-void confirmRGBBrightness();
+// ===== SETTINGS BUTTON HANDLER =====
+void handleSettingsButton();   // consumes INPUT_BUTTON events
 
-void showActiveBuzzerSetting();
-void adjustActiveBuzzerSetting();
-void confirmActiveBuzzerSetting();
+void handleSwitchDetection();  // consumes INPUT_SWITCH / INPUT_LIMIT events
 
-void showInactiveBuzzerSetting();
-void adjustInactiveBuzzerSetting();
-void confirmInactiveBuzzerSetting();
+// ===== INPUT EVENTS =====
+// Every digital input's edges are captured by GPIO interrupts into one
+// timestamped raw ring. For SWITCH_PIN and LIMIT_PIN the ISR also cuts EN1
+// straight away when the edge ends the current stroke. serviceInputs()
+// debounces each pin (input_debounce.h: DEBOUNCE_TIME for the button,
+// SWITCH_DEBOUNCE_TIME for the contacts) and queues one InputEvent per
+// settled level change; the button, switch and motor logic read those
+// instead of GPIO, so contact bounce never reaches modifyMotorState(),
+// setActiveBox() or the cloud.
+struct InputEdgeEvent {
+  uint8_t pin;           // SWITCH_PIN, LIMIT_PIN or BUTTON_PIN
+  uint8_t level;         // pin level sampled in the ISR
+  bool motorCut;         // ISR dropped EN1 for this edge
+  uint32_t timestamp_us; // esp_timer_get_time() at the edge
+};
+constexpr uint8_t INPUT_EDGE_QUEUE_CAPACITY = 32; // entries (power of two)
+static_assert((INPUT_EDGE_QUEUE_CAPACITY & (INPUT_EDGE_QUEUE_CAPACITY - 1)) == 0,
+              "INPUT_EDGE_QUEUE_CAPACITY must be a power of two");
 
-void showMotorSpeed();
-void adjustMotorSpeed();
-void confirmMotorSpeed();
+enum InputChannel {
+  INPUT_BUTTON,
+  INPUT_SWITCH,
+  INPUT_LIMIT,
+  INPUT_CHANNEL_COUNT
+};
 
-// ===== SETTINGS BUTTON HANDLER =====
-void handleSettingsButton();
+struct InputEvent {
+  uint8_t level;         // settled level
+  uint32_t timestamp_us; // first edge of the burst that settled
+};
+constexpr uint8_t INPUT_EVENT_QUEUE_CAPACITY = 4; // settled changes per channel (power of two)
+static_assert((INPUT_EVENT_QUEUE_CAPACITY & (INPUT_EVENT_QUEUE_CAPACITY - 1)) == 0,
+              "INPUT_EVENT_QUEUE_CAPACITY must be a power of two");
 
-void handleSwitchDetection();
+void setupInputInterrupts();
+bool popInputEdge(InputEdgeEvent& event);                    // raw ISR edges
+void serviceInputs();                                        // control task: debounce raw edges
+bool popInputEvent(InputChannel channel, InputEvent& event); // settled changes, oldest first
+int inputLevel(InputChannel channel);                        // debounced level
+uint32_t inputBouncesFiltered(InputChannel channel);         // raw edges that changed nothing
+void scheduleInputWake();
+#if defined(SOAK_TEST) || defined(LATENCY_BENCH)
+// Virtual switch/limit (soak_test.h, latency_bench.h): while taken, their ISRs
+// are detached and injected levels go through the same ring, cutoff and debounce
+void takeVirtualInputs(bool take);                           // false: back to the pins
+void injectInputLevel(InputChannel channel, uint8_t level);  // control task
+#endif
 
 // ===== MOTOR PWM CONTROL =====
 void modifyMotorState(bool switchState, bool buttonState);
 void updateMotorPWM();
+void rearmMotorEnable(); // reconnect EN1 after an ISR cutoff
+#if !defined(MOTOR_SOFT_PWM)
+uint32_t motorDutyForSpeed(int speed); // motorSpeed (0-100%) -> LEDC duty
+
+// Strokes follow motionProfile (ramps, brake before reversing, slow
+// approach); see motion_profile.h. Soft PWM builds keep the flat drive.
+extern MotionProfile motionProfile;
+void startMotion(int direction);          // 1 forward, -1 reverse, 0 stop
+void noteStrokeEnd(uint32_t timestampUs); // ISR-ended stroke: learn its duration
+#endif
+
+// ===== STROKE TIMING / STALL DETECTION =====
+// Each stroke is timed from modifyMotorState() to the ISR edge that ends it.
+// Per-direction mean/variance (stroke_stats.h) set the stall timeout: a
+// stroke running past it has EN1 cut and latches a fault until the next
+// switch/limit/claim change. Stats are saved to NVS every
+// STROKE_STATS_SAVE_INTERVAL_MS while they change and published as the
+// `motor_stats` cloud String.
+constexpr uint32_t STROKE_STALL_DEFAULT_MS = 3000;  // ms — until STROKE_STALL_MIN_SAMPLES strokes are learned // Adjustable
+constexpr uint32_t STROKE_STALL_MIN_MS = 1000;      // ms — floor for a learned timeout // Adjustable
+constexpr uint32_t STROKE_STALL_MAX_MS = 5000;      // ms — ceiling for a learned timeout // Adjustable
+constexpr uint8_t STROKE_STALL_MIN_SAMPLES = 5;
+constexpr float STROKE_STALL_SIGMAS = 4.0f;         // timeout = mean + max(4 sd, mean / 2)
+constexpr unsigned long STROKE_STATS_SAVE_INTERVAL_MS = 600000; // ms — 10 min // Adjustable
+
+uint32_t strokeStallTimeoutMs(int direction);  // 1 forward, -1 reverse
+bool motorStallFault();                        // latched since the last stall
+void serviceStrokeWatchdog(unsigned long now); // stall check + periodic save
+void scheduleStrokeWake();
+void saveStrokeStats();                        // write now if anything changed
+void loadStrokeStats();                        // setup(), after prefs.begin()
+void publishStrokeTelemetry();                 // network task
+extern String motor_stats;                     // cloud copy of the stroke stats (read-only)
+constexpr size_t STROKE_STATS_SUMMARY_MAX_LEN = 128; // bytes of the `motor_stats` summary
+
+
 
+// ===== TASKS =====
+// The real-time control loop (button, switch, motor, RGB, buzzer, menu)
+// runs in its own task pinned to the application core; ArduinoCloud.update()
+// runs in a separate network task on the core that hosts the Wi-Fi stack,
+// so network stalls never delay motor handling.
+constexpr int      CONTROL_TASK_CORE       = 1;
+constexpr unsigned CONTROL_TASK_PRIORITY   = 5;
+constexpr uint32_t CONTROL_TASK_STACK      = 8192; // bytes
+constexpr int      NETWORK_TASK_CORE       = 0;
+constexpr unsigned NETWORK_TASK_PRIORITY   = 2;
+constexpr uint32_t NETWORK_TASK_STACK      = 8192; // bytes
+constexpr unsigned long NETWORK_TASK_INTERVAL_MS = 5; // ms // Adjustable
 
+void controlLoop();      // one pass of the control loop (control task)
+void onCloudConnect();   // ArduinoCloud CONNECT callback (network task)
+void networkLoop();      // one pass of the cloud loop (network task)
+
+// ===== DEADLINE SCHEDULER =====
+// Instead of spinning, the control task sleeps until the earliest registered
+// subsystem deadline or until a GPIO edge / cloud change notifies it.
+// Subsystems re-register (or clear) their next due time after every pass.
+enum ScheduledSubsystem {
+  SCHED_INPUT,       // debounce settle of any input
+  SCHED_BUTTON,      // long-press threshold
+  SCHED_MOTOR,       // soft-PWM phase flip or pending duty write
+  SCHED_ANIMATIONS,  // next RGB frame or fade endpoint
+  SCHED_BUZZER,      // next tone step / demo end
+  SCHED_SETTINGS,    // deferred NVS commit
+  SCHED_STROKE,      // stall timeout / stroke stats save
+#if defined(LATENCY_BENCH)
+  SCHED_BENCH,       // next automated bench cycle
+#endif
+#if defined(SOAK_TEST)
+  SCHED_SOAK,        // next soak cycle step
+#endif
+  SCHED_SUBSYSTEM_COUNT
+};
+constexpr unsigned long SCHEDULER_MAX_SLEEP_MS = 50; // ms — serial input poll ceiling // Adjustable
+
+void scheduleWake(ScheduledSubsystem subsystem, unsigned long dueMs);
+void clearWake(ScheduledSubsystem subsystem);
+TickType_t ticksUntilNextWake();
+void wakeControlTask();          // task context (e.g. cloud callback)
+void wakeControlTaskFromISR();   // interrupt context
+
+void scheduleButtonWake();
+void scheduleMotorWake();
+void scheduleAnimationWake();
+void scheduleBuzzerWake();
+
+// ===== LIGHT-SLEEP IDLE =====
+// -DLIGHT_SLEEP_IDLE: automatic light sleep + Wi-Fi modem sleep while the
+// motor is stopped, the buzzer is off and the RGB mode is static. SWITCH,
+// LIMIT and BUTTON edges wake the chip; cloud traffic wakes it through the
+// Wi-Fi driver. Note: USB serial does not survive light sleep.
+#if defined(LIGHT_SLEEP_IDLE)
+constexpr unsigned long LIGHT_SLEEP_MAX_SLEEP_MS = 1000;      // ms — control task ceiling when idle
+constexpr unsigned long NETWORK_TASK_IDLE_INTERVAL_MS = 100;  // ms — cloud poll interval when idle // Adjustable
+
+void setupPowerManagement();
+bool controlIsIdle();
+void updatePowerState();
+void noteWakeEvent(uint32_t timestampUs);
+void noteMotorStartForWake();
+#endif
 
 // ===== ACTIVE BOX =====
+// `active_box` (and its `active_stamp`) is owned by the network task and
+// is the only place box names appear. The control task works on a BoxId/BoxMask copy: cloud
+// changes arrive as ActiveBoxEvents on a queue, and local claims are
+// handed to the network task through setActiveBox(), which publishes
+// them through a PublishCoalescer (publish_coalescer.h). Claims are
+// Lamport-stamped (claim_clock.h): an event only takes effect if its stamp
+// is newer than the held claim, and a stale cloud value gets ours written
+// back, so flips made offline survive the reconnect sync.
+constexpr unsigned ACTIVE_BOX_QUEUE_DEPTH = 8;
+constexpr unsigned long ACTIVE_BOX_PUBLISH_WINDOW_MS = 500; // ms — at most one `active_box` write per window // Adjustable
+
+enum ActiveBoxSource : uint8_t {
+  ACTIVE_SOURCE_CLOUD,    // `active_stamp` / `active_box` property update
+  ACTIVE_SOURCE_LINK      // direct ESP-NOW announcement (-DPEER_LINK_ESPNOW)
+};
+
+struct ActiveBoxEvent {
+  BoxId box;
+  ClaimStamp stamp;       // lamport 0: bare name
+  bool fresh;             // bare name unlike the last one delivered: stamped on arrival as a new claim
+  ActiveBoxSource source;
+  uint32_t received_us;   // esp_timer_get_time() when it was delivered
+};
+
+extern String active_stamp;
 extern String active_box;
 
-void setActiveBox(String box);
-void onActiveBoxChange();
+void loadClaimClock();              // setup(), after prefs.begin()
+void setActiveBox(BoxId box);       // control task -> cloud
+void onActiveStampChange();         // cloud callback (network task)
+void onActiveBoxChange();            // cloud callback (network task)
+#if defined(PEER_LINK_ESPNOW)
+void onPeerLinkActive(BoxId box, ClaimStamp stamp, uint32_t receivedUs); // peer link (Wi-Fi task)
+#endif
+void processActiveBoxEvents();      // drains cloud changes (control task)
+#if defined(SOAK_TEST)
+void postSimulatedClaim(BoxId box);  // soak test: a peer's claim, as if from the cloud
+void restoreActiveClaim(BoxId box, ClaimStamp stamp); // soak test: the claim held before the run
+#endif
+bool isThisBoxActive();
+BoxId currentActiveBox();
+ClaimStamp currentActiveStamp();    // stamp of the claim currently held
 #endif // USELESS_BOXES_H
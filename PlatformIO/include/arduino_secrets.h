@@ -1,11 +1,22 @@
 #pragma once
 // Wrapper header: selects device-specific arduino_secrets file based on build flags
-// Uses the same BOARD_PINS_* build flags that select the board pin mappings.
+// Uses the same build flags that select the board descriptor (board_pins.h).
 
 #ifndef ARDUINO_SECRETS_H
     #define ARDUINO_SECRETS_H
 
-    #if defined(BOARD_TREVOR)
+    #if defined(BOARD_GENERIC)
+        // No per-box file: pass SECRET_SSID, SECRET_OPTIONAL_PASS,
+        // SECRET_DEVICE_ID and SECRET_DEVICE_KEY as build flags
+        // (e.g. from ${sysenv.*} in platformio.ini).
+        #if !defined(SECRET_SSID) || !defined(SECRET_OPTIONAL_PASS) || \
+            !defined(SECRET_DEVICE_ID) || !defined(SECRET_DEVICE_KEY)
+            #error "BOARD_GENERIC needs SECRET_SSID, SECRET_OPTIONAL_PASS, SECRET_DEVICE_ID and SECRET_DEVICE_KEY build flags"
+        #endif
+    #elif defined(BOARD_SECRETS_HEADER)
+        // Set per row by the generated envs (scripts/gen_board_envs.py)
+        #include BOARD_SECRETS_HEADER
+    #elif defined(BOARD_TREVOR)
         #include "arduino_secrets_trevor.h"
     #elif defined(BOARD_MICHAEL)
         #include "arduino_secrets_michael.h"
@@ -0,0 +1,84 @@
+#pragma once
+// board_config.h — compile-time board descriptor: pins + optional features
+#ifndef BOARD_CONFIG_H
+#define BOARD_CONFIG_H
+
+#include <stdint.h>
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
+
+// ------------------------------------------------------------------
+// A board is a BoardConfig<Pins, Features> type, built from a row of
+// boards.def (or from -DPIN_* flags for BOARD_GENERIC). Everything is a
+// constant expression: pin numbers become immediates, a disabled feature's
+// driver code is dropped as dead code, and FastOutput<> writes straight to
+// the GPIO set/clear registers with the GPIO number resolved at compile
+// time instead of digitalWrite()'s per-call pin lookup.
+// ------------------------------------------------------------------
+
+#if defined(BOARD_HAS_PIN_REMAP)
+// Arduino Nano ESP32 "by Arduino pin" numbering: D0..D13 -> GPIO
+constexpr uint8_t NANO_ESP32_D_PIN_GPIO[14] = { 44, 43, 5, 6, 7, 8, 9, 10, 17, 18, 21, 38, 47, 48 };
+constexpr uint8_t BOARD_GPIO_UNMAPPED = 0xFF;
+constexpr uint8_t boardGpio(int pin) {
+  return (pin >= 0 && pin < 14) ? NANO_ESP32_D_PIN_GPIO[pin] : BOARD_GPIO_UNMAPPED;
+}
+#else
+constexpr uint8_t boardGpio(int pin) { return (uint8_t)pin; }
+#endif
+
+template <int En1, int In1, int In2, int RgbR, int RgbG, int RgbB,
+          int Switch, int Limit, int Button, int Buzzer>
+struct BoardPins {
+  static constexpr int EN1 = En1;           // Motor enable (PWM capable)
+  static constexpr int IN1 = In1;           // Motor direction A
+  static constexpr int IN2 = In2;           // Motor direction B
+  static constexpr int RGB_R = RgbR;        // LED Red
+  static constexpr int RGB_G = RgbG;        // LED Green
+  static constexpr int RGB_B = RgbB;        // LED Blue
+  static constexpr int SWITCH = Switch;     // SPDT switch
+  static constexpr int LIMIT = Limit;       // Limit Switch
+  static constexpr int BUTTON = Button;     // Settings button
+  static constexpr int BUZZER = Buzzer;     // Buzzer
+};
+
+template <bool Rgb, bool Buzzer>
+struct BoardFeatures {
+  static constexpr bool RGB = Rgb;          // RGB LED fitted
+  static constexpr bool BUZZER = Buzzer;    // buzzer fitted
+};
+
+template <class PinsT, class FeaturesT>
+struct BoardConfig {
+  typedef PinsT Pins;
+  typedef FeaturesT Features;
+#if defined(BOARD_HAS_PIN_REMAP)
+  static_assert(boardGpio(PinsT::EN1) != BOARD_GPIO_UNMAPPED && boardGpio(PinsT::IN1) != BOARD_GPIO_UNMAPPED &&
+                boardGpio(PinsT::IN2) != BOARD_GPIO_UNMAPPED && boardGpio(PinsT::SWITCH) != BOARD_GPIO_UNMAPPED &&
+                boardGpio(PinsT::LIMIT) != BOARD_GPIO_UNMAPPED && boardGpio(PinsT::BUTTON) != BOARD_GPIO_UNMAPPED,
+                "board pins must be D0..D13 with Arduino pin numbering");
+#endif
+};
+
+// GPIO output with the register and bit fixed at compile time. The pin
+// must already be a plain GPIO output (pinMode(pin, OUTPUT)).
+template <int Pin>
+struct FastOutput {
+  static constexpr uint8_t GPIO_NUM = boardGpio(Pin);
+  static constexpr uint32_t MASK = 1UL << (GPIO_NUM & 31);
+
+  static inline void high() {
+    if (GPIO_NUM < 32) REG_WRITE(GPIO_OUT_W1TS_REG, MASK);
+    else REG_WRITE(GPIO_OUT1_W1TS_REG, MASK);
+  }
+  static inline void low() {
+    if (GPIO_NUM < 32) REG_WRITE(GPIO_OUT_W1TC_REG, MASK);
+    else REG_WRITE(GPIO_OUT1_W1TC_REG, MASK);
+  }
+  static inline void write(bool level) {
+    if (level) high();
+    else low();
+  }
+};
+
+#endif // BOARD_CONFIG_H
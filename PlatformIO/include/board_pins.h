@@ -1,17 +1,51 @@
 #pragma once
-// board_pins.h — include one of the per-board mappings via build flags
-// Usage: add -DBOARD_PINS_MICHAEL or -DBOARD_PINS_TREVOR to build_flags in platformio.ini
+// board_pins.h — select this build's board descriptor via build flags
+// Usage: -DBOARD_ID=<row in boards.def>; -DBOARD_MICHAEL / -DBOARD_TREVOR still work
+// Other boxes: -DBOARD_GENERIC -DBOX_NAME=\"<name>\" (see board_pins_generic.h)
 
 #ifndef BOARD_PINS_H
     #define BOARD_PINS_H
 
-    #if defined(BOARD_MICHAEL)
-        #include "board_pins_michael.h"
-    #elif defined(BOARD_TREVOR)
-        #include "board_pins_trevor.h"
+    #include "board_config.h"
+
+    #define BOARD_STRINGIFY_(x) #x
+    #define BOARD_STRINGIFY(x) BOARD_STRINGIFY_(x)
+    #define BOARD_CONCAT_(a, b) a##b
+    #define BOARD_CONCAT(a, b) BOARD_CONCAT_(a, b)
+
+    #if defined(BOARD_GENERIC)
+        #include "board_pins_generic.h"
     #else
-        // Default to MICHAEL if no build flag provided
-        #include "board_pins_michael.h"
+        #if !defined(BOARD_ID)
+            #if defined(BOARD_TREVOR)
+                #define BOARD_ID TREVOR
+            #else
+                // BOARD_MICHAEL, or no build flag at all
+                #define BOARD_ID MICHAEL
+            #endif
+        #endif
+
+        // Every row becomes a BoardConfig type named Board_<ID>
+        #define BOARD(id, en1, in1, in2, r, g, b, sw, limit, button, buzzer, hasRgb, hasBuzzer) \
+            typedef BoardConfig<BoardPins<en1, in1, in2, r, g, b, sw, limit, button, buzzer>,      \
+                                BoardFeatures<hasRgb, hasBuzzer> > Board_##id;
+        #include "boards.def"
+        #undef BOARD
+
+        typedef BOARD_CONCAT(Board_, BOARD_ID) Board;
+        #define BOX_NAME BOARD_STRINGIFY(BOARD_ID)
     #endif
 
+    // Short names used throughout the firmware
+    constexpr int EN1 = Board::Pins::EN1;
+    constexpr int IN1 = Board::Pins::IN1;
+    constexpr int IN2 = Board::Pins::IN2;
+    constexpr int RGB_R = Board::Pins::RGB_R;
+    constexpr int RGB_G = Board::Pins::RGB_G;
+    constexpr int RGB_B = Board::Pins::RGB_B;
+    constexpr int SWITCH_PIN = Board::Pins::SWITCH;
+    constexpr int LIMIT_PIN = Board::Pins::LIMIT;
+    constexpr int BUTTON_PIN = Board::Pins::BUTTON;
+    constexpr int BUZZER_PIN = Board::Pins::BUZZER;
+
 #endif // BOARD_PINS_H
@@ -0,0 +1,59 @@
+#pragma once
+// Pin mappings for any additional box built on the standard wiring
+#ifndef BOARD_PINS_GENERIC_H
+    #define BOARD_PINS_GENERIC_H
+
+    // Box name comes from the build flags, e.g. -DBOX_NAME=\"ALICE\"
+    #ifndef BOX_NAME
+        #error "BOARD_GENERIC requires a BOX_NAME build flag"
+    #endif
+
+    // Defaults follow the MICHAEL wiring; override any pin with -DPIN_<NAME>=<n>
+    #ifndef PIN_EN1
+        #define PIN_EN1 2
+    #endif
+    #ifndef PIN_IN1
+        #define PIN_IN1 3
+    #endif
+    #ifndef PIN_IN2
+        #define PIN_IN2 4
+    #endif
+    #ifndef PIN_RGB_R
+        #define PIN_RGB_R 6
+    #endif
+    #ifndef PIN_RGB_G
+        #define PIN_RGB_G 7
+    #endif
+    #ifndef PIN_RGB_B
+        #define PIN_RGB_B 5
+    #endif
+    #ifndef PIN_SWITCH
+        #define PIN_SWITCH 8
+    #endif
+    #ifndef PIN_LIMIT
+        #define PIN_LIMIT 9
+    #endif
+    #ifndef PIN_BUTTON
+        #define PIN_BUTTON 10
+    #endif
+    #ifndef PIN_BUZZER
+        #define PIN_BUZZER 11
+    #endif
+
+    // Optional parts: -DBOARD_NO_RGB / -DBOARD_NO_BUZZER compile their drivers out
+    #if defined(BOARD_NO_RGB)
+        #define BOARD_GENERIC_RGB false
+    #else
+        #define BOARD_GENERIC_RGB true
+    #endif
+    #if defined(BOARD_NO_BUZZER)
+        #define BOARD_GENERIC_BUZZER false
+    #else
+        #define BOARD_GENERIC_BUZZER true
+    #endif
+
+    typedef BoardConfig<BoardPins<PIN_EN1, PIN_IN1, PIN_IN2, PIN_RGB_R, PIN_RGB_G, PIN_RGB_B,
+                                  PIN_SWITCH, PIN_LIMIT, PIN_BUTTON, PIN_BUZZER>,
+                        BoardFeatures<BOARD_GENERIC_RGB, BOARD_GENERIC_BUZZER> > Board;
+
+#endif // BOARD_PINS_GENERIC_H
@@ -0,0 +1,72 @@
+#pragma once
+// claim_clock.h — Lamport-stamped `active_box` claims (`active_stamp`)
+#ifndef CLAIM_CLOCK_H
+#define CLAIM_CLOCK_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "peer_registry.h"
+
+// ------------------------------------------------------------------
+// Every claim carries a Lamport stamp. The stamp holds the claiming box's
+// clock and that box's name, which breaks ties. A box bumps its clock for
+// each local claim and moves it past every stamp it receives. A box
+// applies a claim only if its stamp is newer than the one it holds, so
+// all boxes settle on the same claim whatever order the copies arrive in:
+// link before cloud, a late cloud echo, or a cloud sync replaying an old
+// value over flips made while offline. A box that sees the cloud holding
+// an older claim than its own writes its claim back, so the cloud
+// converges too.
+//
+// The stamp travels in `active_stamp` as "<active>@<lamport>:<origin>",
+// e.g. "TREVOR@42:TREVOR" or "NONE@43:MICHAEL" (MICHAEL released), while
+// `active_box` keeps the bare name older firmware understands. A bare
+// name with no stamp (typed on the dashboard, older firmware) is taken as
+// a fresh claim when it differs from the last bare value delivered, and
+// as unstamped (never newer) when it repeats it.
+// ------------------------------------------------------------------
+constexpr size_t CLAIM_TEXT_MAX_LEN = 2 * (BOX_NAME_MAX_LEN - 1) + 13;  // name@4294967295:name + NUL
+constexpr uint32_t CLAIM_CLOCK_PERSIST_STEP = 256;  // NVS keeps the clock this far ahead // Adjustable
+
+struct ClaimStamp {
+  uint32_t lamport;   // 0: unstamped
+  BoxId origin;       // box that made the claim
+};
+
+// Total order, identical on every box: clock first, then origin name
+// (BoxIds are local to each box, names are not)
+inline bool claimNewer(const ClaimStamp& a, const ClaimStamp& b) {
+  if (a.lamport != b.lamport) return a.lamport > b.lamport;
+  return strcmp(boxName(a.origin), boxName(b.origin)) > 0;
+}
+
+inline size_t formatClaimText(char* out, size_t size, const char* active, uint32_t lamport, const char* origin) {
+  int len = snprintf(out, size, "%s@%lu:%s", active, (unsigned long)lamport, origin);
+  if (len < 0) return 0;
+  return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+// false for a bare name: `active` is the whole text, lamport 0
+inline bool parseClaimText(const char* text, BoxName& active, uint32_t& lamport, BoxName& origin) {
+  lamport = 0;
+  origin.set(nullptr);
+  const char* at = strchr(text, '@');
+  const char* colon = at ? strchr(at, ':') : nullptr;
+  char* end = nullptr;
+  unsigned long clock = colon ? strtoul(at + 1, &end, 10) : 0;
+  if (!colon || end != colon || clock == 0 || clock > UINT32_MAX || colon[1] == '\0') {
+    active.set(text);
+    return false;
+  }
+  size_t len = (size_t)(at - text);
+  if (len > BOX_NAME_MAX_LEN - 1) len = BOX_NAME_MAX_LEN - 1;
+  memcpy(active.text, text, len);
+  active.text[len] = '\0';
+  origin.set(colon + 1);
+  lamport = (uint32_t)clock;
+  return true;
+}
+
+#endif // CLAIM_CLOCK_H
@@ -0,0 +1,37 @@
+#pragma once
+// heap_monitor.h — heap low-water mark and fragmentation over long uptimes
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ------------------------------------------------------------------
+// After setup() nothing on the control or cloud paths should allocate:
+// box names are BoxIds/BoxNames, and the cloud String properties reserve
+// their buffers at boot so later assignments reuse them. The monitor
+// checks that claim on a running box. It samples the 8-bit heap from the
+// network task and logs a summary every HEAP_REPORT_INTERVAL_MS: free
+// bytes against the boot baseline, the IDF low-water mark, and the
+// largest free block. Fragmentation is 100 - largest * 100 / free.
+// A largest block below HEAP_LOW_BLOCK_WARN_BYTES is warned about once
+// per dip, since a TLS reconnect needs roughly that much contiguous heap.
+// `heap` prints the same figures on demand.
+// ------------------------------------------------------------------
+constexpr unsigned long HEAP_SAMPLE_INTERVAL_MS = 10000;   // ms // Adjustable
+constexpr unsigned long HEAP_REPORT_INTERVAL_MS = 3600000; // ms between log summaries // Adjustable
+constexpr size_t HEAP_LOW_BLOCK_WARN_BYTES = 16384;        // bytes // Adjustable
+
+struct HeapSnapshot {
+  uint32_t freeBytes;
+  uint32_t minFreeBytes;      // low-water mark since boot (IDF)
+  uint32_t largestBlock;
+  uint8_t fragmentationPct;
+};
+
+void beginHeapMonitor();                     // end of setup(): records the baseline
+void serviceHeapMonitor(unsigned long now);  // network task
+HeapSnapshot heapSnapshot();
+void heapCommand(const char* args);          // "heap" serial command
+
+#endif // HEAP_MONITOR_H
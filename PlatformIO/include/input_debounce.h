@@ -0,0 +1,60 @@
+#pragma once
+// input_debounce.h — time-based debounce for one digital input
+#ifndef INPUT_DEBOUNCE_H
+#define INPUT_DEBOUNCE_H
+
+#include <stdint.h>
+
+// ------------------------------------------------------------------
+// Fed with every raw edge (from the GPIO ISRs), a DebouncedInput reports
+// at most one settled change per burst: once no edge has arrived for the
+// settle time, the pin's current level becomes the stable level. A burst
+// that ends back at the stable level is pure bounce and reports nothing.
+// All times are esp_timer_get_time() microseconds (32-bit, wrap-safe).
+// ------------------------------------------------------------------
+struct DebouncedInput {
+  uint8_t stable;        // debounced level the consumers have seen
+  uint8_t raw;           // level at the latest edge
+  bool settling;         // a burst is in progress
+  uint16_t edges;        // raw edges in the current burst
+  uint32_t burstStartUs; // first edge of the burst: the settled change's timestamp
+  uint32_t lastEdgeUs;
+
+  void reset(uint8_t level) {
+    stable = raw = level;
+    settling = false;
+    edges = 0;
+    burstStartUs = lastEdgeUs = 0;
+  }
+
+  void edge(uint8_t level, uint32_t atUs) {
+    if (!settling) {
+      settling = true;
+      edges = 0;
+      burstStartUs = atUs;
+    }
+    raw = level;
+    lastEdgeUs = atUs;
+    edges++;
+  }
+
+  uint32_t settlesAtUs(uint32_t settleUs) const { return lastEdgeUs + settleUs; }
+
+  // `levelNow` is the pin read back at `nowUs`. A level that differs from
+  // the last edge means an edge was missed: it restarts the settle time.
+  // Returns true when the stable level changed.
+  bool settle(uint8_t levelNow, uint32_t nowUs, uint32_t settleUs) {
+    if (!settling) return false;
+    if (levelNow != raw) {
+      edge(levelNow, nowUs);
+      return false;
+    }
+    if ((uint32_t)(nowUs - lastEdgeUs) < settleUs) return false;
+    settling = false;
+    if (raw == stable) return false;
+    stable = raw;
+    return true;
+  }
+};
+
+#endif // INPUT_DEBOUNCE_H
@@ -0,0 +1,71 @@
+#pragma once
+// latency_bench.h — switch-edge to peer-motor-start latency benchmark
+#ifndef LATENCY_BENCH_H
+#define LATENCY_BENCH_H
+
+#include <stdint.h>
+#include "peer_registry.h"
+
+// ------------------------------------------------------------------
+// Enable with -DLATENCY_BENCH (env:arduino_nano_esp32_bench*). Both boxes
+// run the same build and keep wall clocks in step with SNTP.
+//
+//   driver (the box that claims)      peer (the box that reacts)
+//   t0  switch edge (real or injected)
+//   t1  active_box handed to cloud
+//                                     t2c arrival via cloud
+//                                     t2l arrival via peer link
+//                                     t3  EN1 driven (first duty write
+//                                         or soft-PWM ON of the stroke)
+//
+// The peer sends one `bench_report` per claim back through the cloud; the
+// driver matches it to its outstanding claim and records histograms.
+// `bench start [n]` on one box runs n automated claim/release cycles. They
+// take the driver's switch over (takeVirtualInputs()) and flip it through
+// the edge ring, so t0 is an edge that still has to be debounced and
+// handled; the real switch is ignored until the cycles end or `bench stop`.
+// `bench peer` on the other box gives it a virtual arm: its switch is on
+// for every claim, the stroke knocks it off and returns, and the switch
+// goes back on shortly after the driver's release (that is a claim by the
+// peer, made while the driver's switch is off). Without it only the first
+// claim meets a switch that is on. Claims that leave the motor stopped
+// (releases, switch off) are counted in "edge->no start" and kept out of
+// the motor spans. One-way link numbers are within the SNTP offset error
+// (a few ms).
+// ------------------------------------------------------------------
+#if defined(LATENCY_BENCH)
+#include <Arduino.h>
+
+constexpr uint16_t BENCH_DEFAULT_CYCLES = 300;
+constexpr unsigned long BENCH_CYCLE_INTERVAL_MS = 4000;  // ms between automated claims // Adjustable
+constexpr size_t BENCH_REPORT_MAX_LEN = 112;             // bytes of a `bench_report` line
+constexpr unsigned long BENCH_REPORT_TIMEOUT_MS = 3000;  // ms to wait for the cloud copy before reporting
+constexpr unsigned long BENCH_ARM_LEAVE_MS = 40;         // peer arm: ms until the limit is released // Adjustable
+constexpr unsigned long BENCH_ARM_FORWARD_MS = 350;      // peer arm: ms until the switch is knocked off // Adjustable
+constexpr unsigned long BENCH_ARM_RETURN_MS = 350;       // peer arm: ms until the limit is pressed // Adjustable
+constexpr unsigned long BENCH_PEER_REARM_MS = 500;       // peer arm: ms after the driver's release to switch on // Adjustable
+constexpr const char* BENCH_NTP_SERVER = "pool.ntp.org";
+
+enum BenchSource : uint8_t { BENCH_VIA_CLOUD, BENCH_VIA_LINK };
+
+extern String bench_report;   // cloud property (thingProperties.h)
+
+void beginLatencyBench();
+void onBenchCloudConnect();                               // starts SNTP
+// driver side
+void benchNoteEdge(uint32_t edgeMonoUs);                  // control task: local claim source
+void benchNoteClaim(BoxId box);                           // control task: setActiveBox()
+void benchNotePublish(BoxId box);                         // network task: active_box written
+// peer side
+void benchNoteArrival(BoxId box, BenchSource via, uint32_t monoUs); // any task
+void benchNoteMotorDecision(bool started);                // control task: modifyMotorState() ran
+void benchNoteMotorOutput();                              // control task: EN1 driven for the stroke
+// plumbing
+void serviceLatencyBench(unsigned long now);              // control task: automated cycles
+unsigned long benchNextWake(bool& armed);                 // control task: scheduler deadline
+void serviceLatencyBenchNetwork(unsigned long now);       // network task: publish reports
+void onBenchReport();                                     // cloud callback
+void benchCommand(const char* args);                      // "bench" serial command: start [n] / peer / stop / reset
+#endif
+
+#endif // LATENCY_BENCH_H
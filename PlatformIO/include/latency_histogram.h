@@ -0,0 +1,86 @@
+#pragma once
+// latency_histogram.h — fixed-size log-linear histogram for µs timings
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ------------------------------------------------------------------
+// Values below 16 get an exact bucket; above that each power of two is
+// split into 4 sub-buckets (worst-case error ~19%). 128 buckets cover the
+// full uint32_t range in 512 bytes, with no allocation and O(1) record().
+// Percentiles report the upper bound of the bucket they fall into.
+// ------------------------------------------------------------------
+class LatencyHistogram {
+public:
+  static constexpr uint8_t LINEAR_BUCKETS = 16;
+  static constexpr uint8_t SUB_BUCKET_BITS = 2;
+  static constexpr uint8_t BUCKETS = LINEAR_BUCKETS + (32 - 4) * (1 << SUB_BUCKET_BITS);
+
+  LatencyHistogram() { reset(); }
+
+  void reset() {
+    memset(counts, 0, sizeof(counts));
+    samples = 0;
+    sum = 0;
+    minValue = UINT32_MAX;
+    maxValue = 0;
+  }
+
+  void record(uint32_t value) {
+    counts[bucketFor(value)]++;
+    samples++;
+    sum += value;
+    if (value < minValue) minValue = value;
+    if (value > maxValue) maxValue = value;
+  }
+
+  uint32_t count() const { return samples; }
+  uint32_t min() const { return samples ? minValue : 0; }
+  uint32_t max() const { return maxValue; }
+  uint32_t mean() const { return samples ? (uint32_t)(sum / samples) : 0; }
+
+  // pct in 0-100; p0 and p100 return the exact min/max
+  uint32_t percentile(uint8_t pct) const {
+    if (samples == 0) return 0;
+    if (pct == 0) return min();
+    if (pct >= 100) return max();
+    uint32_t rank = (uint32_t)(((uint64_t)samples * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint32_t upper = bucketUpperBound(i);
+        return upper > maxValue ? maxValue : upper;
+      }
+    }
+    return max();
+  }
+
+  static uint8_t bucketFor(uint32_t value) {
+    if (value < LINEAR_BUCKETS) return (uint8_t)value;
+    uint8_t msb = 31 - __builtin_clz(value);
+    uint8_t sub = (value >> (msb - SUB_BUCKET_BITS)) & ((1 << SUB_BUCKET_BITS) - 1);
+    return LINEAR_BUCKETS + (msb - 4) * (1 << SUB_BUCKET_BITS) + sub;
+  }
+
+  static uint32_t bucketUpperBound(uint8_t index) {
+    if (index < LINEAR_BUCKETS) return index;
+    uint8_t octave = (index - LINEAR_BUCKETS) >> SUB_BUCKET_BITS;
+    uint8_t sub = (index - LINEAR_BUCKETS) & ((1 << SUB_BUCKET_BITS) - 1);
+    uint8_t msb = octave + 4;
+    uint64_t lower = (1ULL << msb) + ((uint64_t)sub << (msb - SUB_BUCKET_BITS));
+    uint64_t upper = lower + (1ULL << (msb - SUB_BUCKET_BITS)) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : (uint32_t)upper;
+  }
+
+private:
+  uint32_t counts[BUCKETS];
+  uint32_t samples;
+  uint64_t sum;
+  uint32_t minValue;
+  uint32_t maxValue;
+};
+
+#endif // LATENCY_HISTOGRAM_H
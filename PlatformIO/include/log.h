@@ -0,0 +1,109 @@
+#pragma once
+// log.h — leveled, buffered serial logging drained by a background task
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ------------------------------------------------------------------
+// LOG_ERROR/WARN/INFO/DEBUG(fmt, ...) cost the caller a few stores: the
+// format pointer, up to LOG_MAX_ARGS integer/pointer arguments and a
+// timestamp go into a lock-free ring, and the log task formats and prints
+// them later. When the ring is full the record is dropped (and counted),
+// never waited for, so a slow or absent serial port can't stall the
+// control loop.
+//
+// Because formatting is deferred, `fmt` and every %s argument must stay
+// valid until printed: string literals, boxName(), motionShapeName() and
+// the like. Floats and 64-bit values aren't supported — cast to an int.
+//
+// Levels below LOG_LEVEL (-DLOG_LEVEL=LOG_LEVEL_DEBUG etc.) compile to
+// nothing. Explicit console replies (help, `strokes`, `bench`, ...) still
+// print synchronously; the command dispatcher flushes the ring first so
+// they land after everything logged before them.
+// ------------------------------------------------------------------
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+  #define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_BAUD_RATE
+  #define LOG_BAUD_RATE 115200   // ignored by the Nano ESP32's native USB CDC
+#endif
+
+constexpr size_t   LOG_RING_CAPACITY     = 64;   // records; power of two
+constexpr size_t   LOG_MAX_ARGS          = 4;
+constexpr size_t   LOG_LINE_MAX          = 160;  // bytes per formatted line
+constexpr unsigned long LOG_DRAIN_INTERVAL_MS = 10; // ms // Adjustable
+constexpr int      LOG_TASK_CORE         = 0;
+constexpr unsigned LOG_TASK_PRIORITY     = 1;    // below the network task
+constexpr uint32_t LOG_TASK_STACK        = 4096; // bytes
+
+static_assert((LOG_RING_CAPACITY & (LOG_RING_CAPACITY - 1)) == 0, "LOG_RING_CAPACITY must be a power of two");
+
+void logBegin();                  // reset the ring; call before the first LOG_*
+bool logWrite(uint8_t level, const char* fmt, const uintptr_t* args, uint8_t argc);
+size_t logDrain(size_t maxRecords = LOG_RING_CAPACITY); // print queued records; returns how many
+void logFlush();                  // wait out any running drain, then print everything queued so far
+uint32_t logDropped();            // records dropped since logBegin()
+const char* logLevelName(uint8_t level);
+
+namespace logdetail {
+  inline uintptr_t arg(int v) { return (uintptr_t)(intptr_t)v; }
+  inline uintptr_t arg(unsigned v) { return (uintptr_t)v; }
+  inline uintptr_t arg(long v) { return (uintptr_t)(intptr_t)v; }
+  inline uintptr_t arg(unsigned long v) { return (uintptr_t)v; }
+  inline uintptr_t arg(const char* v) { return (uintptr_t)v; }
+
+  // Never called: lets the compiler check the format against the arguments
+  inline void check(const char*, ...) __attribute__((format(printf, 1, 2)));
+  inline void check(const char*, ...) {}
+}
+
+template <typename... Args>
+inline bool logDeferred(uint8_t level, const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  const uintptr_t packed[sizeof...(Args) + 1] = { logdetail::arg(args)..., 0 };
+  return logWrite(level, fmt, packed, (uint8_t)sizeof...(Args));
+}
+
+#define LOG_AT(level, ...)                          \
+  do {                                              \
+    if (false) logdetail::check(__VA_ARGS__);       \
+    logDeferred(level, __VA_ARGS__);                \
+  } while (0)
+
+// Compiled-out levels still type-check (and "use") their arguments
+#define LOG_DISABLED(...)                           \
+  do {                                              \
+    if (false) logdetail::check(__VA_ARGS__);       \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+  #define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+  #define LOG_ERROR(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+  #define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+  #define LOG_WARN(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  #define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+  #define LOG_INFO(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  #define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+  #define LOG_DEBUG(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#endif // LOG_H
@@ -0,0 +1,59 @@
+#pragma once
+// loop_profiler.h — optional per-stage timing of the control and network loops
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ------------------------------------------------------------------
+// Enable with -DLOOP_PROFILING. When disabled, PROFILE_STAGE() expands to
+// the bare call and nothing below is compiled, so production builds pay
+// nothing. Add -DLOOP_PROFILING_CLOUD to also publish a summary string
+// as the `loop_profile` cloud property.
+// ------------------------------------------------------------------
+enum LoopStage {
+  STAGE_CLOUD_UPDATE,      // ArduinoCloud.update() (network task)
+  STAGE_INPUTS,            // serviceInputs()
+  STAGE_SETTINGS_BUTTON,   // handleSettingsButton()
+  STAGE_SWITCH_DETECTION,  // handleSwitchDetection()
+  STAGE_MOTOR_PWM,         // updateMotorPWM()
+  STAGE_ANIMATIONS,        // updateAnimations()
+  STAGE_BUZZER,            // updateBuzzerAlarm()
+  STAGE_SERIAL_MENU,       // handleSerialMenu()
+  STAGE_CONTROL_PASS,      // one full controlLoop() pass
+  STAGE_CONTROL_PERIOD,    // start-to-start time between passes (jitter)
+  LOOP_STAGE_COUNT
+};
+
+#if defined(LOOP_PROFILING_CLOUD) && !defined(LOOP_PROFILING)
+  #error "LOOP_PROFILING_CLOUD requires LOOP_PROFILING"
+#endif
+
+#if defined(LOOP_PROFILING)
+  #include <esp_timer.h>
+
+  #define PROFILE_STAGE(stage, call)                                       \
+    do {                                                                   \
+      int64_t _profileStart = esp_timer_get_time();                        \
+      call;                                                                \
+      recordLoopStage(stage, (uint32_t)(esp_timer_get_time() - _profileStart)); \
+    } while (0)
+
+  constexpr unsigned long LOOP_PROFILE_PUBLISH_MS = 60000; // ms // Adjustable
+  constexpr size_t LOOP_PROFILE_SUMMARY_MAX_LEN = 256;     // bytes of the `loop_profile` summary
+
+  void recordLoopStage(LoopStage stage, uint32_t micros);
+  void markControlPassStart();   // feeds STAGE_CONTROL_PERIOD
+  class LatencyHistogram;
+
+  void resetLoopProfile();
+  void printLoopProfile();       // table of min/p50/p99/max per stage
+  size_t formatLoopProfile(char* out, size_t len); // compact one-line summary
+  const LatencyHistogram& loopStageHistogram(LoopStage stage);
+  const char* loopStageName(LoopStage stage);
+#else
+  #define PROFILE_STAGE(stage, call) call
+#endif
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,57 @@
+#pragma once
+// motion_profile.h — EN1 duty ramps for the arm's strokes (LEDC backend)
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <stdint.h>
+
+// ------------------------------------------------------------------
+// A stroke starts at startSpeed and ramps to the cruise speed (motorSpeed)
+// over accelMs. If the stroke's duration is known from the previous one in
+// that direction, the last approachMs run at approachSpeed, reached with
+// the same ramp shape, so the arm meets the switch/limit gently. Speeds
+// are percent of full duty, like motorSpeed. Before a reversal (or a stop)
+// the bridge brakes for brakeMs with IN1 = IN2 = LOW and EN1 fully on.
+//
+// There is no position sensor: "near the end of travel" is measured in
+// time. Because each stroke is timed under the same profile, the learned
+// duration settles where the slow window really is the last approachMs.
+// ------------------------------------------------------------------
+enum MotionShape : uint8_t {
+  MOTION_STEP,        // no ramps: full cruise duty at once (the old behaviour)
+  MOTION_TRAPEZOID,   // linear ramps
+  MOTION_SCURVE,      // smoothstep ramps (limited jerk)
+  MOTION_SHAPE_COUNT
+};
+
+struct MotionProfile {
+  MotionShape shape;
+  uint16_t accelMs;       // ramp length, start -> cruise and cruise -> approach
+  uint16_t brakeMs;       // 0 disables the brake phase
+  uint16_t approachMs;    // slow window at the end of a stroke; 0 disables
+  uint8_t startSpeed;     // % at the start of the ramp (overcomes stiction)
+  uint8_t approachSpeed;  // % during the approach window
+};
+
+constexpr MotionProfile DEFAULT_MOTION_PROFILE = {
+  MOTION_SCURVE,
+  150,   // ms  // Adjustable
+  40,    // ms  // Adjustable
+  120,   // ms  // Adjustable
+  30,    // %   // Adjustable
+  45,    // %   // Adjustable
+};
+
+// Speed (0-1000 per mille of full duty) `elapsedMs` into a stroke that is
+// expected to last `expectedMs` (0 = unknown: no approach window).
+uint16_t motionSpeedAt(const MotionProfile& profile, uint32_t elapsedMs,
+                       uint32_t expectedMs, uint8_t cruiseSpeed);
+
+// true while motionSpeedAt() is still changing with time at `elapsedMs`;
+// `nextChangeMs` is when it next starts changing otherwise (0 = never)
+bool motionRamping(const MotionProfile& profile, uint32_t elapsedMs,
+                   uint32_t expectedMs, uint8_t cruiseSpeed, uint32_t& nextChangeMs);
+
+const char* motionShapeName(MotionShape shape);
+
+#endif // MOTION_PROFILE_H
@@ -0,0 +1,60 @@
+#pragma once
+// ota_update.h — Arduino Cloud OTA with A/B partitions and boot validation
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <Arduino.h>
+
+// ------------------------------------------------------------------
+// Updates arrive through ArduinoIoTCloud's OTA: the dashboard (or
+// `arduino-cloud-cli ota upload`) sends the LZSS-compressed .ota image,
+// which ArduinoCloud.update() streams into the inactive app partition
+// (app0/app1 in the Nano ESP32's default table) from the network task on
+// core 0. The control task keeps its core and priority throughout.
+//
+// A download only starts while the arm is parked (the gate passed to
+// beginOtaUpdates()); a request made mid-stroke is confirmed on a later
+// poll. Flash erases and writes stall flash-resident code on both cores
+// for a few ms at a time, and the control loop and non-IRAM interrupts
+// with it, so from the confirmation on otaHoldsStrokes() keeps new strokes
+// from starting. The hold ends with the download: success reboots into
+// the new image; the library exposes no failure callback, so a download
+// that hasn't rebooted the box within OTA_DOWNLOAD_HOLD_MS lets the arm
+// play again.
+//
+// The new image boots in the bootloader's PENDING_VERIFY state and is
+// judged on local health, so a box whose Wi-Fi is down keeps a working
+// image: it marks itself valid once the control loop has kept running for
+// OTA_VALIDATE_HEALTHY_MS. A crash or reset before then rolls back in the
+// bootloader, and a control loop that stops passing for
+// OTA_CONTROL_STALL_MS asks for the rollback itself. Whether the cloud was
+// reached is only reported.
+// ------------------------------------------------------------------
+#ifndef FIRMWARE_VERSION
+  #define FIRMWARE_VERSION "dev " __DATE__ " " __TIME__
+#endif
+
+constexpr unsigned long OTA_VALIDATE_HEALTHY_MS = 60000;   // ms of running control loop before the image is kept // Adjustable
+constexpr unsigned long OTA_CONTROL_STALL_MS    = 5000;    // ms without a control pass that counts as hung // Adjustable
+constexpr unsigned long OTA_DOWNLOAD_HOLD_MS    = 180000;  // ms strokes stay held after a download is confirmed // Adjustable
+
+enum OtaImageState : uint8_t {
+  OTA_IMAGE_VALID,          // committed (or rollback not enabled in this bootloader)
+  OTA_IMAGE_PENDING,        // first boot after an update, not yet validated
+  OTA_IMAGE_ROLLING_BACK    // validation failed; rebooting into the old image
+};
+
+extern String firmware_version;   // cloud property (thingProperties.h), read-only
+
+// true when an update may be written now (called from the network task,
+// with otaHoldsStrokes() already true, so a stroke starting meanwhile backs off)
+typedef bool (*OtaReadyCheck)();
+
+void beginOtaUpdates(OtaReadyCheck ready);  // setup(), before the first ArduinoCloud.update()
+void serviceOtaUpdates(unsigned long now);  // network task: boot validation, `firmware_version`
+void otaNoteControlPass(unsigned long now); // control task: every pass (local health)
+bool otaHoldsStrokes();                     // any task: a confirmed download may be writing flash
+OtaImageState otaImageState();
+void otaCommand(const char* args);          // "ota" serial command
+
+#endif // OTA_UPDATE_H
@@ -0,0 +1,35 @@
+#pragma once
+// peer_link.h — direct box-to-box active-box announcements over ESP-NOW
+#ifndef PEER_LINK_H
+#define PEER_LINK_H
+
+#include <stdint.h>
+#include "peer_registry.h"
+#include "claim_clock.h"
+
+// ------------------------------------------------------------------
+// Enable with -DPEER_LINK_ESPNOW. A local claim is broadcast to every box
+// on the same Wi-Fi channel (all boxes share the AP, so they share its
+// channel) and repeated PEER_LINK_REPEATS times because broadcasts are not
+// acknowledged. Receivers drop repeats by (origin, boot id, sequence).
+//
+// The cloud `active_box` property stays authoritative: the claiming box
+// still publishes it, and any box that missed the broadcast catches up from
+// the cloud. Frames carry the claim's Lamport stamp, so the cloud echo of
+// a claim already taken from the link is no newer and is dropped by
+// processActiveBoxEvents(); the motor fires once.
+// ------------------------------------------------------------------
+#if defined(PEER_LINK_ESPNOW)
+constexpr uint8_t PEER_LINK_REPEATS = 3;                    // total sends per claim
+constexpr unsigned long PEER_LINK_REPEAT_INTERVAL_MS = 20;  // ms between repeats // Adjustable
+
+// Called from the Wi-Fi task for each new (non-duplicate) announcement
+typedef void (*PeerLinkActiveHandler)(BoxId active, ClaimStamp stamp, uint32_t receivedUs);
+
+bool beginPeerLink(PeerLinkActiveHandler handler);  // after WiFi.mode(WIFI_STA)
+void peerLinkAnnounce(BoxId active, uint32_t lamport); // control task
+void servicePeerLink(unsigned long now);            // network task: repeats
+void printPeerLinkStats();
+#endif
+
+#endif // PEER_LINK_H
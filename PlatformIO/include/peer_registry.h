@@ -0,0 +1,59 @@
+#pragma once
+// peer_registry.h — numeric IDs for every box on the network
+#ifndef PEER_REGISTRY_H
+#define PEER_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ------------------------------------------------------------------
+// Box names only exist at the cloud boundary (`active_box`). Everything
+// else works on a BoxId and a BoxMask with one bit per box, so "is this
+// box active?" is a single AND instead of a String compare.
+//
+// IDs are local to each device: names in KNOWN_BOX_NAMES get fixed IDs,
+// this box's BOX_NAME is registered next, and any other name seen in the
+// cloud or over the peer link is registered on first sight. Registration
+// is serialised internally; lookups are lock-free because entries are
+// never changed once published.
+// ------------------------------------------------------------------
+typedef uint8_t BoxId;
+typedef uint32_t BoxMask;
+
+constexpr BoxId BOX_ID_NONE = 0;            // "NONE" / empty: no box active
+constexpr uint8_t MAX_BOXES = 31;           // IDs 1..31, one mask bit each
+constexpr size_t BOX_NAME_MAX_LEN = 16;     // including terminator
+constexpr const char* BOX_NAME_NONE = "NONE";
+
+// Fixed-capacity copy of a box name for structs, frames and stack
+// buffers — never heap-allocated. Longer names keep the first
+// BOX_NAME_MAX_LEN - 1 characters, the prefix findBoxId() compares.
+struct BoxName {
+  char text[BOX_NAME_MAX_LEN];
+
+  void set(const char* name) {
+    strncpy(text, name ? name : "", BOX_NAME_MAX_LEN - 1);
+    terminate();
+  }
+  void terminate() { text[BOX_NAME_MAX_LEN - 1] = '\0'; } // after a raw copy (memcpy, sscanf)
+  const char* c_str() const { return text; }
+  bool equals(const char* name) const {
+    return name != nullptr && strncmp(text, name, BOX_NAME_MAX_LEN - 1) == 0;
+  }
+};
+static_assert(sizeof(BoxName) == BOX_NAME_MAX_LEN, "BoxName is sent on the wire as a plain char array");
+
+inline BoxMask boxBit(BoxId id) {
+  return (id == BOX_ID_NONE || id > MAX_BOXES) ? 0 : (BoxMask)1 << (id - 1);
+}
+
+void initPeerRegistry();                // call once in setup()
+BoxId thisBoxId();
+BoxId findBoxId(const char* name);      // BOX_ID_NONE if unknown
+BoxId registerBoxName(const char* name);// find or add; BOX_ID_NONE if full
+const char* boxName(BoxId id);          // BOX_NAME_NONE for unknown IDs
+uint8_t registeredBoxCount();
+void printPeerRegistry(BoxMask active);
+
+#endif // PEER_REGISTRY_H
@@ -0,0 +1,69 @@
+#pragma once
+// publish_coalescer.h — rate-limited, de-duplicated `active_box` writes
+#ifndef PUBLISH_COALESCER_H
+#define PUBLISH_COALESCER_H
+
+#include <stdint.h>
+#include "peer_registry.h"
+
+// ------------------------------------------------------------------
+// Every cloud write is a message peers react to (and one against the
+// plan's quota), so the network task doesn't forward each local claim.
+// It keeps only the latest desired value and sends it at most once per
+// window: the first change after a quiet spell goes out at once, later
+// ones within the window are held and collapse into one write when it
+// ends. A value equal to what peers last saw — our own last write, or
+// the last value the cloud delivered — is never sent, so an on/off/on
+// toggle inside one window costs a single write.
+// Owned by the network task; not thread-safe.
+// ------------------------------------------------------------------
+struct PublishCoalescer {
+  BoxId desired;
+  bool pending;          // `desired` not yet sent or dropped
+  BoxId seen;            // what peers last saw
+  bool seenKnown;        // false until the first cloud sync or write
+  bool sentOnce;
+  uint32_t lastSentMs;
+  uint32_t sent;
+  uint32_t coalesced;    // desires replaced before they were sent
+  uint32_t unchanged;    // desires dropped because peers already had them
+
+  void reset() {
+    desired = seen = BOX_ID_NONE;
+    pending = seenKnown = sentOnce = false;
+    lastSentMs = 0;
+    sent = coalesced = unchanged = 0;
+  }
+
+  void want(BoxId box) {
+    if (pending) coalesced++;
+    desired = box;
+    pending = true;
+  }
+
+  // A value delivered by the cloud is what every peer now acts on
+  void observed(BoxId box) {
+    seen = box;
+    seenKnown = true;
+  }
+
+  // True (with the value in `out`) when a write should go out now
+  bool due(uint32_t nowMs, uint32_t windowMs, BoxId& out) {
+    if (!pending) return false;
+    if (seenKnown && desired == seen) {
+      pending = false;
+      unchanged++;
+      return false;
+    }
+    if (sentOnce && (uint32_t)(nowMs - lastSentMs) < windowMs) return false;
+    pending = false;
+    sentOnce = true;
+    lastSentMs = nowMs;
+    sent++;
+    observed(desired);
+    out = desired;
+    return true;
+  }
+};
+
+#endif // PUBLISH_COALESCER_H
@@ -0,0 +1,74 @@
+#pragma once
+// soak_test.h — long switch → arm → limit runs with a diffable summary
+#ifndef SOAK_TEST_H
+#define SOAK_TEST_H
+
+#include <stdint.h>
+#include "peer_registry.h"
+
+// ------------------------------------------------------------------
+// Enable with -DSOAK_TEST (env:arduino_nano_esp32_soak*, which adds
+// -DLOOP_PROFILING). `soak start [n]` runs n cycles of the box's own
+// game: switch ON (this box claims), a virtual peer named SOAK_PEER_NAME
+// claims, the arm runs forward and knocks the switch off, returns and
+// presses the limit. For each cycle the firmware's reaction times go into
+// histograms:
+//   claim   peer claim posted   -> forward drive decided
+//   reverse switch-off edge     -> reverse drive decided
+//   stop    limit-press edge    -> motor stopped
+//   cycle   switch-on           -> motor stopped
+// and a `SOAK_CYCLE n,claim,reverse,stop` log line (us). At the end (or on
+// `soak report`) one `SOAK_RESULT {...}` JSON line carries those, the loop
+// profiler's per-stage timings, heap at start/end and the NVS writes made
+// during the run; scripts/compare_soak.py diffs two of them.
+//
+// Virtual mode (default): the switch and limit pins are taken over and
+// driven by a timed arm model through the same edge ring, ISR cutoff and
+// debouncers as real edges, so a bare board will do. Fixture mode,
+// -DSOAK_FIXTURE_PIN=<gpio>: that output pulses HIGH for
+// SOAK_FIXTURE_PULSE_MS to flip the switch on (solenoid/servo finger) and
+// the real arm and limit do the rest.
+//
+// Claims made during a run, and any claim by or for the virtual peer,
+// stay off the cloud and the peer link so real peers don't play along;
+// the claim held before the run is put back when it ends, unless a real
+// peer's claim arrived meanwhile. The run teaches the stroke stats and motion profile its own
+// timings: `strokes reset` / `motion forget` before going back into play.
+// ------------------------------------------------------------------
+#if defined(SOAK_TEST)
+#if !defined(LOOP_PROFILING)
+  #error "SOAK_TEST requires LOOP_PROFILING"
+#endif
+#include <Arduino.h>
+
+constexpr uint16_t SOAK_DEFAULT_CYCLES = 2000;
+constexpr unsigned long SOAK_CYCLE_GAP_MS = 300;       // ms at rest between cycles // Adjustable
+constexpr unsigned long SOAK_PEER_DELAY_MS = 150;      // ms from switch ON to the peer claim // Adjustable
+constexpr unsigned long SOAK_CYCLE_TIMEOUT_MS = 5000;  // ms before a cycle counts as stuck // Adjustable
+constexpr const char* SOAK_PEER_NAME = "SOAK";
+#if defined(SOAK_FIXTURE_PIN)
+constexpr unsigned long SOAK_FIXTURE_PULSE_MS = 150;   // ms the fixture holds the switch // Adjustable
+#else
+// Virtual arm, timed from the drive decision
+constexpr unsigned long SOAK_ARM_LEAVE_MS = 40;        // ms until forward travel releases the limit // Adjustable
+constexpr unsigned long SOAK_ARM_FORWARD_MS = 350;     // ms until the arm knocks the switch off // Adjustable
+constexpr unsigned long SOAK_ARM_RETURN_MS = 350;      // ms until the return presses the limit // Adjustable
+#endif
+
+void beginSoakTest();                                          // setup()
+void soakNoteInput(uint8_t channel, uint8_t level, uint32_t edgeUs); // handleSwitchDetection(): settled switch/limit
+void soakNoteMotor(int direction);                             // modifyMotorState(): direction changed
+void serviceSoakTest(unsigned long now);                       // control task
+unsigned long soakNextWake(bool& armed);                       // control task: scheduler deadline
+bool soakRunning();
+BoxId soakPeerBox();                                           // the virtual peer
+void soakNoteNvsWrite();                                       // any task
+void soakCommand(const char* args);                            // "soak" serial command
+
+// Every NVS put/remove, so the summary can report flash wear
+#define NOTE_NVS_WRITE() soakNoteNvsWrite()
+#else
+#define NOTE_NVS_WRITE() do {} while (0)
+#endif
+
+#endif // SOAK_TEST_H
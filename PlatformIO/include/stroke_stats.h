@@ -0,0 +1,36 @@
+#pragma once
+// stroke_stats.h — running mean/variance of stroke durations (Welford)
+#ifndef STROKE_STATS_H
+#define STROKE_STATS_H
+
+#include <stdint.h>
+#include <math.h>
+
+// ------------------------------------------------------------------
+// One instance per stroke direction. Welford's update keeps the mean and
+// the sum of squared deviations without storing samples, so the struct is
+// a fixed 12 bytes and can be written to NVS as it is.
+// ------------------------------------------------------------------
+struct __attribute__((packed)) StrokeStats {
+  uint32_t count;
+  float meanMs;
+  float m2;        // sum of squared deviations from the mean
+
+  void reset() {
+    count = 0;
+    meanMs = 0;
+    m2 = 0;
+  }
+
+  void record(uint32_t ms) {
+    count++;
+    float delta = (float)ms - meanMs;
+    meanMs += delta / (float)count;
+    m2 += delta * ((float)ms - meanMs);
+  }
+
+  float variance() const { return count > 1 ? m2 / (float)(count - 1) : 0; }
+  float stddevMs() const { return sqrtf(variance()); }
+};
+
+#endif // STROKE_STATS_H
@@ -0,0 +1,82 @@
+#pragma once
+// telemetry.h — binary event log in RAM, spilled to NVS, uploaded in batches
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// ------------------------------------------------------------------
+// Fleet analytics without one cloud write per event. telemetryRecord()
+// (any task, a few stores under a spinlock) appends an 8-byte event to a
+// RAM ring. The network task uploads the ring every
+// TELEMETRY_UPLOAD_INTERVAL_MS as one `telemetry` String: a batch of
+// delta-coded varints, base64-encoded, prefixed "t1:<seq>:". While the
+// cloud is offline and the ring passes three quarters full, the oldest
+// events are encoded the same way and spilled to NVS under their own
+// "telemetry" namespace (at most TELEMETRY_SPILL_SLOTS batches; the
+// oldest is overwritten). Spilled batches survive a reset and go out
+// first, one per TELEMETRY_DRAIN_GAP_MS, once the cloud is back. Any
+// uploaded batch, from the ring or a slot, is kept until the cloud stayed
+// connected for the gap after it; a drop before that sends it again (a
+// ring batch via NVS) under the same seq, so copies are told apart. A full
+// ring drops new events and counts them; the next batch carries the count.
+//
+// Batch layout (before base64), all integers unsigned LEB128 varints:
+//   seq, base ms (millis() of the first event), events dropped before it,
+//   then per event: ms since the previous event, type byte, aux byte, value
+// seq keeps counting across resets while spilled batches remain.
+// Once SNTP has set the clock, batches recorded this boot go out as
+// "t2:<seq>:<wall ms>:<millis>:" instead: the wall-clock and millis()
+// readings taken together at upload, which put every event on wall time,
+// e.g. to pair one box's claim_publish with another's claim_arrival (good
+// to the boxes' SNTP offsets, tens of ms). Batches spilled before a reset
+// keep "t1:". scripts/decode_telemetry.py turns a batch back into rows.
+// ------------------------------------------------------------------
+enum TelemetryType : uint8_t {
+  TELEM_SWITCH = 1,         // aux: debounced level
+  TELEM_MOTOR_START,        // aux: direction (1 / 255 = -1), value: speed %
+  TELEM_MOTOR_STOP,
+  TELEM_STROKE,             // aux: direction, value: stroke ms
+  TELEM_STALL,              // aux: direction, value: ms until the cutoff
+  TELEM_CLAIM_ARRIVAL,      // aux: BoxId, value: ActiveBoxSource
+  TELEM_CLAIM_PUBLISH,      // aux: BoxId, written to `active_box`
+  TELEM_CLOUD_CONNECT,      // value: seconds offline (since boot for the first)
+  TELEM_CLOUD_DISCONNECT,   // value: seconds connected
+};
+
+struct __attribute__((packed)) TelemetryEvent {
+  uint32_t atMs;
+  uint16_t value;
+  uint8_t type;
+  uint8_t aux;
+};
+static_assert(sizeof(TelemetryEvent) == 8, "TelemetryEvent must stay 8 bytes");
+
+constexpr size_t TELEMETRY_RING_CAPACITY = 256;               // events (2 KB); power of two
+constexpr unsigned long TELEMETRY_UPLOAD_INTERVAL_MS = 60000; // ms between batches // Adjustable
+constexpr unsigned long TELEMETRY_DRAIN_GAP_MS = 2000;        // ms between backlog batches // Adjustable
+constexpr size_t TELEMETRY_BATCH_MAX_BYTES = 180;             // encoded bytes per batch, before base64
+constexpr size_t TELEMETRY_BATCH_MAX_EVENTS = TELEMETRY_BATCH_MAX_BYTES / 4; // 4 bytes is the smallest event
+constexpr size_t TELEMETRY_TEXT_MAX_LEN = 288;                // "t2:<seq>:<wall>:<ms>:" + base64 of a full batch
+constexpr uint8_t TELEMETRY_SPILL_SLOTS = 8;                  // NVS batches kept while offline // Adjustable
+constexpr size_t TELEMETRY_SPILL_THRESHOLD = TELEMETRY_RING_CAPACITY * 3 / 4; // events
+constexpr const char* TELEMETRY_NTP_SERVER = "pool.ntp.org";
+constexpr long TELEMETRY_CLOCK_VALID_AFTER = 1700000000;      // epoch s; earlier means the clock isn't set
+
+static_assert((TELEMETRY_RING_CAPACITY & (TELEMETRY_RING_CAPACITY - 1)) == 0,
+              "TELEMETRY_RING_CAPACITY must be a power of two");
+static_assert(40 + (TELEMETRY_BATCH_MAX_BYTES + 2) / 3 * 4 < TELEMETRY_TEXT_MAX_LEN,
+              "a full batch must fit the telemetry String");
+
+extern String telemetry;   // cloud property (thingProperties.h), read-only
+
+void beginTelemetry();     // setup(): reset the ring, find spilled batches
+void telemetryRecord(TelemetryType type, uint8_t aux = 0, uint16_t value = 0); // any task
+void serviceTelemetry(unsigned long now);  // network task: upload / spill
+size_t telemetryPending();                 // events waiting in RAM
+// Encodes as many of `events` as fit in `size` bytes; *taken says how many
+size_t encodeTelemetryBatch(uint8_t* out, size_t size, uint32_t seq, uint32_t dropped,
+                            const TelemetryEvent* events, size_t count, size_t* taken);
+void telemetryCommand(const char* args);   // "telemetry" serial command
+
+#endif // TELEMETRY_H
@@ -2,6 +2,9 @@
 #include "arduino_secrets.h" // wrapper that selects device secrets via build flag
 #include <ArduinoIoTCloud.h>
 #include <Arduino_ConnectionHandler.h> 
+#if defined(WIFI_FAST_CONNECT)
+#include "wifi_fast_connect.h"
+#endif
 
 const char DEVICE_LOGIN_NAME[]  = SECRET_DEVICE_ID;
 
@@ -9,16 +12,45 @@ const char SSID[]               = SECRET_SSID;    // Network SSID (name)
 const char PASS[]               = SECRET_OPTIONAL_PASS;    // Network password (use for WPA, or use as key for WEP)
 const char DEVICE_KEY[]         = SECRET_DEVICE_KEY;    // Secret device password
 
+void onActiveStampChange();
 void onActiveBoxChange();
+void onBuzzerPatternChange();
 
+String active_stamp;
 String active_box;
+String buzzer_pattern;
+String motor_stats;
+String firmware_version;
+String telemetry;
+#if defined(LOOP_PROFILING_CLOUD)
+String loop_profile;
+#endif
+#if defined(LATENCY_BENCH)
+void onBenchReport();
+String bench_report;
+#endif
 
 void initProperties(){
 
   ArduinoCloud.setBoardId(DEVICE_LOGIN_NAME);
   ArduinoCloud.setSecretDeviceKey(DEVICE_KEY);
+  ArduinoCloud.addProperty(active_stamp, READWRITE, ON_CHANGE, onActiveStampChange);
   ArduinoCloud.addProperty(active_box, READWRITE, ON_CHANGE, onActiveBoxChange);
+  ArduinoCloud.addProperty(buzzer_pattern, READWRITE, ON_CHANGE, onBuzzerPatternChange);
+  ArduinoCloud.addProperty(motor_stats, READ, ON_CHANGE, NULL);
+  ArduinoCloud.addProperty(firmware_version, READ, ON_CHANGE, NULL);
+  ArduinoCloud.addProperty(telemetry, READ, ON_CHANGE, NULL);
+#if defined(LOOP_PROFILING_CLOUD)
+  ArduinoCloud.addProperty(loop_profile, READ, ON_CHANGE, NULL);
+#endif
+#if defined(LATENCY_BENCH)
+  ArduinoCloud.addProperty(bench_report, READWRITE, ON_CHANGE, onBenchReport);
+#endif
 
 }
 
+#if defined(WIFI_FAST_CONNECT)
+FastWiFiConnectionHandler ArduinoIoTPreferredConnection(SSID, PASS);
+#else
 WiFiConnectionHandler ArduinoIoTPreferredConnection(SSID, PASS);
+#endif
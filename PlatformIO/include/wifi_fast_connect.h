@@ -0,0 +1,60 @@
+#pragma once
+// wifi_fast_connect.h — rejoin the last AP without a scan or DHCP round
+#ifndef WIFI_FAST_CONNECT_H
+#define WIFI_FAST_CONNECT_H
+
+// ------------------------------------------------------------------
+// Enable with -DWIFI_FAST_CONNECT. The stock WiFiConnectionHandler scans
+// every channel and runs DHCP on each boot and reconnect, and on ESP32 its
+// init state also sleeps ~1.3 s. FastWiFiConnectionHandler keeps the AP
+// that last worked (BSSID, channel and the DHCP lease) in NVS, so the
+// record survives a power cut, and joins that AP directly, skipping the
+// scan; DHCP still runs, so the address is always one the router handed
+// out. If the cached AP hasn't answered within WIFI_FAST_CONNECT_TIMEOUT_MS
+// (AP replaced or moved channel), the attempt falls back to a full scan
+// plus DHCP, and the next good connection rewrites the record.
+//
+// -DWIFI_REUSE_LEASE also skips DHCP by taking the stored lease as a
+// static config: one association, typically 100-300 ms. The router never
+// hears of that lease, so it may renumber or hand it to another device;
+// a join on the stored lease that hasn't reached the cloud within
+// WIFI_LEASE_TRIAL_MS drops the lease and reconnects with DHCP. Give each
+// box a DHCP reservation, or pin the address with
+//   -DWIFI_STATIC_IP=\"192.168.1.60\" -DWIFI_GATEWAY=\"192.168.1.1\"
+//   -DWIFI_SUBNET=\"255.255.255.0\" [-DWIFI_DNS=\"192.168.1.1\"]
+// which also applies on the full-scan path and is never dropped.
+// ------------------------------------------------------------------
+#if defined(WIFI_FAST_CONNECT)
+#include <Arduino_ConnectionHandler.h>
+
+constexpr unsigned long WIFI_FAST_CONNECT_TIMEOUT_MS = 3000; // ms before a full scan // Adjustable
+#if defined(WIFI_REUSE_LEASE)
+constexpr unsigned long WIFI_LEASE_TRIAL_MS = 30000;         // ms for a reused lease to reach the cloud // Adjustable
+#endif
+
+#if defined(WIFI_STATIC_IP) && !(defined(WIFI_GATEWAY) && defined(WIFI_SUBNET))
+#error "WIFI_STATIC_IP needs WIFI_GATEWAY and WIFI_SUBNET"
+#endif
+
+// Drop-in for WiFiConnectionHandler (thingProperties.h); only the init and
+// connecting states change, the rest is the library's
+class FastWiFiConnectionHandler : public WiFiConnectionHandler {
+public:
+  FastWiFiConnectionHandler(const char* ssid, const char* pass);
+
+protected:
+  NetworkConnectionState update_handleInit() override;
+  NetworkConnectionState update_handleConnecting() override;
+#if defined(WIFI_REUSE_LEASE)
+  NetworkConnectionState update_handleConnected() override;
+#endif
+
+private:
+  const char* ssid;
+  const char* pass;
+};
+
+void wifiCommand(const char* args);   // "wifi" serial command; "wifi forget" drops the record
+#endif
+
+#endif // WIFI_FAST_CONNECT_H
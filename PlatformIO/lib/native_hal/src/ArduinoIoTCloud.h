@@ -0,0 +1,42 @@
+#pragma once
+// Minimal ArduinoIoTCloud: properties are registered so tests can write
+// them with fake::cloudWrite(); update() only runs queued callbacks.
+#include <Arduino.h>
+
+enum permissionType { READ, WRITE, READWRITE };
+#define ON_CHANGE -1
+
+enum class ArduinoIoTCloudEvent : size_t { SYNC = 0, CONNECT = 1, DISCONNECT = 2 };
+
+class Property {
+public:
+  Property& publishEvery(unsigned long) { return *this; }
+  Property& onSync(void (*)(Property&)) { return *this; }
+};
+
+class ConnectionHandler {};
+
+typedef bool (*onOTARequestCallbackFunc)(void);
+
+class ArduinoIoTCloudTCP {
+public:
+  void setBoardId(const char*) {}
+  void setSecretDeviceKey(const char*) {}
+  template <class T>
+  Property& addProperty(T& value, permissionType permission, int policy, void (*callback)(void) = nullptr) {
+    (void)permission; (void)policy;
+    return registerProperty((void*)&value, callback);
+  }
+  int begin(ConnectionHandler&, bool = true) { return 1; }
+  void update();
+  int connected();
+  void printDebugInfo() {}
+  void addCallback(ArduinoIoTCloudEvent event, void (*callback)(void));
+  void onOTARequestCb(onOTARequestCallbackFunc callback);
+
+private:
+  Property& registerProperty(void* address, void (*callback)(void));
+};
+
+extern ArduinoIoTCloudTCP ArduinoCloud;
+inline void setDebugMessageLevel(int) {}
@@ -0,0 +1,7 @@
+#pragma once
+#include <ArduinoIoTCloud.h>
+
+class WiFiConnectionHandler : public ConnectionHandler {
+public:
+  WiFiConnectionHandler(const char*, const char*, bool = true) {}
+};
@@ -0,0 +1,25 @@
+#pragma once
+// In-memory Preferences; contents survive begin()/end() like real NVS
+#include <Arduino.h>
+
+class Preferences {
+public:
+  bool begin(const char* name, bool readOnly = false);
+  void end() {}
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+
+  size_t putInt(const char* key, int32_t value);
+  int32_t getInt(const char* key, int32_t defaultValue = 0);
+  size_t putUInt(const char* key, uint32_t value);
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  size_t putBytes(const char* key, const void* value, size_t len);
+  size_t getBytes(const char* key, void* buf, size_t maxLen);
+  size_t getBytesLength(const char* key);
+
+  static uint32_t writeCount();     // total put* calls (flash wear in tests)
+
+private:
+  std::string ns;
+};
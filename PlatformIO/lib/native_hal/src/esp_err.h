@@ -0,0 +1,6 @@
+#pragma once
+// Minimal IDF error codes for the fakes that return esp_err_t
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+#define ESP_ERR_NOT_FOUND 0x105
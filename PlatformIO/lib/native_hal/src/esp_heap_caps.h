@@ -0,0 +1,11 @@
+#pragma once
+// Minimal heap_caps API: one scripted 8-bit heap (fake::setHeap()). The
+// minimum tracks the lowest free size scripted since reset().
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
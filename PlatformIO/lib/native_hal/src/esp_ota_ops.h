@@ -0,0 +1,22 @@
+#pragma once
+// Minimal OTA/rollback API: one running partition whose image state tests
+// script with fake::setOtaPendingVerify(); rollback only records the call.
+#include <esp_err.h>
+
+typedef enum {
+  ESP_OTA_IMG_NEW            = 0x0,
+  ESP_OTA_IMG_PENDING_VERIFY = 0x1,
+  ESP_OTA_IMG_VALID          = 0x2,
+  ESP_OTA_IMG_INVALID        = 0x3,
+  ESP_OTA_IMG_ABORTED        = 0x4,
+  ESP_OTA_IMG_UNDEFINED      = -1,
+} esp_ota_img_states_t;
+
+typedef struct {
+  char label[17];
+} esp_partition_t;
+
+const esp_partition_t* esp_ota_get_running_partition();
+esp_err_t esp_ota_get_state_partition(const esp_partition_t* partition, esp_ota_img_states_t* state);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback();
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot();  // fake: records the request and returns ESP_OK
@@ -0,0 +1,4 @@
+#pragma once
+#include <stdint.h>
+// Routing a pad back to SIG_GPIO_OUT_IDX detaches it from LEDC
+void esp_rom_gpio_connect_out_signal(uint32_t gpio_num, uint32_t signal_idx, bool out_inv, bool oen_inv);
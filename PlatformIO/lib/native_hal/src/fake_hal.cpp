@@ -0,0 +1,560 @@
+/*
+  Useless Boxes - Native HAL
+  -------------------------
+  Host implementation of the Arduino-ESP32 calls the firmware makes.
+  Single-threaded: tests drive controlLoop()/networkLoop() themselves
+  and move the virtual clock forward. See fake_hal.h.
+  -------------------------
+*/
+#include "fake_hal.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <ArduinoIoTCloud.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <soc/soc.h>
+#include <soc/gpio_reg.h>
+#include <soc/gpio_sig_map.h>
+#include <esp_rom_crc.h>
+#include <esp_rom_gpio.h>
+#include <esp_ota_ops.h>
+#include <esp_heap_caps.h>
+#include <stdarg.h>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace {
+  struct PinState {
+    int mode = -1;
+    int output = LOW;
+    int input = LOW;
+    int analog = -1;
+    int ledcChannel = -1;
+    void (*isr)(void) = nullptr;
+    int isrMode = 0;
+  };
+
+  struct LedcChannel {
+    uint32_t frequency = 0;
+    uint8_t resolution = 0;
+    uint32_t duty = 0;
+    uint32_t writes = 0;        // ledcWrite + ledcChangeFrequency calls
+    uint32_t starts = 0;        // silent -> sounding, or retuned while sounding
+  };
+
+  uint64_t clockUs = 0;
+  PinState pins[fake::PIN_COUNT];
+  LedcChannel ledc[fake::LEDC_CHANNELS];
+  unsigned toneHz = 0;
+  uint64_t toneEndsUs = 0;      // 0: until noTone()
+  uint32_t toneCalls = 0;
+  std::string serialIn;
+  std::string serialOut;
+  bool serialEcho = false;
+  uint32_t notifications = 0;
+  int taskHandleStorage = 0;
+
+  struct CloudProperty {
+    void* address;
+    void (*callback)(void);
+  };
+  std::vector<CloudProperty> cloudProperties;
+  std::deque<void (*)(void)> cloudPendingCallbacks;
+  void (*cloudConnectCallback)(void) = nullptr;
+  bool cloudIsConnected = true;
+  bool cloudConnectAnnounced = false;
+  onOTARequestCallbackFunc cloudOtaCallback = nullptr;
+  Property cloudPropertyHandle;
+
+  esp_partition_t runningPartition = { "app0" };
+  esp_ota_img_states_t runningImageState = ESP_OTA_IMG_VALID;
+  bool rollbackRequested = false;
+
+  constexpr size_t FAKE_HEAP_FREE = 262144;
+  constexpr size_t FAKE_HEAP_LARGEST = 114688;
+  size_t heapFree = FAKE_HEAP_FREE;
+  size_t heapMinFree = FAKE_HEAP_FREE;
+  size_t heapLargest = FAKE_HEAP_LARGEST;
+
+  struct StoredValue {
+    std::vector<uint8_t> bytes;
+  };
+  std::map<std::string, StoredValue> nvs;
+  uint32_t nvsWrites = 0;
+
+  bool validPin(int pin) { return pin >= 0 && pin < fake::PIN_COUNT; }
+
+  int readPin(int pin) {
+    if (!validPin(pin)) return LOW;
+    const PinState& p = pins[pin];
+    return (p.mode == INPUT || p.mode == INPUT_PULLUP) ? p.input : p.output;
+  }
+
+  void expireTone() {
+    if (toneEndsUs != 0 && clockUs >= toneEndsUs) {
+      toneHz = 0;
+      toneEndsUs = 0;
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+// Test controls
+// ------------------------------------------------------------------
+namespace fake {
+  void reset() {
+    clockUs = 0;
+    for (auto& p : pins) p = PinState();
+    for (auto& c : ledc) c = LedcChannel();
+    toneHz = 0;
+    toneEndsUs = 0;
+    toneCalls = 0;
+    serialIn.clear();
+    serialOut.clear();
+    notifications = 0;
+    cloudProperties.clear();
+    cloudPendingCallbacks.clear();
+    cloudConnectCallback = nullptr;
+    cloudIsConnected = true;
+    cloudConnectAnnounced = false;
+    cloudOtaCallback = nullptr;
+    heapFree = heapMinFree = FAKE_HEAP_FREE;
+    heapLargest = FAKE_HEAP_LARGEST;
+  }
+
+  void clearPreferences() {
+    nvs.clear();
+    nvsWrites = 0;
+  }
+
+  uint64_t nowUs() { return clockUs; }
+  void advanceUs(uint64_t us) { clockUs += us; expireTone(); }
+  void advanceMs(unsigned long ms) { advanceUs((uint64_t)ms * 1000); }
+
+  void setInput(int pin, int level) {
+    if (!validPin(pin)) return;
+    PinState& p = pins[pin];
+    int before = readPin(pin);
+    p.input = level ? HIGH : LOW;
+    int after = readPin(pin);
+    if (!p.isr || before == after) return;
+    bool fire = p.isrMode == CHANGE || (p.isrMode == RISING && after == HIGH) ||
+                (p.isrMode == FALLING && after == LOW);
+    if (fire) p.isr();
+  }
+
+  int pinLevel(int pin) { return readPin(pin); }
+  int pinMode(int pin) { return validPin(pin) ? pins[pin].mode : -1; }
+
+  int analogValue(int pin) { return validPin(pin) ? pins[pin].analog : -1; }
+  uint32_t ledcDuty(int channel) {
+    return (channel >= 0 && channel < LEDC_CHANNELS) ? ledc[channel].duty : 0;
+  }
+  int ledcPinChannel(int pin) { return validPin(pin) ? pins[pin].ledcChannel : -1; }
+  int pwmDuty(int pin) {
+    int channel = ledcPinChannel(pin);
+    return channel < 0 ? -1 : (int)ledc[channel].duty;
+  }
+
+  unsigned toneFrequency() { expireTone(); return toneHz; }
+  uint32_t toneStarts() { return toneCalls; }
+  uint32_t ledcFrequency(int channel) {
+    return (channel >= 0 && channel < LEDC_CHANNELS) ? ledc[channel].frequency : 0;
+  }
+  uint32_t ledcWrites(int channel) {
+    return (channel >= 0 && channel < LEDC_CHANNELS) ? ledc[channel].writes : 0;
+  }
+
+  unsigned soundFrequency(int pin) {
+    int channel = ledcPinChannel(pin);
+    if (channel >= 0 && ledc[channel].duty > 0) return ledc[channel].frequency;
+    return toneFrequency();
+  }
+
+  uint32_t soundStarts(int pin) {
+    int channel = ledcPinChannel(pin);
+    return toneCalls + (channel >= 0 ? ledc[channel].starts : 0);
+  }
+
+  void serialInput(const char* text) { serialIn += text; }
+  std::string& serialOutput() { return serialOut; }
+  void setSerialEcho(bool echo) { serialEcho = echo; }
+
+  uint32_t takeNotifications() {
+    uint32_t n = notifications;
+    notifications = 0;
+    return n;
+  }
+
+  void cloudWrite(String& property, const char* value) {
+    property = value;
+    for (const CloudProperty& p : cloudProperties) {
+      if (p.address == (void*)&property && p.callback) cloudPendingCallbacks.push_back(p.callback);
+    }
+  }
+
+  bool cloudConnected() { return cloudIsConnected; }
+  void setCloudConnected(bool connected) {
+    cloudIsConnected = connected;
+    if (!connected) cloudConnectAnnounced = false;
+  }
+
+  bool cloudOfferOta() { return cloudOtaCallback ? cloudOtaCallback() : true; }
+
+  void setOtaPendingVerify(bool pending) {
+    runningImageState = pending ? ESP_OTA_IMG_PENDING_VERIFY : ESP_OTA_IMG_VALID;
+    rollbackRequested = false;
+  }
+  bool otaPendingVerify() { return runningImageState == ESP_OTA_IMG_PENDING_VERIFY; }
+  bool otaRollbackRequested() { return rollbackRequested; }
+
+  void setHeap(size_t freeBytes, size_t largestBlock) {
+    heapFree = freeBytes;
+    heapLargest = largestBlock < freeBytes ? largestBlock : freeBytes;
+    if (heapFree < heapMinFree) heapMinFree = heapFree;
+  }
+}
+
+// ------------------------------------------------------------------
+// Arduino core
+// ------------------------------------------------------------------
+HardwareSerial Serial;
+
+unsigned long millis() { return (unsigned long)(clockUs / 1000); }
+unsigned long micros() { return (unsigned long)clockUs; }
+void delay(unsigned long ms) { fake::advanceMs(ms); }
+void delayMicroseconds(unsigned int us) { fake::advanceUs(us); }
+int64_t esp_timer_get_time(void) { return (int64_t)clockUs; }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (!validPin(pin)) return;
+  pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP) pins[pin].input = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (validPin(pin)) pins[pin].output = level ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) { return readPin(pin); }
+
+void analogWrite(uint8_t pin, int value) {
+  if (validPin(pin)) pins[pin].analog = value;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode) {
+  if (!validPin(interrupt)) return;
+  pins[interrupt].isr = isr;
+  pins[interrupt].isrMode = mode;
+}
+
+void detachInterrupt(uint8_t interrupt) {
+  if (validPin(interrupt)) pins[interrupt].isr = nullptr;
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+  (void)pin;
+  toneHz = frequency;
+  toneEndsUs = duration ? clockUs + (uint64_t)duration * 1000 : 0;
+  toneCalls++;
+}
+
+void noTone(uint8_t pin) {
+  (void)pin;
+  toneHz = 0;
+  toneEndsUs = 0;
+}
+
+uint32_t ledcSetup(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+  if (channel >= fake::LEDC_CHANNELS) return 0;
+  ledc[channel].frequency = frequency;
+  ledc[channel].resolution = resolution;
+  return frequency;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {
+  if (validPin(pin) && channel < fake::LEDC_CHANNELS) pins[pin].ledcChannel = channel;
+}
+
+void ledcDetachPin(uint8_t pin) {
+  if (validPin(pin)) pins[pin].ledcChannel = -1;
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+  if (channel >= fake::LEDC_CHANNELS) return;
+  LedcChannel& c = ledc[channel];
+  if (duty > 0 && c.duty == 0) c.starts++;
+  c.duty = duty;
+  c.writes++;
+}
+
+uint32_t ledcRead(uint8_t channel) { return fake::ledcDuty(channel); }
+
+uint32_t ledcChangeFrequency(uint8_t channel, uint32_t frequency, uint8_t resolution) {
+  if (channel >= fake::LEDC_CHANNELS) return 0;
+  LedcChannel& c = ledc[channel];
+  if (c.duty > 0 && c.frequency != frequency) c.starts++;
+  c.writes++;
+  return ledcSetup(channel, frequency, resolution);
+}
+
+void esp_rom_gpio_connect_out_signal(uint32_t gpio_num, uint32_t signal_idx, bool, bool) {
+  if (signal_idx == SIG_GPIO_OUT_IDX && validPin(gpio_num)) pins[gpio_num].ledcChannel = -1;
+}
+
+uint32_t fakeRegRead(uintptr_t reg) {
+  uint32_t value = 0;
+  int base = (reg == GPIO_IN1_REG) ? 32 : 0;
+  if (reg != GPIO_IN_REG && reg != GPIO_IN1_REG) return 0;
+  for (int bit = 0; bit < 32 && base + bit < fake::PIN_COUNT; bit++) {
+    if (readPin(base + bit)) value |= (uint32_t)1 << bit;
+  }
+  return value;
+}
+
+void fakeRegWrite(uintptr_t reg, uint32_t value) {
+  int base = (reg == GPIO_OUT1_W1TS_REG || reg == GPIO_OUT1_W1TC_REG) ? 32 : 0;
+  bool set = (reg == GPIO_OUT_W1TS_REG || reg == GPIO_OUT1_W1TS_REG);
+  for (int bit = 0; bit < 32 && base + bit < fake::PIN_COUNT; bit++) {
+    if (value & ((uint32_t)1 << bit)) pins[base + bit].output = set ? HIGH : LOW;
+  }
+}
+
+uint32_t esp_random(void) { return (uint32_t)rand(); }
+long random(long max) { return max > 0 ? rand() % max : 0; }
+long random(long min, long max) { return max > min ? min + rand() % (max - min) : min; }
+void configTime(long, int, const char*, const char*, const char*) {}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= buf[i];
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+// ------------------------------------------------------------------
+// Print / Serial
+// ------------------------------------------------------------------
+size_t Print::write(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) write(data[i]);
+  return len;
+}
+
+size_t Print::print(long value, int base) {
+  if (base == 10) return printf("%ld", value);
+  return value < 0 ? print('-') + print((unsigned long)-value, base) : print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  if (base == 16) return printf("%lX", value);
+  if (base == 8) return printf("%lo", value);
+  if (base == 2) {
+    char bits[65];
+    int n = 0;
+    do { bits[n++] = '0' + (value & 1); value >>= 1; } while (value && n < 64);
+    size_t written = 0;
+    while (n) written += print(bits[--n]);
+    return written;
+  }
+  return printf("%lu", value);
+}
+
+size_t Print::print(double value, int digits) { return printf("%.*f", digits, value); }
+
+size_t Print::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (n < 0) return 0;
+  size_t len = (size_t)n < sizeof(buffer) ? (size_t)n : sizeof(buffer) - 1;
+  return write((const uint8_t*)buffer, len);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  serialOut += (char)c;
+  if (serialEcho) putchar(c);
+  return 1;
+}
+
+int HardwareSerial::available() { return (int)serialIn.size(); }
+
+int HardwareSerial::read() {
+  if (serialIn.empty()) return -1;
+  int c = (unsigned char)serialIn[0];
+  serialIn.erase(0, 1);
+  return c;
+}
+
+int HardwareSerial::peek() { return serialIn.empty() ? -1 : (unsigned char)serialIn[0]; }
+
+// ------------------------------------------------------------------
+// FreeRTOS
+// ------------------------------------------------------------------
+struct FakeQueue {
+  size_t itemSize;
+  size_t capacity;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t,
+                                   TaskHandle_t* handle, BaseType_t) {
+  if (handle) *handle = &taskHandleStorage;
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+void vTaskDelay(TickType_t ticks) { fake::advanceMs(ticks); }
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 4096; }
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t) {
+  uint32_t n = notifications;
+  notifications = clear ? 0 : (n ? n - 1 : 0);
+  return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+  notifications++;
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t* woken) {
+  notifications++;
+  if (woken) *woken = pdFALSE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  FakeQueue* q = new FakeQueue();
+  q->itemSize = itemSize;
+  q->capacity = length;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+  if (!q || q->items.size() >= q->capacity) return pdFALSE;
+  const uint8_t* bytes = (const uint8_t*)item;
+  q->items.push_back(std::vector<uint8_t>(bytes, bytes + q->itemSize));
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) {
+  if (woken) *woken = pdFALSE;
+  return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+  if (!q || q->items.empty()) return pdFALSE;
+  memcpy(item, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return q ? (UBaseType_t)q->items.size() : 0; }
+
+// ------------------------------------------------------------------
+// Preferences (one flat store; namespaces are not separated)
+// ------------------------------------------------------------------
+bool Preferences::begin(const char* name, bool) { ns = name ? name : ""; return true; }
+bool Preferences::clear() { nvs.clear(); nvsWrites++; return true; }
+bool Preferences::remove(const char* key) { nvsWrites++; return nvs.erase(key) > 0; }
+bool Preferences::isKey(const char* key) { return nvs.count(key) > 0; }
+
+size_t Preferences::putInt(const char* key, int32_t value) { return putBytes(key, &value, sizeof(value)); }
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+  int32_t value = defaultValue;
+  return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+size_t Preferences::putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  uint32_t value = defaultValue;
+  return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+  const uint8_t* bytes = (const uint8_t*)value;
+  nvs[key].bytes.assign(bytes, bytes + len);
+  nvsWrites++;
+  return len;
+}
+
+// Like the ESP32 implementation: 0 if missing or larger than the buffer
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+  auto it = nvs.find(key);
+  if (it == nvs.end() || it->second.bytes.size() > maxLen) return 0;
+  memcpy(buf, it->second.bytes.data(), it->second.bytes.size());
+  return it->second.bytes.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+  auto it = nvs.find(key);
+  return it == nvs.end() ? 0 : it->second.bytes.size();
+}
+
+uint32_t Preferences::writeCount() { return nvsWrites; }
+
+// ------------------------------------------------------------------
+// ArduinoIoTCloud
+// ------------------------------------------------------------------
+ArduinoIoTCloudTCP ArduinoCloud;
+
+Property& ArduinoIoTCloudTCP::registerProperty(void* address, void (*callback)(void)) {
+  cloudProperties.push_back(CloudProperty{ address, callback });
+  return cloudPropertyHandle;
+}
+
+void ArduinoIoTCloudTCP::addCallback(ArduinoIoTCloudEvent event, void (*callback)(void)) {
+  if (event == ArduinoIoTCloudEvent::CONNECT) cloudConnectCallback = callback;
+}
+
+void ArduinoIoTCloudTCP::onOTARequestCb(onOTARequestCallbackFunc callback) {
+  cloudOtaCallback = callback;
+}
+
+int ArduinoIoTCloudTCP::connected() { return cloudIsConnected ? 1 : 0; }
+
+// Like the real client, property callbacks run from inside update()
+void ArduinoIoTCloudTCP::update() {
+  if (!cloudIsConnected) return;
+  if (!cloudConnectAnnounced) {
+    cloudConnectAnnounced = true;
+    if (cloudConnectCallback) cloudConnectCallback();
+  }
+  while (!cloudPendingCallbacks.empty()) {
+    void (*callback)(void) = cloudPendingCallbacks.front();
+    cloudPendingCallbacks.pop_front();
+    callback();
+  }
+}
+
+// ------------------------------------------------------------------
+// esp_ota_ops
+// ------------------------------------------------------------------
+const esp_partition_t* esp_ota_get_running_partition() { return &runningPartition; }
+
+esp_err_t esp_ota_get_state_partition(const esp_partition_t* partition, esp_ota_img_states_t* state) {
+  if (partition != &runningPartition) return ESP_ERR_NOT_FOUND;
+  *state = runningImageState;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() {
+  runningImageState = ESP_OTA_IMG_VALID;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot() {
+  rollbackRequested = true;
+  return ESP_OK;
+}
+
+// ------------------------------------------------------------------
+// esp_heap_caps
+// ------------------------------------------------------------------
+size_t heap_caps_get_free_size(uint32_t) { return heapFree; }
+size_t heap_caps_get_minimum_free_size(uint32_t) { return heapMinFree; }
+size_t heap_caps_get_largest_free_block(uint32_t) { return heapLargest; }
@@ -0,0 +1,71 @@
+#pragma once
+// fake_hal.h — test-side controls for the native HAL (env:native only)
+#ifndef FAKE_HAL_H
+#define FAKE_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class String;
+
+// ------------------------------------------------------------------
+// Everything the firmware sees as hardware lives here: a virtual clock,
+// a GPIO table whose inputs tests drive (firing attached ISRs), captured
+// analogWrite/LEDC/tone output, scripted Serial input, an in-memory
+// Preferences store and a cloud property table.
+// ------------------------------------------------------------------
+namespace fake {
+  constexpr int PIN_COUNT = 64;
+  constexpr int LEDC_CHANNELS = 8;
+
+  void reset();                         // clock, pins, serial, cloud; keeps NVS
+  void clearPreferences();              // wipe the NVS store
+
+  // Virtual clock
+  uint64_t nowUs();
+  void advanceUs(uint64_t us);
+  void advanceMs(unsigned long ms);
+
+  // GPIO: inputs are driven by the test, outputs captured from firmware
+  void setInput(int pin, int level);    // fires attached ISRs on a change
+  int pinLevel(int pin);                // what digitalRead() would return
+  int pinMode(int pin);
+
+  // PWM / tone
+  int analogValue(int pin);             // last analogWrite(), -1 if none
+  uint32_t ledcDuty(int channel);
+  int ledcPinChannel(int pin);          // -1 if not attached to LEDC
+  int pwmDuty(int pin);                 // attached channel's duty, -1 if none
+  unsigned toneFrequency();             // 0 while silent
+  uint32_t toneStarts();                // tone() calls since reset
+  uint32_t ledcFrequency(int channel);
+  uint32_t ledcWrites(int channel);     // ledcWrite/ledcChangeFrequency calls
+  // Audible output on a pin, whichever of tone() or LEDC drives it
+  unsigned soundFrequency(int pin);     // 0 while silent
+  uint32_t soundStarts(int pin);        // tones started (incl. retunes while sounding)
+
+  // Serial
+  void serialInput(const char* text);   // queued for Serial.read()
+  std::string& serialOutput();          // everything printed since reset
+  void setSerialEcho(bool echo);        // also copy output to stdout
+
+  // FreeRTOS task notifications the firmware has sent itself
+  uint32_t takeNotifications();
+
+  // Cloud: write a property as if it came from the dashboard
+  void cloudWrite(String& property, const char* value);
+  bool cloudConnected();
+  void setCloudConnected(bool connected);
+  bool cloudOfferOta();                 // ask the OTA gate as the cloud would; true = download may start
+
+  // OTA image state of the running partition; kept across reset() like NVS
+  void setOtaPendingVerify(bool pending);
+  bool otaPendingVerify();
+  bool otaRollbackRequested();          // esp_ota_mark_app_invalid_rollback_and_reboot() called
+
+  // 8-bit heap as heap_caps_* reports it; reset() restores a fresh boot
+  void setHeap(size_t freeBytes, size_t largestBlock);
+}
+
+#endif // FAKE_HAL_H
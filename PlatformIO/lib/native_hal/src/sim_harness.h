@@ -0,0 +1,105 @@
+#pragma once
+// sim_harness.h — drive the firmware's control/network loops on the host
+#ifndef SIM_HARNESS_H
+#define SIM_HARNESS_H
+
+#include <Arduino.h>
+#include "fake_hal.h"
+#include "Useless_Boxes.h"
+#include "log.h"
+
+void setup();
+
+// ------------------------------------------------------------------
+// Mirrors the two FreeRTOS tasks: after each control pass the clock jumps
+// to the next scheduler deadline (or 1 ms on a notification), and the
+// network loop runs at least every NETWORK_TASK_INTERVAL_MS. That lets a
+// test replay hours of box time in well under a second. The log task is
+// folded in too: anything logged is printed by the end of each pass.
+// ------------------------------------------------------------------
+namespace sim {
+  inline void boot() {
+    fake::reset();
+    setup();
+    logFlush();
+  }
+
+  // One pass of both loops at the current virtual time
+  inline void step() {
+    networkLoop();
+    controlLoop();
+    logFlush();
+  }
+
+  inline void runFor(unsigned long ms) {
+    unsigned long end = millis() + ms;
+    unsigned long nextNetwork = millis();
+    while ((long)(end - millis()) > 0) {
+      if ((long)(millis() - nextNetwork) >= 0) {
+        networkLoop();
+        nextNetwork = millis() + NETWORK_TASK_INTERVAL_MS;
+      }
+      controlLoop();
+      logFlush();
+      unsigned long wait = fake::takeNotifications() ? 1 : (unsigned long)ticksUntilNextWake();
+      if (wait == 0) wait = 1;
+      unsigned long untilNetwork = nextNetwork - millis();
+      if (untilNetwork > 0 && untilNetwork < wait) wait = untilNetwork;
+      unsigned long left = end - millis();
+      if (left < wait) wait = left;
+      fake::advanceMs(wait);
+    }
+  }
+
+  // Hold a button-style input LOW for `ms`, then release it
+  inline void press(int pin, unsigned long ms) {
+    fake::setInput(pin, LOW);
+    runFor(ms);
+    fake::setInput(pin, HIGH);
+  }
+
+  // Switch off, arm home on the limit, and the debounce settled
+  inline void settleAtRest() {
+    fake::setInput(SWITCH_PIN, LOW);
+    fake::setInput(LIMIT_PIN, HIGH);
+    runFor(100);
+  }
+
+  // Switch on, then another box claims: the arm starts its forward stroke.
+  // With `pressLimit` the limit input drops too, as the arm leaves it.
+  inline void startForwardStroke(bool pressLimit) {
+    fake::setInput(SWITCH_PIN, HIGH);
+    runFor(50);
+    fake::cloudWrite(active_box, "TREVOR");
+    runFor(1);
+    if (pressLimit) fake::setInput(LIMIT_PIN, LOW);
+  }
+
+  // EN1 on, from the LEDC channel or as a plain GPIO
+  inline bool motorEnabled() {
+    int duty = fake::pwmDuty(EN1);
+    return duty > 0 || (duty < 0 && fake::pinLevel(EN1) == HIGH);
+  }
+
+  // +1 forward, -1 reverse, 0 stopped — as the H-bridge sees it
+  inline int motorDrive() {
+    if (!motorEnabled()) return 0;
+    bool in1 = fake::pinLevel(IN1) == HIGH;
+    bool in2 = fake::pinLevel(IN2) == HIGH;
+    if (in1 && !in2) return 1;
+    if (in2 && !in1) return -1;
+    return 0;
+  }
+
+  // The box named by the cloud `active_box` (the stamp is in `active_stamp`)
+  inline std::string cloudActive() {
+    return active_box.c_str();
+  }
+
+  inline bool outputContains(const char* text) {
+    logFlush();
+    return fake::serialOutput().find(text) != std::string::npos;
+  }
+}
+
+#endif // SIM_HARNESS_H
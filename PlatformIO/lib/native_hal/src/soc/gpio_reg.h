@@ -0,0 +1,8 @@
+#pragma once
+// Symbolic register "addresses" understood by fakeRegRead/fakeRegWrite
+#define GPIO_OUT_W1TS_REG   0x0008
+#define GPIO_OUT_W1TC_REG   0x000C
+#define GPIO_OUT1_W1TS_REG  0x0014
+#define GPIO_OUT1_W1TC_REG  0x0018
+#define GPIO_IN_REG         0x003C
+#define GPIO_IN1_REG        0x0040
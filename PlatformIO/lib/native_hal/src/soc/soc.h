@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+// GPIO register access is routed through the fake pin table
+uint32_t fakeRegRead(uintptr_t reg);
+void fakeRegWrite(uintptr_t reg, uint32_t value);
+#define REG_READ(r) fakeRegRead((uintptr_t)(r))
+#define REG_WRITE(r, v) fakeRegWrite((uintptr_t)(r), (v))
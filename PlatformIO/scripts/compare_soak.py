@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Diff the SOAK_RESULT lines of two soak runs (env:arduino_nano_esp32_soak_*).
+
+Each argument is a serial capture (or a file holding just the JSON); the
+last SOAK_RESULT line in it is used. Prints every numeric field as
+base / new / change and exits 1 when a gated field got worse by more than
+the threshold: p50, p90, p99 and mean of every timing, timeouts, NVS writes
+and heap (free_end, min_free, largest_end lower is worse). min/max are
+shown but not gated, since a single slow sample moves them, and timing
+changes smaller than --floor microseconds are never regressions (a 2 us
+stage going to 3 us is noise). The summary format is documented in
+include/soak_test.h.
+
+  python scripts/compare_soak.py base.log new.log
+  python scripts/compare_soak.py base.log new.log --threshold 5
+"""
+import argparse
+import json
+import sys
+
+MARKER = "SOAK_RESULT "
+GATED_STATS = ("p50", "p90", "p99", "mean")
+HIGHER_IS_BETTER = ("heap.free_end", "heap.min_free", "heap.largest_end")
+NOT_COMPARED = ("soak", "cycles", "done", "run_ms", "heap.free_start")
+
+
+def load(path):
+    result = None
+    with open(path, errors="replace") as f:
+        for line in f:
+            at = line.find(MARKER)
+            if at >= 0:
+                result = line[at + len(MARKER):]
+            elif line.lstrip().startswith("{"):
+                result = line
+    if result is None:
+        sys.exit("%s: no SOAK_RESULT line" % path)
+    return json.loads(result)
+
+
+def flatten(value, prefix=""):
+    out = {}
+    for key, item in value.items():
+        name = prefix + key
+        if isinstance(item, dict):
+            out.update(flatten(item, name + "."))
+        elif isinstance(item, (int, float)) and not isinstance(item, bool):
+            out[name] = item
+    return out
+
+
+def is_timing(name):
+    return name.startswith(("react.", "loop_us."))
+
+
+def gated(name):
+    if name in NOT_COMPARED:
+        return False
+    if is_timing(name):
+        return name.rsplit(".", 1)[1] in GATED_STATS
+    return True
+
+
+def worse_by(name, base, new):
+    """Percent by which `new` is worse than `base` (negative: better)."""
+    if base == new:
+        return 0.0
+    if base == 0:
+        return float("inf") if (new < base if name in HIGHER_IS_BETTER else new > base) else 0.0
+    change = (new - base) * 100.0 / base
+    return -change if name in HIGHER_IS_BETTER else change
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Diff two soak-test summaries.")
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=10.0, help="allowed regression in percent (default 10)")
+    parser.add_argument("--floor", type=float, default=20.0, help="timing changes below this many us are noise (default 20)")
+    args = parser.parse_args()
+
+    base_run, new_run = load(args.base), load(args.new)
+    print("base: %s (%s, %s cycles)" % (base_run.get("fw"), base_run.get("mode"), base_run.get("done")))
+    print("new:  %s (%s, %s cycles)" % (new_run.get("fw"), new_run.get("mode"), new_run.get("done")))
+    if base_run.get("mode") != new_run.get("mode"):
+        print("warning: runs used different modes", file=sys.stderr)
+
+    base, new = flatten(base_run), flatten(new_run)
+    regressions = []
+    print("%-28s %12s %12s %9s" % ("field", "base", "new", "change"))
+    for name in sorted(set(base) | set(new)):
+        if name not in base or name not in new:
+            print("%-28s %12s %12s %9s" % (name, base.get(name, "-"), new.get(name, "-"), "n/a"))
+            continue
+        worse = worse_by(name, base[name], new[name])
+        flag = ""
+        noise = is_timing(name) and abs(new[name] - base[name]) < args.floor
+        if gated(name) and not noise and worse > args.threshold:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        change = "%+.1f%%" % ((new[name] - base[name]) * 100.0 / base[name]) if base[name] else "-"
+        print("%-28s %12s %12s %9s%s" % (name, base[name], new[name], change, flag))
+
+    if regressions:
+        print("\n%d field(s) regressed by more than %.1f%%: %s" % (len(regressions), args.threshold,
+                                                                 ", ".join(regressions)))
+        sys.exit(1)
+    print("\nno regressions beyond %.1f%%" % args.threshold)
+
+
+if __name__ == "__main__":
+    main()
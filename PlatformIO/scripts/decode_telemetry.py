@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Decode `telemetry` cloud values into event rows.
+
+Reads one value per line (e.g. an export of the property history) and
+prints seq, absolute ms, wall-clock ms, event type, aux and value as CSV.
+"t2:<seq>:<wall ms>:<millis>:<base64>" values carry the box's clock pair,
+so each event's ms maps to wall time; "t1:<seq>:<base64>" values leave the
+wall column empty. The batch layout is documented in include/telemetry.h.
+
+  python scripts/decode_telemetry.py < telemetry.txt
+  python scripts/decode_telemetry.py "t1:3:AwDIAQEA..."
+"""
+import base64
+import sys
+
+TYPES = {
+    1: "switch",
+    2: "motor_start",
+    3: "motor_stop",
+    4: "stroke",
+    5: "stall",
+    6: "claim_arrival",
+    7: "claim_publish",
+    8: "cloud_connect",
+    9: "cloud_disconnect",
+}
+
+
+def varint(data, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(data):
+            raise ValueError("truncated varint")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode(text):
+    version, seq_text, payload = text.strip().split(":", 2)
+    offset = None  # wall ms minus box ms
+    if version == "t2":
+        wall_text, clock_text, payload = payload.split(":", 2)
+        offset = int(wall_text) - int(clock_text)
+    elif version != "t1":
+        raise ValueError("unknown telemetry version " + version)
+    data = base64.b64decode(payload)
+    seq, pos = varint(data, 0)
+    if seq != int(seq_text):
+        raise ValueError("seq mismatch")
+    at, pos = varint(data, pos)
+    dropped, pos = varint(data, pos)
+    rows = []
+    while pos < len(data):
+        delta, pos = varint(data, pos)
+        if pos + 2 > len(data):
+            raise ValueError("truncated event")
+        kind, aux = data[pos], data[pos + 1]
+        value, pos = varint(data, pos + 2)
+        at += delta
+        wall = "" if offset is None else str(at + offset)
+        rows.append((seq, at, wall, TYPES.get(kind, str(kind)), aux, value))
+    return dropped, rows
+
+
+def main():
+    lines = sys.argv[1:] or sys.stdin
+    print("seq,ms,wall_ms,type,aux,value")
+    for line in lines:
+        if not line.strip():
+            continue
+        dropped, rows = decode(line)
+        if dropped:
+            print("# batch dropped %d events before it" % dropped, file=sys.stderr)
+        for row in rows:
+            print("%d,%d,%s,%s,%d,%d" % row)
+
+
+if __name__ == "__main__":
+    main()
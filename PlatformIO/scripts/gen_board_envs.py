@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Regenerate the per-box envs in platformio.ini from include/boards.def.
+
+Each BOARD(<ID>, ...) row gets a flashing env, a latency bench env and a
+soak-test env.
+Everything between the BEGIN/END markers in platformio.ini is replaced;
+the rest of the file is left alone.
+
+  python scripts/gen_board_envs.py          rewrite platformio.ini
+  python scripts/gen_board_envs.py --check  exit 1 if it is out of date
+"""
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BOARDS_DEF = os.path.join(ROOT, "include", "boards.def")
+INI = os.path.join(ROOT, "platformio.ini")
+BEGIN = "; BEGIN generated board envs (scripts/gen_board_envs.py, edit include/boards.def)"
+END = "; END generated board envs"
+
+
+def board_ids():
+    ids = []
+    with open(BOARDS_DEF) as f:
+        for line in f:
+            m = re.match(r"\s*BOARD\(\s*([A-Z][A-Z0-9_]*)\s*,", line)
+            if m:
+                ids.append(m.group(1))
+    if not ids:
+        sys.exit("no BOARD(...) rows in " + BOARDS_DEF)
+    return ids
+
+
+def env_block(board_id):
+    lower = board_id.lower()
+    flags = "-DBOARD_ID=%s -DBOARD_SECRETS_HEADER=\\\"arduino_secrets_%s.h\\\"" % (board_id, lower)
+    return (
+        "[env:arduino_nano_esp32_%s]\n"
+        "extends = env:arduino_nano_esp32\n"
+        "build_flags = %s\n"
+        "\n"
+        "[env:arduino_nano_esp32_bench_%s]\n"
+        "extends = env:arduino_nano_esp32\n"
+        "build_flags = %s -DLATENCY_BENCH -DPEER_LINK_ESPNOW\n"
+        "\n"
+        "[env:arduino_nano_esp32_soak_%s]\n"
+        "extends = env:arduino_nano_esp32\n"
+        "build_flags = %s -DSOAK_TEST -DLOOP_PROFILING\n"
+    ) % (lower, flags, lower, flags, lower, flags)
+
+
+def generate(text):
+    start = text.find(BEGIN)
+    end = text.find(END)
+    if start < 0 or end < start:
+        sys.exit("platformio.ini is missing the generated-env markers")
+    body = "\n".join(env_block(b) for b in board_ids())
+    return text[:start] + BEGIN + "\n" + body + END + text[end + len(END):]
+
+
+def main():
+    with open(INI) as f:
+        current = f.read()
+    updated = generate(current)
+    if "--check" in sys.argv:
+        if updated != current:
+            sys.exit("platformio.ini is out of date: run scripts/gen_board_envs.py")
+        return
+    if updated != current:
+        with open(INI, "w") as f:
+            f.write(updated)
+
+
+if __name__ == "__main__":
+    main()
@@ -10,6 +10,7 @@
   Arduino IoT Cloud Variables description
   The following variables are automatically generated and updated when changes are made to the Thing
 
+  String active_stamp; // READ/WRITE
   String active_box; // READ/WRITE
   
   Variables which are marked as READ/WRITE in the Cloud Thing will also have functions
@@ -18,7 +19,43 @@
 */
 #include <Arduino.h>
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_timer.h>
+#include <esp_rom_crc.h>
+#if defined(RGB_HW_FADE)
+#include <driver/ledc.h>
+#endif
+#if defined(PEER_LINK_ESPNOW)
+#include <WiFi.h>
+#endif
+#if defined(LIGHT_SLEEP_IDLE)
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <esp_wifi.h>
+#include <driver/gpio.h>
+#include <soc/gpio_struct.h>
+#include "latency_histogram.h"
+#endif
+#include <esp_rom_gpio.h>
+#include <soc/gpio_reg.h>
+#include <soc/gpio_sig_map.h>
+#include <soc/soc.h>
 #include "Useless_Boxes.h"
+#include "loop_profiler.h"
+#include "motion_profile.h"
+#include "stroke_stats.h"
+#include "input_debounce.h"
+#include "publish_coalescer.h"
+#include "log.h"
+#include "ota_update.h"
+#include "heap_monitor.h"
+#include "telemetry.h"
+#include "wifi_fast_connect.h"
+#include "peer_link.h"
+#include "latency_bench.h"
+#include "soak_test.h"
 #include "thingProperties.h"
 
 // (Hardware pin mappings live in the header as `constexpr` values)
@@ -37,10 +74,74 @@ unsigned long MOTOR_UPDATE_INTERVAL = DEFAULT_MOTOR_UPDATE_INTERVAL; // ms // Ad
 // ------------------------------------------------------------------
 int currentRGBMode = RGB_RAINBOW;
 unsigned long lastRGBAnimation = 0;
-int rainbowPos = 0;
+int rainbowPos = 0;    // 8.8 fixed-point phase into SINE_TABLE
 int breathValue = 0;
 int breathDir = 1;
 
+// Per-frame lookups (flash-resident; no FPU math on the animation path)
+namespace {
+  // floor(sin(2*pi*i/256) * 127 + 128)
+  const uint8_t SINE_TABLE[256] PROGMEM = {
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 161, 164, 167, 170, 173,
+    176, 179, 182, 185, 187, 190, 193, 195, 198, 201, 203, 206, 208, 210, 213, 215,
+    217, 219, 222, 224, 226, 228, 230, 231, 233, 235, 236, 238, 240, 241, 242, 244,
+    245, 246, 247, 248, 249, 250, 251, 251, 252, 253, 253, 254, 254, 254, 254, 254,
+    255, 254, 254, 254, 254, 254, 253, 253, 252, 251, 251, 250, 249, 248, 247, 246,
+    245, 244, 242, 241, 240, 238, 236, 235, 233, 231, 230, 228, 226, 224, 222, 219,
+    217, 215, 213, 210, 208, 206, 203, 201, 198, 195, 193, 190, 187, 185, 182, 179,
+    176, 173, 170, 167, 164, 161, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+    128, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  94,  91,  88,  85,  82,
+     79,  76,  73,  70,  68,  65,  62,  60,  57,  54,  52,  49,  47,  45,  42,  40,
+     38,  36,  33,  31,  29,  27,  25,  24,  22,  20,  19,  17,  15,  14,  13,  11,
+     10,   9,   8,   7,   6,   5,   4,   4,   3,   2,   2,   1,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   2,   2,   3,   4,   4,   5,   6,   7,   8,   9,
+     10,  11,  13,  14,  15,  17,  19,  20,  22,  24,  25,  27,  29,  31,  33,  36,
+     38,  40,  42,  45,  47,  49,  52,  54,  57,  60,  62,  65,  68,  70,  73,  76,
+     79,  82,  85,  88,  91,  94,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+  };
+
+#if defined(RGB_GAMMA_CORRECTION)
+  // round(255 * (i/255)^2.2)
+  const uint8_t GAMMA_TABLE[256] PROGMEM = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+  };
+#endif
+
+  // Channel value -> PWM duty with brightness scaling (and optional gamma)
+  // and common-anode inversion folded in. Rebuilt only when brightness changes.
+  uint8_t rgbDutyTable[256];
+
+  // 0.05 rad per frame, matching the original sin(rainbowPos * 0.05) speed
+  constexpr uint16_t RAINBOW_PHASE_STEP = 522;
+
+#if defined(RGB_HW_FADE)
+  // Hardware fade bookkeeping. IDF 4.4 can't abort a running fade and a new
+  // fade blocks until the previous one ends, so requests made mid-fade are
+  // parked in rgbPending* and started at the next fade endpoint.
+  const uint8_t RGB_LEDC_CHANNELS[3] = { RGB_LEDC_CHANNEL_R, RGB_LEDC_CHANNEL_G, RGB_LEDC_CHANNEL_B };
+  uint8_t rgbTargetDuty[3] = { 255, 255, 255 };
+  unsigned long rgbFadeEnd = 0;
+  bool rgbPending = false;
+  uint8_t rgbPendingValue[3] = { 0, 0, 0 };
+  uint32_t rgbPendingMs = 0;
+#endif
+}
+
 // Active/Inactive presets (persisted)
 int activeRGBSetting = RGB_RAINBOW;
 int inactiveRGBSetting = RGB_SOLID_RED;
@@ -48,18 +149,72 @@ int activeBuzzerSetting = BUZZER_CHIRP;
 int inactiveBuzzerSetting = BUZZER_SINGLE;
 int rgb_brightness_percentage = DEFAULT_RGB_BRIGHTNESS_PERCENTAGE; // % Setting
 int motorSpeed = 100; // 0-100% - controls PWM duty cycle
+int buzzerVolume = DEFAULT_BUZZER_VOLUME; // 0-100% - buzzer duty cycle
+#if !defined(MOTOR_SOFT_PWM)
+MotionProfile motionProfile = DEFAULT_MOTION_PROFILE; // tunable with the "motion" command
+#endif
 
 // ------------------------------------------------------------------
 // Buzzer state
 // ------------------------------------------------------------------
 int currentBuzzerPattern = BUZZER_OFF;    // active buzzer pattern playback state
-bool buzzerState = false;           // on/off state for looping patterns
-unsigned long buzzerLast = 0;       // last toggle time
+bool buzzerState = false;           // current step is in its on-phase
+unsigned long buzzerLast = 0;       // start of the current phase
 unsigned int buzzerStep = 0;        // step in sequence
 bool buzzerDemo = false;      // true when playing a demo pattern (i.e. for a second
 unsigned long buzzerDemoStart = 0; // start time of demo pattern
 constexpr unsigned long BUZZER_DEMO_DURATION = 5000; // ms
 
+// Tone queue (ring buffer, head = tone currently playing / next to play)
+namespace {
+  BuzzerTone buzzerQueue[BUZZER_QUEUE_CAPACITY];
+  uint8_t buzzerQueueHead = 0;
+  uint8_t buzzerQueueTail = 0;
+  bool buzzerQueueActive = false;   // head entry has been started
+  bool buzzerQueueToneOn = false;   // head entry is in its on-phase
+  unsigned long buzzerQueueStepStart = 0;
+  bool buzzerQueuePreempted = false; // pattern was paused by queued tones
+  constexpr uint8_t BUZZER_QUEUE_MASK = BUZZER_QUEUE_CAPACITY - 1;
+}
+
+// Pattern step tables (const, so they stay in flash). Each step is
+// {freq, on_ms, off_ms}; a 0 Hz step is a rest.
+namespace {
+  constexpr BuzzerTone SINGLE_STEPS[] = { {1000, 120, 0} };
+  constexpr BuzzerTone CHIRP_STEPS[] = { {800, 120, 50}, {1200, 120, 50}, {800, 120, 0} };
+  constexpr BuzzerTone LOOP_STEPS[] = { {1000, BUZZER_INTERVAL, BUZZER_INTERVAL} };
+  constexpr BuzzerTone SOS_STEPS[] = {
+    {900, 150, 150}, {900, 150, 150}, {900, 150, 150},
+    {900, 450, 150}, {900, 450, 150}, {900, 450, 150},
+    {900, 150, 150}, {900, 150, 150}, {900, 150, 150},
+  };
+
+  template <size_t N>
+  constexpr uint8_t stepCount(const BuzzerTone (&)[N]) { return (uint8_t)N; }
+
+  constexpr BuzzerPatternDef BUZZER_PATTERNS[BUZZER_PATTERN_COUNT] = {
+    { "OFF",    nullptr, 0, false },
+    { "SINGLE", SINGLE_STEPS, stepCount(SINGLE_STEPS), false },
+    { "CHIRP",  CHIRP_STEPS, stepCount(CHIRP_STEPS),  false },
+    { "LOOP",   LOOP_STEPS, stepCount(LOOP_STEPS),   true },
+    { "SOS",    SOS_STEPS, stepCount(SOS_STEPS),    false },
+    { "CUSTOM", nullptr, 0, false },      // steps live in customPattern below
+  };
+
+  // BUZZER_CUSTOM: written by the control task only. setCustomBuzzerPattern()
+  // parses into the pending copy, which the control task swaps in.
+  BuzzerTone customSteps[BUZZER_CUSTOM_MAX_STEPS];
+  BuzzerPatternDef customPattern = { "CUSTOM", customSteps, 0, false };
+  BuzzerTone pendingCustomSteps[BUZZER_CUSTOM_MAX_STEPS];
+  uint8_t pendingCustomCount = 0;
+  bool pendingCustomLoop = false;
+  volatile bool customPatternPending = false;
+  portMUX_TYPE customPatternMux = portMUX_INITIALIZER_UNLOCKED;
+
+  const BuzzerPatternDef* playingPattern = &BUZZER_PATTERNS[BUZZER_OFF];
+  unsigned long buzzerStepDue = 0;    // when the current phase ends
+}
+
 // ------------------------------------------------------------------
 // File-local internal state (kept private to this .cpp)
 // ------------------------------------------------------------------
@@ -68,12 +223,10 @@ namespace {
   bool inSubMenu = false;
 
   // Button tracking
-  bool settingsButtonState = HIGH;
-  bool lastSettingsButtonState = HIGH;
+  bool settingsButtonState = HIGH;   // debounced, from INPUT_BUTTON events
   unsigned long pressedTime = 0;
   unsigned long releasedTime = 0;
   bool longPressActive = false;
-  unsigned long lastDebounceTime = 0;
   int shortPressCount = 0;
   int longPressCount  = 0;
   int lastShortPressCount = 0;
@@ -83,24 +236,300 @@ namespace {
 
   // Motor timing / state
   unsigned long lastMotorUpdate = 0;
-  bool switch_forward = false; 
-  bool limit_pressed = false;
+  bool switch_forward = false;   // debounced, from INPUT_SWITCH events
+  bool limit_pressed = false;    // debounced, from INPUT_LIMIT events
   bool stateChanged = false;
   
-  // Motor soft PWM control (dynamic timing based on motorSpeed)
-  int motorDirection = 0;  // 1=forward, -1=reverse, 0=stopped
+  volatile int motorDirection = 0;  // 1=forward, -1=reverse, 0=stopped (read by ISRs)
   bool motorShouldRun = false;  // Motor should be running
+  volatile bool motorCutByISR = false; // EN1 was forced low by an input ISR
+  bool strokeHeldForOta = false;       // a stroke waits for the OTA download to end
+#if defined(MOTOR_SOFT_PWM)
+  // Motor soft PWM control (dynamic timing based on motorSpeed)
   unsigned long lastMotorPWMUpdate = 0;
   bool motorPWMEnabled = false;  // Current state of PWM (on or off)
   const unsigned long MOTOR_PWM_CYCLE_TIME = 10;  // 20ms total cycle
+#else
+  // Hardware PWM: last duty written to the LEDC channel
+  uint32_t motorAppliedDuty = 0;
+
+  // Motion profile state (see motion_profile.h)
+  enum MotionPhase : uint8_t { MOTION_IDLE, MOTION_BRAKE, MOTION_STROKE };
+  MotionPhase motionPhase = MOTION_IDLE;
+  int bridgeDirection = 0;              // what IN1/IN2 currently drive (0 = off/brake)
+  int directionAfterBrake = 0;          // stroke to start when the brake phase ends
+  unsigned long motionPhaseStart = 0;   // millis() the brake or stroke began
+  uint32_t strokeStartUs = 0;
+  uint32_t strokeExpectedMs[2] = { 0, 0 }; // last completed stroke: [forward, reverse]
+#endif
+
+  // Stroke timing / stall watchdog: [0] forward, [1] reverse
+  StrokeStats strokeStats[2];
+  uint32_t strokeStalls = 0;            // stalls since the stats were reset
+  int timedStrokeDirection = 0;         // stroke being timed (0 = none)
+  uint32_t timedStrokeStartUs = 0;
+  unsigned long timedStrokeStartMs = 0;
+  bool stallFault = false;
+  bool strokeStatsDirty = false;
+  unsigned long strokeStatsSavedAt = 0;
+
+  // Snapshot handed to the network task for the motor_stats property
+  portMUX_TYPE strokeTelemetryMux = portMUX_INITIALIZER_UNLOCKED;
+  StrokeStats pendingStrokeStats[2];
+  uint32_t pendingStrokeStalls = 0;
+  bool pendingStallFault = false;
+  bool strokeTelemetryPending = false;
+
+  inline int strokeIndex(int direction) { return direction > 0 ? 0 : 1; }
+}
+static void startStrokeTiming(int direction);
+static void finishStrokeTiming(int direction, uint32_t timestampUs);
+
+// ------------------------------------------------------------------
+// Input edge interrupt state (shared with ISRs — keep in DRAM)
+// ------------------------------------------------------------------
+namespace {
+  DRAM_ATTR InputEdgeEvent inputEdgeQueue[INPUT_EDGE_QUEUE_CAPACITY];
+  DRAM_ATTR volatile uint8_t inputEdgeHead = 0; // consumer (main loop)
+  DRAM_ATTR volatile uint8_t inputEdgeTail = 0; // producer (ISRs)
+  DRAM_ATTR volatile uint32_t inputEdgeDropped = 0;
+  // GPIO numbers resolved at compile time (board_config.h): ISRs use immediates
+  constexpr uint8_t en1Gpio = boardGpio(EN1);
+  constexpr uint8_t switchGpio = boardGpio(SWITCH_PIN);
+  constexpr uint8_t limitGpio = boardGpio(LIMIT_PIN);
+  constexpr uint8_t buttonGpio = boardGpio(BUTTON_PIN);
+  constexpr uint8_t INPUT_EDGE_MASK = INPUT_EDGE_QUEUE_CAPACITY - 1;
+
+  // Control-task side of the pipeline (never touched by the ISRs)
+  struct InputChannelState {
+    DebouncedInput debounce;
+    InputEvent events[INPUT_EVENT_QUEUE_CAPACITY];
+    uint8_t eventHead;
+    uint8_t eventTail;
+    bool motorCutPending;      // the ISR cut EN1 during the current burst
+    uint32_t bouncesFiltered;
+  };
+  InputChannelState inputChannels[INPUT_CHANNEL_COUNT];
+  uint32_t inputEdgeDroppedSeen = 0;
+  constexpr int INPUT_CHANNEL_PINS[INPUT_CHANNEL_COUNT] = { BUTTON_PIN, SWITCH_PIN, LIMIT_PIN };
+  const char* const INPUT_CHANNEL_NAMES[INPUT_CHANNEL_COUNT] = { "button", "switch", "limit" };
+  constexpr uint8_t INPUT_EVENT_MASK = INPUT_EVENT_QUEUE_CAPACITY - 1;
 }
 
+// ------------------------------------------------------------------
+// Active box handoff between the network and control tasks
+// ------------------------------------------------------------------
+namespace {
+  QueueHandle_t activeBoxEventQueue = nullptr;         // cloud -> control
+  portMUX_TYPE activeBoxMux = portMUX_INITIALIZER_UNLOCKED;
+  BoxId pendingActiveBox = BOX_ID_NONE;                // control -> cloud
+  ClaimStamp pendingActiveStamp = { 0, BOX_ID_NONE };
+  bool activeBoxPublishPending = false;
+  PublishCoalescer activeBoxPublisher;                 // network task only
+  ClaimStamp publishStamp = { 0, BOX_ID_NONE };        // network task: stamp of the coalescer's value
+  BoxId cloudBareBox = BOX_ID_NONE;                    // network task: last `active_box` the cloud delivered
+  BoxId stampedBareCopy = BOX_ID_NONE;                 // network task: `active_box` of the stamp just delivered
+  bool stampedCopyDue = false;                         //   until its bare copy arrives (or something else does)
+  BoxId controlActiveBox = BOX_ID_NONE;                // control task's view
+  BoxMask controlActiveMask = 0;                       // one bit per active box
+  ClaimStamp controlActiveStamp = { 0, BOX_ID_NONE };  // stamp of the held claim
+  uint32_t claimClock = 0;                             // Lamport clock (control task)
+  uint32_t claimClockReserved = 0;                     // stored in NVS; the clock stays below it
+  uint32_t staleClaimsIgnored = 0;                     // not newer than the held claim
+  uint32_t staleClaimsAnswered = 0;                    // cloud was behind: our claim written back
+  constexpr const char* CLAIM_CLOCK_KEY = "claim_clock";
+  TaskHandle_t controlTaskHandle = nullptr;
+  TaskHandle_t networkTaskHandle = nullptr;
+}
+
+// ------------------------------------------------------------------
+// Deadline scheduler state: next due time per subsystem (millis)
+// ------------------------------------------------------------------
+namespace {
+  unsigned long wakeDeadline[SCHED_SUBSYSTEM_COUNT];
+  bool wakeArmed[SCHED_SUBSYSTEM_COUNT] = { false };
+}
+
+#if defined(LIGHT_SLEEP_IDLE)
+// ------------------------------------------------------------------
+// Light-sleep idle state
+// ------------------------------------------------------------------
+namespace {
+  esp_pm_lock_handle_t noSleepLock = nullptr;
+  bool pmLightSleepAvailable = false;  // esp_pm_configure() accepted light sleep
+  volatile bool controlIdle = false;   // read by the network task
+  bool noSleepLockHeld = false;
+  bool wakePending = false;            // an event arrived while idle
+  uint32_t wakeEventUs = 0;            // timestamp of that event
+  LatencyHistogram wakeToMotorStart;   // us from wake event to motor start
+}
+#endif
+
 // Preferences (non-volatile storage) instance
 static Preferences prefs;
 
+// ------------------------------------------------------------------
+// Settings cache
+// Setters update RAM and mark the cache dirty; the packed blob is written
+// to NVS once on menu confirm, or SETTINGS_COMMIT_DELAY_MS after the last
+// change, instead of one flash write per button press.
+//
+// Stored record = SettingsHeader + PersistedSettings. Fields are only ever
+// appended (bump SETTINGS_SCHEMA_VERSION when you add one): an older, shorter
+// body loads as a prefix on top of the current defaults, and a newer, longer
+// one is truncated, so both upgrades and downgrades keep existing values.
+// ------------------------------------------------------------------
+namespace {
+  struct __attribute__((packed)) PersistedSettings {
+    int8_t activeRGB;
+    int8_t inactiveRGB;
+    uint8_t rgbBrightness;
+    int8_t activeBuzzer;
+    int8_t inactiveBuzzer;
+    uint8_t motorSpeed;
+    uint8_t buzzerVolume;     // v2
+  };
+
+  struct __attribute__((packed)) SettingsHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t size;      // bytes of body that follow
+    uint32_t crc;      // CRC-32 of those bytes
+  };
+
+  struct __attribute__((packed)) SettingsRecord {
+    SettingsHeader header;
+    PersistedSettings body;
+  };
+
+  constexpr const char* SETTINGS_KEY = "settings";
+  constexpr uint16_t SETTINGS_MAGIC = 0x4255;        // "UB"
+  constexpr uint8_t SETTINGS_SCHEMA_VERSION = 2;
+  constexpr size_t SETTINGS_READ_BUFFER = sizeof(SettingsHeader) + 255; // largest record any schema can write
+  constexpr size_t UNVERSIONED_BLOB_SIZE = 6;        // first blob layout: body only, no header
+  static_assert(sizeof(PersistedSettings) <= 255, "SettingsHeader::size is one byte");
+  static_assert(sizeof(SettingsHeader) > UNVERSIONED_BLOB_SIZE, "record sizes must not collide");
+
+  // Per-setting keys written by older firmware, removed once migrated
+  const char* const LEGACY_SETTING_KEYS[] = {
+    "active_rgb", "inactive_rgb", "rgb_brightness", "active_buzzer", "inactive_buzzer", "motor_speed"
+  };
+
+  PersistedSettings committedSettings;  // what NVS currently holds
+  bool settingsDirty = false;
+  unsigned long settingsChangedAt = 0;  // millis() of the last accepted change
+  bool legacyKeysPresent = false;       // per-key layout still in NVS
+
+  PersistedSettings snapshotSettings() {
+    PersistedSettings s;
+    s.activeRGB = (int8_t)activeRGBSetting;
+    s.inactiveRGB = (int8_t)inactiveRGBSetting;
+    s.rgbBrightness = (uint8_t)rgb_brightness_percentage;
+    s.activeBuzzer = (int8_t)activeBuzzerSetting;
+    s.inactiveBuzzer = (int8_t)inactiveBuzzerSetting;
+    s.motorSpeed = (uint8_t)motorSpeed;
+    s.buzzerVolume = (uint8_t)buzzerVolume;
+    return s;
+  }
+
+  void markSettingsDirty() {
+    settingsDirty = true;
+    settingsChangedAt = millis();
+  }
+
+  uint32_t settingsCrc(const uint8_t* body, size_t len) {
+    return esp_rom_crc32_le(0, body, len);
+  }
+
+  // Reset every out-of-range field to its default in one pass (motor speed is
+  // capped at 100); false if any was off
+  bool validateSettings(PersistedSettings& s) {
+    bool ok = true;
+    if (s.activeRGB < 0 || s.activeRGB >= RGB_MODE_COUNT) { s.activeRGB = RGB_RAINBOW; ok = false; }
+    if (s.inactiveRGB < 0 || s.inactiveRGB >= RGB_MODE_COUNT) { s.inactiveRGB = RGB_SOLID_RED; ok = false; }
+    if (s.rgbBrightness > 100) { s.rgbBrightness = DEFAULT_RGB_BRIGHTNESS_PERCENTAGE; ok = false; }
+    if (s.activeBuzzer < 0 || s.activeBuzzer >= BUZZER_PATTERN_COUNT) { s.activeBuzzer = BUZZER_CHIRP; ok = false; }
+    if (s.inactiveBuzzer < 0 || s.inactiveBuzzer >= BUZZER_PATTERN_COUNT) { s.inactiveBuzzer = BUZZER_SINGLE; ok = false; }
+    if (s.motorSpeed > 100) { s.motorSpeed = 100; ok = false; }
+    if (s.buzzerVolume > 100) { s.buzzerVolume = DEFAULT_BUZZER_VOLUME; ok = false; }
+    return ok;
+  }
+
+  void applyPersistedSettings(const PersistedSettings& s) {
+    activeRGBSetting = s.activeRGB;
+    inactiveRGBSetting = s.inactiveRGB;
+    rgb_brightness_percentage = s.rgbBrightness;
+    activeBuzzerSetting = s.activeBuzzer;
+    inactiveBuzzerSetting = s.inactiveBuzzer;
+    motorSpeed = s.motorSpeed;
+    buzzerVolume = s.buzzerVolume;
+  }
+
+  // Legacy keys held full ints: range-check before narrowing, or 300 would wrap to a legal 44.
+  // An out-of-range value is not clamped: `current` (the default) is kept and `inRange` cleared.
+  int readLegacySetting(const char* key, int current, int lo, int hi, bool& inRange) {
+    int32_t value = prefs.getInt(key, current);
+    if (value >= lo && value <= hi) return value;
+    inRange = false;
+    return current;
+  }
+
+  // Decode a versioned record into `out` (pre-filled with defaults)
+  bool decodeSettingsRecord(const uint8_t* raw, size_t len, PersistedSettings& out) {
+    if (len < sizeof(SettingsHeader)) return false;
+    SettingsHeader header;
+    memcpy(&header, raw, sizeof(header));
+    if (header.magic != SETTINGS_MAGIC || header.version == 0) return false;
+    if (sizeof(header) + header.size != len) return false;
+    const uint8_t* body = raw + sizeof(header);
+    if (settingsCrc(body, header.size) != header.crc) return false;
+    memcpy(&out, body, header.size < sizeof(out) ? header.size : sizeof(out));
+    return true;
+  }
+}
+
+void commitSettings() {
+  if (!settingsDirty) return;
+  settingsDirty = false;
+  PersistedSettings current = snapshotSettings();
+  // Cycling a value all the way round leaves nothing to write
+  if (memcmp(&current, &committedSettings, sizeof(current)) == 0) return;
+  SettingsRecord record;
+  record.header.magic = SETTINGS_MAGIC;
+  record.header.version = SETTINGS_SCHEMA_VERSION;
+  record.header.size = sizeof(record.body);
+  record.body = current;
+  record.header.crc = settingsCrc((const uint8_t*)&record.body, sizeof(record.body));
+  NOTE_NVS_WRITE();
+  if (prefs.putBytes(SETTINGS_KEY, &record, sizeof(record)) != sizeof(record)) {
+    LOG_WARN("⚠️ Settings write failed");
+    markSettingsDirty(); // retry after the commit delay
+    return;
+  }
+  committedSettings = current;
+  if (legacyKeysPresent) {
+    for (const char* key : LEGACY_SETTING_KEYS) {
+      NOTE_NVS_WRITE();
+      prefs.remove(key);
+    }
+    legacyKeysPresent = false;
+  }
+}
+
+void serviceSettingsCommit(unsigned long now) {
+  if (settingsDirty && now - settingsChangedAt >= SETTINGS_COMMIT_DELAY_MS) {
+    commitSettings();
+  }
+}
+
+void scheduleSettingsWake() {
+  if (settingsDirty) scheduleWake(SCHED_SETTINGS, settingsChangedAt + SETTINGS_COMMIT_DELAY_MS);
+  else clearWake(SCHED_SETTINGS);
+}
+
 // ------------------------------------------------------------------
 // Setter implementations (validate and apply side-effects)
-// Persist user-adjustable settings to non-volatile storage.
+// Unchanged values are ignored; accepted changes are persisted lazily.
 // ------------------------------------------------------------------
 void setLongPressTime(unsigned long ms) { LONG_PRESS_TIME = ms; }
 void setDebounceTime(unsigned long ms) { DEBOUNCE_TIME = ms; }
@@ -109,50 +538,101 @@ void setMotorUpdateInterval(unsigned long ms) { MOTOR_UPDATE_INTERVAL = ms; }
 
 // ===== Active/Inactive preset setters =====
 void setActiveRGBSetting(int mode) {
+  if (mode == activeRGBSetting) return;
   activeRGBSetting = mode;
-  prefs.putInt("active_rgb", activeRGBSetting);
+  markSettingsDirty();
 }
 
 void setInactiveRGBSetting(int mode) {
+  if (mode == inactiveRGBSetting) return;
   inactiveRGBSetting = mode;
-  prefs.putInt("inactive_rgb", inactiveRGBSetting);
+  markSettingsDirty();
 }
 
 void setRGBBrightness(int percent) {
   if (percent < 0) percent = 0;
   if (percent > 100) percent = 100;
+  if (percent == rgb_brightness_percentage) return;
   rgb_brightness_percentage = percent;
+  rebuildRGBDutyTable();
   applyRGBMode();
-  prefs.putInt("rgb_brightness", rgb_brightness_percentage);
+  markSettingsDirty();
 }
 
 void setActiveBuzzerSetting(int pattern) {
+  if (pattern == activeBuzzerSetting) return;
   activeBuzzerSetting = pattern;
-  prefs.putInt("active_buzzer", activeBuzzerSetting);
+  markSettingsDirty();
 }
 
 void setInactiveBuzzerSetting(int pattern) {
+  if (pattern == inactiveBuzzerSetting) return;
   inactiveBuzzerSetting = pattern;
-  prefs.putInt("inactive_buzzer", inactiveBuzzerSetting);
+  markSettingsDirty();
 }
 
 void setMotorSpeed(int speed) {
   if (speed <= 0) speed = 0;
   if (speed > 100) speed = 100;
+  if (speed == motorSpeed) return;
   motorSpeed = speed;
-  prefs.putInt("motor_speed", motorSpeed);
+  markSettingsDirty();
+}
+
+void setBuzzerVolume(int percent) {
+  if (percent < 0) percent = 0;
+  if (percent > 100) percent = 100;
+  if (percent == buzzerVolume) return;
+  buzzerVolume = percent;
+  markSettingsDirty();
+  refreshBuzzerVolume();
 }
 
 
-// Load persisted settings (call during setup after prefs.begin())
+// Load persisted settings (call during setup after prefs.begin()).
+// Normal boots cost a single getBytes(); older layouts are migrated once.
+// A newer firmware's longer record loads as a prefix and is left in place
+// until a setting changes, so a downgrade and re-upgrade keeps its fields.
 void loadPersistentSettings() {
-  // Active/Inactive presets
-  activeRGBSetting = (RGBMode)prefs.getInt("active_rgb", activeRGBSetting);
-  inactiveRGBSetting = (RGBMode)prefs.getInt("inactive_rgb", inactiveRGBSetting);
-  rgb_brightness_percentage = prefs.getInt("rgb_brightness", rgb_brightness_percentage);
-  activeBuzzerSetting = prefs.getInt("active_buzzer", activeBuzzerSetting);
-  inactiveBuzzerSetting = prefs.getInt("inactive_buzzer", inactiveBuzzerSetting);
-  motorSpeed = prefs.getInt("motor_speed", motorSpeed);
+  PersistedSettings loaded = snapshotSettings(); // compiled-in defaults
+  uint8_t raw[SETTINGS_READ_BUFFER];
+  size_t stored = prefs.getBytesLength(SETTINGS_KEY);
+  size_t len = stored <= sizeof(raw) ? prefs.getBytes(SETTINGS_KEY, raw, sizeof(raw)) : 0;
+  bool migrate = false;
+  bool legacyInRange = true;
+
+  if (decodeSettingsRecord(raw, len, loaded)) {
+    SettingsHeader header;
+    memcpy(&header, raw, sizeof(header));
+    migrate = header.version < SETTINGS_SCHEMA_VERSION;
+  } else if (len == UNVERSIONED_BLOB_SIZE) {
+    memcpy(&loaded, raw, UNVERSIONED_BLOB_SIZE);
+    migrate = true;
+  } else if (stored == 0 && prefs.isKey("active_rgb")) {
+    loaded.activeRGB = readLegacySetting("active_rgb", loaded.activeRGB, 0, RGB_MODE_COUNT - 1, legacyInRange);
+    loaded.inactiveRGB = readLegacySetting("inactive_rgb", loaded.inactiveRGB, 0, RGB_MODE_COUNT - 1, legacyInRange);
+    loaded.rgbBrightness = readLegacySetting("rgb_brightness", loaded.rgbBrightness, 0, 100, legacyInRange);
+    loaded.activeBuzzer = readLegacySetting("active_buzzer", loaded.activeBuzzer, 0, BUZZER_PATTERN_COUNT - 1, legacyInRange);
+    loaded.inactiveBuzzer = readLegacySetting("inactive_buzzer", loaded.inactiveBuzzer, 0, BUZZER_PATTERN_COUNT - 1, legacyInRange);
+    loaded.motorSpeed = readLegacySetting("motor_speed", loaded.motorSpeed, 0, 100, legacyInRange);
+    legacyKeysPresent = true;
+    migrate = true;
+  } else if (stored != 0) {
+    LOG_WARN("⚠️ Stored settings unreadable (bad magic/size/CRC) — using defaults");
+    migrate = true;
+  }
+
+  if (!validateSettings(loaded) || !legacyInRange) {
+    LOG_WARN("⚠️ Stored settings out of range — clamped");
+    migrate = true;
+  }
+  applyPersistedSettings(loaded);
+  committedSettings = loaded;
+  if (migrate) {
+    memset(&committedSettings, 0xFF, sizeof(committedSettings)); // force the rewrite
+    markSettingsDirty();
+  }
+  rebuildRGBDutyTable();
   // initialize buzzer runtime state
   buzzerStep = 0;
   buzzerState = false;
@@ -162,17 +642,89 @@ void loadPersistentSettings() {
 }
 
 
+// Cloud CONNECT callback (network task). Only one callback per event is
+// kept by ArduinoCloud, so every feature that needs it hooks in here.
+void onCloudConnect() {
+#if defined(LIGHT_SLEEP_IDLE)
+  esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+#endif
+#if defined(LATENCY_BENCH)
+  onBenchCloudConnect();
+#endif
+}
+
 // ==================================================================
 // === SETUP ========================================================
 // ==================================================================
+static void controlTask(void*) {
+  for (;;) {
+    controlLoop();
+    // Sleep until the earliest subsystem deadline, or until an ISR / cloud
+    // event notifies us. Always block at least one tick so lower-priority
+    // work on this core still runs.
+    TickType_t wait = ticksUntilNextWake();
+    ulTaskNotifyTake(pdTRUE, wait > 0 ? wait : 1);
+  }
+}
+
+static void networkTask(void*) {
+  for (;;) {
+    networkLoop();
+#if defined(LIGHT_SLEEP_IDLE)
+    // Poll the cloud less often while idle so the chip can stay asleep
+    vTaskDelay(pdMS_TO_TICKS(controlIdle ? NETWORK_TASK_IDLE_INTERVAL_MS : NETWORK_TASK_INTERVAL_MS));
+#else
+    vTaskDelay(pdMS_TO_TICKS(NETWORK_TASK_INTERVAL_MS));
+#endif
+  }
+}
+
+// Formats and prints what the other tasks logged; the serial port's speed
+// only ever holds up this task
+static void logTask(void*) {
+  for (;;) {
+    logDrain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+// Network task: OTA downloads wait until no stroke is running; from a
+// true answer on, modifyMotorState() holds new strokes
+static bool otaArmParked() {
+  return motorDirection == 0;
+}
+
 void setup() {
   // Initialize serial and wait for port to open:
-  Serial.begin(9600);
+  Serial.begin(LOG_BAUD_RATE);
+  logBegin();
   // This delay gives the chance to wait for a Serial Monitor without blocking if none is found
   delay(200); 
 
+  // Cloud -> control task handoff must exist before any cloud callback fires
+  initPeerRegistry();
+  activeBoxPublisher.reset();
+  cloudBareBox = BOX_ID_NONE;
+  stampedCopyDue = false;
+  beginTelemetry();
+  activeBoxEventQueue = xQueueCreate(ACTIVE_BOX_QUEUE_DEPTH, sizeof(ActiveBoxEvent));
+
   // Defined in thingProperties.h
   initProperties();
+  // Cloud Strings get their buffers now; later assignments reuse them
+  active_stamp.reserve(CLAIM_TEXT_MAX_LEN);
+  active_box.reserve(BOX_NAME_MAX_LEN);
+  buzzer_pattern.reserve(SERIAL_COMMAND_MAX_LEN);
+  motor_stats.reserve(STROKE_STATS_SUMMARY_MAX_LEN);
+#if defined(LOOP_PROFILING_CLOUD)
+  loop_profile.reserve(LOOP_PROFILE_SUMMARY_MAX_LEN);
+#endif
+
+#if defined(PEER_LINK_ESPNOW)
+  // ESP-NOW needs the STA interface up; the connection handler reuses it
+  WiFi.mode(WIFI_STA);
+  beginPeerLink(onPeerLinkActive);
+#endif
 
   // Connect to Arduino IoT Cloud
   ArduinoCloud.begin(ArduinoIoTPreferredConnection);
@@ -186,34 +738,75 @@ void setup() {
  */
   setDebugMessageLevel(2);
   ArduinoCloud.printDebugInfo();
+  ArduinoCloud.addCallback(ArduinoIoTCloudEvent::CONNECT, onCloudConnect);
+  beginOtaUpdates(otaArmParked);
+#if defined(LATENCY_BENCH)
+  beginLatencyBench();
+#endif
+#if defined(SOAK_TEST)
+  beginSoakTest();
+#endif
+#if defined(LIGHT_SLEEP_IDLE)
+  setupPowerManagement();
+#endif
+
+  // Set the RGB LED as outputs (before settings load applies the saved mode)
+  if (Board::Features::RGB) {
+    pinMode(RGB_R, OUTPUT);
+    pinMode(RGB_B, OUTPUT);
+    pinMode(RGB_G, OUTPUT);
+#if defined(RGB_HW_FADE)
+    ledcSetup(RGB_LEDC_CHANNEL_R, RGB_PWM_FREQUENCY, 8);
+    ledcSetup(RGB_LEDC_CHANNEL_G, RGB_PWM_FREQUENCY, 8);
+    ledcSetup(RGB_LEDC_CHANNEL_B, RGB_PWM_FREQUENCY, 8);
+    ledcAttachPin(RGB_R, RGB_LEDC_CHANNEL_R);
+    ledcAttachPin(RGB_G, RGB_LEDC_CHANNEL_G);
+    ledcAttachPin(RGB_B, RGB_LEDC_CHANNEL_B);
+    ledc_fade_func_install(0);
+#endif
+  }
+  // Turn LED fully off at startup
+  rebuildRGBDutyTable();
+  setRGB(0, 0, 0);
 
   // Open non-volatile storage namespace and load any saved settings
   prefs.begin("useless_box", false);
   loadPersistentSettings();
+  loadStrokeStats();
+  loadClaimClock();
 
   // Set the Board LED as outputs (kept OFF — not configurable)
+  // Driven as plain GPIO so they don't take LEDC channels from analogWrite()
   pinMode(LED_RED, OUTPUT);
   pinMode(LED_BLUE, OUTPUT);
   pinMode(LED_GREEN, OUTPUT);
-  analogWrite(LED_RED, 255);
-  analogWrite(LED_GREEN, 255);
-  analogWrite(LED_BLUE, 255);
-
-  // Set the RGB LED as outputs
-  pinMode(RGB_R, OUTPUT);
-  pinMode(RGB_B, OUTPUT);
-  pinMode(RGB_G, OUTPUT);
-  // Turn LED fully off at startup
-  setRGB(0, 0, 0);
-
-  // Set the Buzzer Pin as an output
-  pinMode(BUZZER_PIN, OUTPUT);
+  digitalWrite(LED_RED, HIGH);
+  digitalWrite(LED_GREEN, HIGH);
+  digitalWrite(LED_BLUE, HIGH);
+
+
+  // Buzzer: a dedicated LEDC channel stays attached; steps only retune it
+  if (Board::Features::BUZZER) {
+    pinMode(BUZZER_PIN, OUTPUT);
+#if !defined(BUZZER_TONE_API)
+    ledcSetup(BUZZER_LEDC_CHANNEL, BUZZER_DEFAULT_FREQUENCY, BUZZER_PWM_RESOLUTION);
+    ledcAttachPin(BUZZER_PIN, BUZZER_LEDC_CHANNEL);
+    ledcWrite(BUZZER_LEDC_CHANNEL, 0);
+#endif
+  }
 
   // Motor pins
   pinMode(IN1, OUTPUT);
   pinMode(IN2, OUTPUT);
+#if defined(MOTOR_SOFT_PWM)
   pinMode(EN1, OUTPUT);
   digitalWrite(EN1, LOW); // Disable motor at startup
+#else
+  ledcSetup(MOTOR_LEDC_CHANNEL, MOTOR_PWM_FREQUENCY, MOTOR_PWM_RESOLUTION);
+  ledcAttachPin(EN1, MOTOR_LEDC_CHANNEL);
+  ledcWrite(MOTOR_LEDC_CHANNEL, 0); // Disable motor at startup
+  motorAppliedDuty = 0;
+#endif
 
   // Inputs with internal pull-ups
   pinMode(SWITCH_PIN, INPUT_PULLUP);
@@ -221,62 +814,498 @@ void setup() {
 
   // Settings button
   pinMode(BUTTON_PIN, INPUT_PULLUP);
+  setupInputInterrupts();
 
   // Reflect starting state
   onActiveBoxChange();
+  stateChanged = true; // evaluate the motor once even if active_box is still empty
   updateRGBModeFromBoxState();
-  Serial.println("System Initialized.");
+  LOG_INFO("System Initialized.");
   showMenu();
+
+  xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK, nullptr,
+                          CONTROL_TASK_PRIORITY, &controlTaskHandle, CONTROL_TASK_CORE);
+  xTaskCreatePinnedToCore(networkTask, "cloud", NETWORK_TASK_STACK, nullptr,
+                          NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE);
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, nullptr,
+                          LOG_TASK_PRIORITY, nullptr, LOG_TASK_CORE);
+  beginHeapMonitor();
 }
 
 // ==================================================================
 // === MAIN LOOP ====================================================
 // ==================================================================
+// All work happens in the control and network tasks created in setup()
 void loop() {
-    ArduinoCloud.update();
-    handleSettingsButton();
-    handleSwitchDetection();
+  vTaskDelete(nullptr);
+}
+
+// Network task: publish local claims, then let the cloud client run.
+// Cloud callbacks (onActiveBoxChange) execute inside ArduinoCloud.update().
+void networkLoop() {
+  BoxId box = BOX_ID_NONE;
+  bool publish = false;
+  portENTER_CRITICAL(&activeBoxMux);
+  if (activeBoxPublishPending) {
+    box = pendingActiveBox;
+    publishStamp = pendingActiveStamp;
+    activeBoxPublishPending = false;
+    publish = true;
+  }
+  portEXIT_CRITICAL(&activeBoxMux);
+  if (publish) activeBoxPublisher.want(box);
+  if (activeBoxPublisher.due(millis(), ACTIVE_BOX_PUBLISH_WINDOW_MS, box)) {
+    char claim[CLAIM_TEXT_MAX_LEN];
+    formatClaimText(claim, sizeof(claim), boxName(box), publishStamp.lamport, boxName(publishStamp.origin));
+    // `active_box` stays a bare name, so older firmware and the dashboard keep working
+    active_stamp = claim;
+    active_box = boxName(box);
+    telemetryRecord(TELEM_CLAIM_PUBLISH, box);
+#if defined(LATENCY_BENCH)
+    benchNotePublish(box);
+#endif
+  }
+
+  publishStrokeTelemetry();
+
+#if defined(LOOP_PROFILING_CLOUD)
+  static unsigned long lastProfilePublish = 0;
+  if (millis() - lastProfilePublish >= LOOP_PROFILE_PUBLISH_MS) {
+    lastProfilePublish = millis();
+    char summary[LOOP_PROFILE_SUMMARY_MAX_LEN];
+    formatLoopProfile(summary, sizeof(summary));
+    loop_profile = summary;
+  }
+#endif
+
+  PROFILE_STAGE(STAGE_CLOUD_UPDATE, ArduinoCloud.update());
+  serviceOtaUpdates(millis());
+  serviceHeapMonitor(millis());
+  serviceTelemetry(millis());
+#if defined(PEER_LINK_ESPNOW)
+  servicePeerLink(millis());
+#endif
+#if defined(LATENCY_BENCH)
+  serviceLatencyBenchNetwork(millis());
+#endif
+}
+
+// Control task: everything that touches the motor, inputs, LEDs or buzzer
+void controlLoop() {
+#if defined(LOOP_PROFILING)
+    markControlPassStart();
+    int64_t passStart = esp_timer_get_time();
+#endif
+    otaNoteControlPass(millis());
+    processActiveBoxEvents();
+    PROFILE_STAGE(STAGE_INPUTS, serviceInputs());
+    PROFILE_STAGE(STAGE_SETTINGS_BUTTON, handleSettingsButton());
+    PROFILE_STAGE(STAGE_SWITCH_DETECTION, handleSwitchDetection());
+    serviceStrokeWatchdog(millis());
 
     if (millis() - lastMotorUpdate >= MOTOR_UPDATE_INTERVAL) {
       lastMotorUpdate = millis();
-      updateMotorPWM();
+      PROFILE_STAGE(STAGE_MOTOR_PWM, updateMotorPWM());
     }
 
-    updateAnimations();   // RGB Effects (rainbow, pulse, etc)
-    updateBuzzerAlarm();  // Buzzer Patterns
-    handleSerialMenu();
+    PROFILE_STAGE(STAGE_ANIMATIONS, updateAnimations());   // RGB Effects (rainbow, pulse, etc)
+    PROFILE_STAGE(STAGE_BUZZER, updateBuzzerAlarm());      // Buzzer Patterns
+    PROFILE_STAGE(STAGE_SERIAL_MENU, handleSerialMenu());
+    serviceSettingsCommit(millis());
+#if defined(LATENCY_BENCH)
+    serviceLatencyBench(millis());
+#endif
+#if defined(SOAK_TEST)
+    serviceSoakTest(millis());
+#endif
+    handleSerialCommands();
+
+    // Each subsystem registers when it next needs to run
+    scheduleInputWake();
+    scheduleButtonWake();
+    scheduleMotorWake();
+    scheduleAnimationWake();
+    scheduleBuzzerWake();
+    scheduleSettingsWake();
+    scheduleStrokeWake();
+#if defined(LATENCY_BENCH)
+    bool benchArmed;
+    unsigned long benchDue = benchNextWake(benchArmed);
+    if (benchArmed) scheduleWake(SCHED_BENCH, benchDue);
+    else clearWake(SCHED_BENCH);
+#endif
+#if defined(SOAK_TEST)
+    bool soakArmed;
+    unsigned long soakDue = soakNextWake(soakArmed);
+    if (soakArmed) scheduleWake(SCHED_SOAK, soakDue);
+    else clearWake(SCHED_SOAK);
+#endif
+#if defined(LIGHT_SLEEP_IDLE)
+    updatePowerState();
+#endif
+#if defined(LOOP_PROFILING)
+    recordLoopStage(STAGE_CONTROL_PASS, (uint32_t)(esp_timer_get_time() - passStart));
+#endif
+}
+
+// ==================================================================
+// === DEADLINE SCHEDULER ===========================================
+// ==================================================================
+void scheduleWake(ScheduledSubsystem subsystem, unsigned long dueMs) {
+  wakeDeadline[subsystem] = dueMs;
+  wakeArmed[subsystem] = true;
+}
+
+void clearWake(ScheduledSubsystem subsystem) {
+  wakeArmed[subsystem] = false;
+}
+
+TickType_t ticksUntilNextWake() {
+  unsigned long now = millis();
+#if defined(LIGHT_SLEEP_IDLE)
+  unsigned long wait = controlIdle ? LIGHT_SLEEP_MAX_SLEEP_MS : SCHEDULER_MAX_SLEEP_MS;
+#else
+  unsigned long wait = SCHEDULER_MAX_SLEEP_MS;
+#endif
+  for (int i = 0; i < SCHED_SUBSYSTEM_COUNT; i++) {
+    if (!wakeArmed[i]) continue;
+    long delta = (long)(wakeDeadline[i] - now);
+    if (delta <= 0) return 0;
+    if ((unsigned long)delta < wait) wait = delta;
+  }
+  return pdMS_TO_TICKS(wait);
+}
+
+void wakeControlTask() {
+  if (controlTaskHandle) xTaskNotifyGive(controlTaskHandle);
 }
 
+void IRAM_ATTR wakeControlTaskFromISR() {
+  if (!controlTaskHandle) return;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(controlTaskHandle, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
 
+#if defined(LIGHT_SLEEP_IDLE)
 // ==================================================================
-// === SETTINGS BUTTON HANDLER ======================================
+// === LIGHT-SLEEP IDLE =============================================
 // ==================================================================
-void handleSettingsButton() {
-  bool reading = digitalRead(BUTTON_PIN);
+// Automatic light sleep (tickless idle) is allowed whenever nothing needs
+// the CPU or a running APB clock. A PM lock blocks it while busy; Wi-Fi
+// drops to modem sleep and keeps the AP association across sleeps.
+void setupPowerManagement() {
+  esp_pm_config_esp32s3_t pm;
+  pm.max_freq_mhz = 240;
+  pm.min_freq_mhz = 80;
+  pm.light_sleep_enable = true;
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK) {
+    // Prebuilt SDKs without CONFIG_FREERTOS_USE_TICKLESS_IDLE end up here;
+    // modem sleep and the slower idle polling still apply.
+    pm.light_sleep_enable = false;
+    esp_pm_configure(&pm);
+    LOG_WARN("⚠️ Automatic light sleep unavailable: %s", esp_err_to_name(err));
+  }
+  pmLightSleepAvailable = (err == ESP_OK);
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "control", &noSleepLock);
+  esp_pm_lock_acquire(noSleepLock);
+  noSleepLockHeld = true;
+  esp_sleep_enable_gpio_wakeup();
+}
 
-  // Debounce
-  if (reading != lastSettingsButtonState) {
-    lastDebounceTime = millis();
+// Idle = motor stopped, buzzer silent and RGB static. Solid colours only
+// qualify at full brightness: LEDC stops with the APB clock in light sleep,
+// so only 0%/100% duty outputs survive it unchanged.
+bool controlIsIdle() {
+  if (motorShouldRun || motorDirection != 0) return false;
+  if (currentBuzzerPattern != BUZZER_OFF || buzzerQueueBusy() || buzzerDemo) return false;
+  if (wakeArmed[SCHED_INPUT] || wakeArmed[SCHED_BUTTON] || wakeArmed[SCHED_ANIMATIONS] || wakeArmed[SCHED_MOTOR]) return false;
+  switch (currentRGBMode) {
+    case RGB_OFF:
+      return true;
+    case RGB_WHITE:
+    case RGB_SOLID_RED:
+    case RGB_SOLID_GREEN:
+    case RGB_SOLID_BLUE:
+      return rgb_brightness_percentage >= 100;
+    default:
+      return false;
   }
+}
 
-  if ((millis() - lastDebounceTime) > DEBOUNCE_TIME) {
-    if (reading != settingsButtonState) {
-      settingsButtonState = reading;
+void updatePowerState() {
+  bool idle = controlIsIdle();
+  controlIdle = idle;
+  if (idle && noSleepLockHeld) {
+    esp_pm_lock_release(noSleepLock);
+    noSleepLockHeld = false;
+  } else if (!idle && !noSleepLockHeld) {
+    esp_pm_lock_acquire(noSleepLock);
+    noSleepLockHeld = true;
+  }
+}
+
+// Called when an input edge or cloud change is handled; only counts if the
+// box was idle (i.e. possibly asleep) when it arrived.
+void noteWakeEvent(uint32_t timestampUs) {
+  if (!controlIdle || wakePending) return;
+  wakePending = true;
+  wakeEventUs = timestampUs;
+}
 
-      // Just pressed
-      if (settingsButtonState == LOW) {
-        pressedTime = millis();
-        longPressActive = false;
+void noteMotorStartForWake() {
+  if (!wakePending) return;
+  wakePending = false;
+  wakeToMotorStart.record((uint32_t)esp_timer_get_time() - wakeEventUs);
+}
+
+static void cmdSleep(const char* args) {
+  if (strcmp(args, "reset") == 0) {
+    wakeToMotorStart.reset();
+    Serial.println("💤 Wake latency stats reset.");
+    return;
+  }
+  Serial.println();
+  Serial.print("💤 Light sleep: ");
+  Serial.println(pmLightSleepAvailable ? "automatic" : "unavailable (modem sleep only)");
+  Serial.print("Idle now: ");
+  Serial.println(controlIdle ? "yes" : "no");
+  char line[96];
+  snprintf(line, sizeof(line), "Wake->motor start (us): n=%lu min=%lu p50=%lu p99=%lu max=%lu",
+           (unsigned long)wakeToMotorStart.count(), (unsigned long)wakeToMotorStart.min(),
+           (unsigned long)wakeToMotorStart.percentile(50), (unsigned long)wakeToMotorStart.percentile(99),
+           (unsigned long)wakeToMotorStart.max());
+  Serial.println(line);
+}
+#endif
+
+// ==================================================================
+// === SERIAL COMMANDS ==============================================
+// ==================================================================
+static void cmdHelp(const char*);
+static void cmdStrokes(const char*);
+static void applyPendingCustomPattern();
+
+static void cmdInputs(const char*) {
+  char line[80];
+  for (int i = 0; i < INPUT_CHANNEL_COUNT; i++) {
+    InputChannel id = (InputChannel)i;
+    snprintf(line, sizeof(line), "  %-6s %s, %lu bounce edges filtered", INPUT_CHANNEL_NAMES[i],
+             inputLevel(id) ? "HIGH" : "LOW", (unsigned long)inputBouncesFiltered(id));
+    Serial.println(line);
+  }
+}
+
+static void cmdMenu(const char*) {
+  char json[768];
+  formatMenu(json, sizeof(json));
+  Serial.println(json);
+}
+
+static void cmdPeers(const char*) {
+  printPeerRegistry(controlActiveMask);
+  char line[128];
+  snprintf(line, sizeof(line), "  active_box writes: %lu sent, %lu coalesced, %lu unchanged",
+           (unsigned long)activeBoxPublisher.sent, (unsigned long)activeBoxPublisher.coalesced,
+           (unsigned long)activeBoxPublisher.unchanged);
+  Serial.println(line);
+  char claim[CLAIM_TEXT_MAX_LEN];
+  formatClaimText(claim, sizeof(claim), boxName(controlActiveBox), controlActiveStamp.lamport,
+                  boxName(controlActiveStamp.origin));
+  Serial.print("  held claim ");
+  Serial.println(claim);
+  snprintf(line, sizeof(line), "  claim clock %lu; %lu repeated/older claims ignored, %lu answered",
+           (unsigned long)claimClock, (unsigned long)staleClaimsIgnored, (unsigned long)staleClaimsAnswered);
+  Serial.println(line);
+#if defined(PEER_LINK_ESPNOW)
+  printPeerLinkStats();
+#endif
+}
+
+// "buzz <spec>" sets and previews the custom pattern; bare "buzz" prints it
+static void cmdBuzz(const char* args) {
+  if (*args) {
+    if (!setCustomBuzzerPattern(args)) {
+      Serial.println("Usage: buzz [loop ]freq:on:off[,freq:on:off...]");
+      return;
+    }
+    applyPendingCustomPattern();
+    demoBuzzerPattern(BUZZER_CUSTOM);
+  }
+  Serial.print("🔔 Custom pattern:");
+  if (customPattern.loop) Serial.print(" loop");
+  for (uint8_t i = 0; i < customPattern.count; i++) {
+    Serial.print(i ? "," : " ");
+    Serial.print(customSteps[i].freq);
+    Serial.print(":");
+    Serial.print(customSteps[i].duration_ms);
+    Serial.print(":");
+    Serial.print(customSteps[i].pause_ms);
+  }
+  Serial.println(customPattern.count ? "" : " (empty)");
+}
+
+#if !defined(MOTOR_SOFT_PWM)
+// "motion <key> <value>" tunes the profile for this boot; bare "motion" prints it
+static void cmdMotion(const char* args) {
+  char key[12] = "";
+  char value[12] = "";
+  sscanf(args, "%11s %11s", key, value);
+  long n = atol(value);
+  bool ok = true;
+  if (!*key) {
+  } else if (strcmp(key, "forget") == 0) {
+    strokeExpectedMs[0] = strokeExpectedMs[1] = 0;
+  } else if (strcmp(key, "shape") == 0) {
+    ok = false;
+    for (uint8_t i = 0; i < MOTION_SHAPE_COUNT; i++) {
+      if (strcmp(value, motionShapeName((MotionShape)i)) == 0) {
+        motionProfile.shape = (MotionShape)i;
+        ok = true;
       }
+    }
+  } else if (!*value || n < 0 || n > 2000) {
+    ok = false;
+  } else if (strcmp(key, "accel") == 0) {
+    motionProfile.accelMs = (uint16_t)n;
+  } else if (strcmp(key, "brake") == 0) {
+    motionProfile.brakeMs = (uint16_t)n;
+  } else if (strcmp(key, "approach") == 0) {
+    motionProfile.approachMs = (uint16_t)n;
+  } else if (strcmp(key, "start") == 0 && n <= 100) {
+    motionProfile.startSpeed = (uint8_t)n;
+  } else if (strcmp(key, "slow") == 0 && n <= 100) {
+    motionProfile.approachSpeed = (uint8_t)n;
+  } else {
+    ok = false;
+  }
+  if (!ok) {
+    Serial.println("Usage: motion [shape step|trapezoid|s-curve | accel|brake|approach <ms> | start|slow <%> | forget]");
+    return;
+  }
+  char line[128];
+  snprintf(line, sizeof(line), "🦾 Motion: %s, accel %u ms, brake %u ms, approach %u ms, start %u%%, slow %u%%",
+           motionShapeName(motionProfile.shape), motionProfile.accelMs, motionProfile.brakeMs,
+           motionProfile.approachMs, motionProfile.startSpeed, motionProfile.approachSpeed);
+  Serial.println(line);
+  snprintf(line, sizeof(line), "Learned strokes (ms): forward %lu, reverse %lu",
+           (unsigned long)strokeExpectedMs[0], (unsigned long)strokeExpectedMs[1]);
+  Serial.println(line);
+}
+#endif
+
+#if defined(LOOP_PROFILING)
+static void cmdProfile(const char* args) {
+  if (strcmp(args, "reset") == 0) {
+    resetLoopProfile();
+    Serial.println("⏱️ Loop profile reset.");
+    return;
+  }
+  printLoopProfile();
+}
+#endif
+
+const SerialCommand serialCommands[] = {
+  { "help", "list serial commands", cmdHelp },
+  { "peers", "list known boxes and which is active", cmdPeers },
+  { "inputs", "debounced input levels and bounce counts", cmdInputs },
+  { "menu", "all menu settings as JSON (value, name/unit, range, step)", cmdMenu },
+  { "buzz", "custom buzzer pattern; buzz [loop ]freq:on:off,...", cmdBuzz },
+  { "strokes", "stroke time stats and stall timeouts (strokes reset clears)", cmdStrokes },
+  { "ota", "running firmware, A/B slot and rollback state", otaCommand },
+  { "heap", "free heap, low-water mark and fragmentation", heapCommand },
+  { "telemetry", "event log counters (telemetry flush uploads now)", telemetryCommand },
+#if !defined(MOTOR_SOFT_PWM)
+  { "motion", "stroke ramp profile; motion [<key> <value> | forget]", cmdMotion },
+#endif
+#if defined(LATENCY_BENCH)
+  { "bench", "latency stats; bench start [n] | stop | reset", benchCommand },
+#endif
+#if defined(SOAK_TEST)
+  { "soak", "switch/arm/limit soak run; soak start [n] | stop | report", soakCommand },
+#endif
+#if defined(LOOP_PROFILING)
+  { "prof", "loop stage timings (prof reset clears)", cmdProfile },
+#endif
+#if defined(LIGHT_SLEEP_IDLE)
+  { "sleep", "light-sleep state and wake-to-motor latency (sleep reset clears)", cmdSleep },
+#endif
+#if defined(WIFI_FAST_CONNECT)
+  { "wifi", "cached AP record and connect times (wifi forget clears)", wifiCommand },
+#endif
+};
 
-      // Just released
-      else {
-        unsigned long pressDuration = millis() - pressedTime;
-        if (pressDuration < LONG_PRESS_TIME && !longPressActive) {
-          shortPressCount++;
-          //Serial.print("Short press #");
-          //Serial.println(shortPressCount);
-        }
+const int totalSerialCommands = sizeof(serialCommands) / sizeof(SerialCommand);
+
+static void cmdHelp(const char*) {
+  Serial.println("Serial commands:");
+  for (int i = 0; i < totalSerialCommands; i++) {
+    Serial.print("  ");
+    Serial.print(serialCommands[i].name);
+    Serial.print(" - ");
+    Serial.println(serialCommands[i].help);
+  }
+}
+
+// Non-blocking line reader: only consumes bytes already received
+void handleSerialCommands() {
+  static char line[SERIAL_COMMAND_MAX_LEN];
+  static size_t lineLen = 0;
+
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (lineLen < sizeof(line) - 1) line[lineLen++] = c;
+      continue;
+    }
+    if (lineLen == 0) continue;
+    line[lineLen] = '\0';
+    lineLen = 0;
+
+    char* args = strchr(line, ' ');
+    if (args) *args++ = '\0';
+    else args = line + strlen(line);
+
+    bool handled = false;
+    for (int i = 0; i < totalSerialCommands && !handled; i++) {
+      if (strcmp(line, serialCommands[i].name) == 0) {
+        logFlush(); // replies print directly: keep them after earlier log lines
+        serialCommands[i].handler(args);
+        handled = true;
+      }
+    }
+    if (!handled) {
+      Serial.print("Unknown command: ");
+      Serial.println(line);
+    }
+  }
+}
+
+
+// ==================================================================
+// === SETTINGS BUTTON HANDLER ======================================
+// ==================================================================
+void handleSettingsButton() {
+  InputEvent event;
+  while (popInputEvent(INPUT_BUTTON, event)) {
+    settingsButtonState = event.level;
+    // When the press/release really happened: the first edge of its burst
+    unsigned long at = millis() - ((uint32_t)esp_timer_get_time() - event.timestamp_us) / 1000;
+
+    // Just pressed
+    if (settingsButtonState == LOW) {
+      pressedTime = at;
+      longPressActive = false;
+    }
+
+    // Just released
+    else {
+      unsigned long pressDuration = at - pressedTime;
+      if (pressDuration < LONG_PRESS_TIME && !longPressActive) {
+        shortPressCount++;
+        //Serial.print("Short press #");
+        //Serial.println(shortPressCount);
       }
     }
   }
@@ -289,8 +1318,16 @@ void handleSettingsButton() {
     //Serial.print("Long press #");
     //Serial.println(longPressCount);
   }
+}
 
-  lastSettingsButtonState = reading;
+// Long-press detection is the only timed part; debounce settling is
+// scheduled by scheduleInputWake()
+void scheduleButtonWake() {
+  if (settingsButtonState == LOW && !longPressActive) {
+    scheduleWake(SCHED_BUTTON, pressedTime + LONG_PRESS_TIME + 1);
+  } else {
+    clearWake(SCHED_BUTTON);
+  }
 }
 
 // ==================================================================
@@ -298,26 +1335,42 @@ void handleSettingsButton() {
 // ==================================================================
 
 /*
- This system is fully modular:
-  - To add a new menu, create:
-      showX(), adjustX(), enterX()
-  - Then add one line inside the menuItems[] table below.
-
- Core logic stays unchanged forever.
+ Every setting is one constexpr MenuItem: the value it edits, its range
+ and step, how to name a value, and optional preview/feedback hooks. The
+ generic engine below shows, adjusts and confirms all of them.
+  - To add a new menu: give the setting a validating setter, then add
+    one line to menuItems[] (hooks only if it needs a preview or sound).
 */
 
-// Forward declarations for menu handler functions
+static void adjustMenuItem(const MenuItem& item);
+static void confirmMenuItem(const MenuItem& item);
 
-MenuItem menuItems[] = { 
-  { "Active RGB",           showActiveRGB,           adjustActiveRGB,           confirmActiveRGB },
-  { "Inactive RGB",         showInactiveRGB,         adjustInactiveRGB,         confirmInactiveRGB },
-  { "RGB Brightness",       showRGBBrightness,       adjustRGBBrightness,       confirmRGBBrightness },
-  { "Active Buzzer",        showActiveBuzzerSetting, adjustActiveBuzzerSetting, confirmActiveBuzzerSetting },
-  { "Inactive Buzzer",      showInactiveBuzzerSetting, adjustInactiveBuzzerSetting, confirmInactiveBuzzerSetting },
-  { "Motor Speed",          showMotorSpeed,          adjustMotorSpeed,          confirmMotorSpeed }
+// ---------------- PREVIEW / FEEDBACK HOOKS ----------------
+static void previewRGBMode(int mode) {
+  currentRGBMode = mode;
+  applyRGBMode();
+}
+static void beepOnce(int) { beepBuzzer(1, 100, 100); }
+static void beepTens(int value) { beepBuzzer(value / 10, 100, 100); }
+static void beepAtVolume(int) { beepBuzzer(1, 150, 0); } // preview at the new level
+#if defined(BUZZER_TONE_API)
+static void noteFixedVolume(int) { LOG_INFO("(fixed: built with BUZZER_TONE_API)"); }
+#else
+static constexpr void (*noteFixedVolume)(int) = nullptr;
+#endif
+
+//  name               label               value                   min  max                     step unit names              set                       onShow           onAdjust           onConfirm
+constexpr MenuItem menuItems[] = {
+  { "Active RGB",      "Active RGB Mode",   &activeRGBSetting,        0, RGB_MODE_COUNT - 1,       1, "",  rgbModeLabel,      setActiveRGBSetting,      previewRGBMode,  beepOnce,          updateRGBModeFromBoxState },
+  { "Inactive RGB",    "Inactive RGB Mode", &inactiveRGBSetting,      0, RGB_MODE_COUNT - 1,       1, "",  rgbModeLabel,      setInactiveRGBSetting,    previewRGBMode,  beepOnce,          updateRGBModeFromBoxState },
+  { "RGB Brightness",  "RGB Brightness",    &rgb_brightness_percentage, 0, 100,                   10, "%", nullptr,           setRGBBrightness,         nullptr,         beepTens,          nullptr },
+  { "Active Buzzer",   "Active Buzzer",     &activeBuzzerSetting,     0, BUZZER_PATTERN_COUNT - 1, 1, "",  buzzerPatternName, setActiveBuzzerSetting,   nullptr,         demoBuzzerPattern, nullptr },
+  { "Inactive Buzzer", "Inactive Buzzer",   &inactiveBuzzerSetting,   0, BUZZER_PATTERN_COUNT - 1, 1, "",  buzzerPatternName, setInactiveBuzzerSetting, nullptr,         demoBuzzerPattern, nullptr },
+  { "Motor Speed",     "Motor Speed",       &motorSpeed,             40, 100,                     10, "%", nullptr,           setMotorSpeed,            nullptr,         beepTens,          nullptr },
+  { "Buzzer Volume",   "Buzzer Volume",     &buzzerVolume,           10, 100,                     10, "%", nullptr,           setBuzzerVolume,          noteFixedVolume, beepAtVolume,      nullptr }
 };
 
-int totalMenus = sizeof(menuItems) / sizeof(MenuItem);
+constexpr int totalMenus = sizeof(menuItems) / sizeof(MenuItem);
 
 // === MAIN MENU HANDLER (Button-driven navigation) ===
 void handleSerialMenu() {
@@ -343,7 +1396,7 @@ void handleSerialMenu() {
       showMenu();
       beepBuzzer(menuIndex+1, 100, 100);
     } else {
-      menuItems[menuIndex].onAdjust();
+      adjustMenuItem(menuItems[menuIndex]);
     }
   }
 
@@ -354,14 +1407,14 @@ void handleSerialMenu() {
 
     if (!inSubMenu) {
       inSubMenu = true;
-      Serial.print("⚙️ Editing ");
-      Serial.println(menuItems[menuIndex].name);
-      menuItems[menuIndex].onShow();
+      LOG_INFO("⚙️ Editing %s", menuItems[menuIndex].name);
+      showMenuValue(menuItems[menuIndex]);
       beepBuzzer(1, 500, 100, 800);
     } else {
       inSubMenu = false;
-      menuItems[menuIndex].onConfirm();
-      Serial.println("✅ Saved and returned to main menu.");
+      confirmMenuItem(menuItems[menuIndex]);
+      commitSettings();
+      LOG_INFO("✅ Saved and returned to main menu.");
       showMenu();
       beepBuzzer(1, 500, 100, 1200);
     }
@@ -370,153 +1423,60 @@ void handleSerialMenu() {
 
 // === MENU DISPLAY ===
 void showMenu() {
-  Serial.println();
-  Serial.print("> Setting ");
-  Serial.print(menuIndex + 1);
-  Serial.print(": ");
-  Serial.println(menuItems[menuIndex].name);
-
-  // Optional: live preview under each menu
-  if (menuItems[menuIndex].onShow) {
-    menuItems[menuIndex].onShow();
-  }
+  LOG_INFO("> Setting %d: %s", menuIndex + 1, menuItems[menuIndex].name);
+  // Live preview under each menu
+  showMenuValue(menuItems[menuIndex]);
 }
 
 // ==================================================================
-// === INDIVIDUAL MENU HANDLERS =====================================
+// === GENERIC MENU ENGINE ==========================================
 // ==================================================================
-
-// ---------------- ACTIVE RGB PRESET ----------------
-void showActiveRGB() {
-  Serial.print("Active RGB Mode: ");
-  switch(activeRGBSetting) {
-    case RGB_OFF:        Serial.println("OFF"); break;
-    case RGB_WHITE:      Serial.println("WHITE"); break;
-    case RGB_RAINBOW:    Serial.println("RAINBOW"); break;
-    case RGB_BREATHING:  Serial.println("BREATHING"); break;
-    case RGB_SOLID_RED:  Serial.println("RED"); break;
-    case RGB_SOLID_GREEN:Serial.println("GREEN"); break;
-    case RGB_SOLID_BLUE: Serial.println("BLUE"); break;
-    default:             Serial.println("UNKNOWN"); break;
-  }
-  currentRGBMode = activeRGBSetting;
-  applyRGBMode();
-}
-void adjustActiveRGB() {
-  activeRGBSetting = (activeRGBSetting + 1) % RGB_MODE_COUNT;
-  setActiveRGBSetting(activeRGBSetting);
-  showActiveRGB();
-  beepBuzzer(1, 100, 100);
-}
-void confirmActiveRGB() { 
-  showActiveRGB(); 
-  updateRGBModeFromBoxState();
-}
-
-// ---------------- INACTIVE RGB PRESET ----------------
-void showInactiveRGB() {
-  Serial.print("Inactive RGB Mode: ");
-  switch(inactiveRGBSetting) {
-    case RGB_OFF:        Serial.println("OFF"); break;
-    case RGB_WHITE:      Serial.println("WHITE"); break;
-    case RGB_RAINBOW:    Serial.println("RAINBOW"); break;
-    case RGB_BREATHING:  Serial.println("BREATHING"); break;
-    case RGB_SOLID_RED:  Serial.println("RED"); break;
-    case RGB_SOLID_GREEN:Serial.println("GREEN"); break;
-    case RGB_SOLID_BLUE: Serial.println("BLUE"); break;
-    default:             Serial.println("UNKNOWN"); break;
-  }
-  currentRGBMode = inactiveRGBSetting;
-  applyRGBMode();
-}
-void adjustInactiveRGB() {
-  inactiveRGBSetting = (inactiveRGBSetting + 1) % RGB_MODE_COUNT;
-  setInactiveRGBSetting(inactiveRGBSetting);
-  showInactiveRGB();
-
-  beepBuzzer(1, 100, 100);
-}
-void confirmInactiveRGB() { 
-  showInactiveRGB();
-  updateRGBModeFromBoxState();
+void showMenuValue(const MenuItem& item) {
+  int value = *item.value;
+  if (item.names) {
+    LOG_INFO("%s: %s", item.label, item.names(value));
+  } else {
+    LOG_INFO("%s: %d%s", item.label, value, item.unit);
+  }
+  if (item.onShow) item.onShow(value);
 }
 
-// ---------------- RGB BRIGHTNESS ----------------
-void showRGBBrightness() {
-  Serial.print("RGB Brightness: ");
-  Serial.print(rgb_brightness_percentage);
-  Serial.println("%");
-}
-void adjustRGBBrightness() {
-  int next = rgb_brightness_percentage + 10;
-  if (next > 100) next = 0;
-  setRGBBrightness(next);
-  showRGBBrightness();
-  beepBuzzer(next/10, 100, 100);
-}
-void confirmRGBBrightness() {
-  showRGBBrightness();
+static void adjustMenuItem(const MenuItem& item) {
+  int next = *item.value + item.step;
+  if (next > item.max || next < item.min) next = item.min;
+  item.set(next);
+  showMenuValue(item);
+  if (item.onAdjust) item.onAdjust(*item.value);
 }
 
-// ---------------- ACTIVE BUZZER PRESET ----------------
-void showActiveBuzzerSetting() {
-  Serial.print("Active Buzzer: ");
-  switch(activeBuzzerSetting) {
-    case BUZZER_OFF:    Serial.println("OFF"); break;
-    case BUZZER_SINGLE: Serial.println("SINGLE"); break;
-    case BUZZER_CHIRP:  Serial.println("CHIRP"); break;
-    case BUZZER_LOOP:   Serial.println("LOOP"); break;
-    case BUZZER_SOS:    Serial.println("SOS"); break;
-    default:            Serial.println("UNKNOWN"); break;
-  }
-}
-void adjustActiveBuzzerSetting() {
-  activeBuzzerSetting = (activeBuzzerSetting + 1) % BUZZER_PATTERN_COUNT;
-  setActiveBuzzerSetting(activeBuzzerSetting);
-  demoBuzzerPattern(activeBuzzerSetting);
-  showActiveBuzzerSetting();
-}
-void confirmActiveBuzzerSetting() {
-  showActiveBuzzerSetting();
+static void confirmMenuItem(const MenuItem& item) {
+  showMenuValue(item);
+  if (item.onConfirm) item.onConfirm();
 }
 
-// ---------------- INACTIVE BUZZER PRESET ----------------
-void showInactiveBuzzerSetting() {
-  Serial.print("Inactive Buzzer: ");
-  switch(inactiveBuzzerSetting) {
-    case BUZZER_OFF:    Serial.println("OFF"); break;
-    case BUZZER_SINGLE: Serial.println("SINGLE"); break;
-    case BUZZER_CHIRP:  Serial.println("CHIRP"); break;
-    case BUZZER_LOOP:   Serial.println("LOOP"); break;
-    case BUZZER_SOS:    Serial.println("SOS"); break;
-    default:            Serial.println("UNKNOWN"); break;
+// {"Active RGB":{"value":2,"name":"RAINBOW","min":0,"max":6,"step":1},...}
+// Returns the length written; output is cut short (still terminated) if
+// `size` is too small.
+size_t formatMenu(char* out, size_t size) {
+  if (size == 0) return 0;
+  size_t used = 0;
+  out[0] = '\0';
+  for (int i = 0; i < totalMenus && used < size; i++) {
+    const MenuItem& item = menuItems[i];
+    int value = *item.value;
+    int n;
+    if (item.names) {
+      n = snprintf(out + used, size - used, "%s\"%s\":{\"value\":%d,\"name\":\"%s\",\"min\":%d,\"max\":%d,\"step\":%d}",
+                   i ? "," : "{", item.name, value, item.names(value), item.min, item.max, item.step);
+    } else {
+      n = snprintf(out + used, size - used, "%s\"%s\":{\"value\":%d,\"unit\":\"%s\",\"min\":%d,\"max\":%d,\"step\":%d}",
+                   i ? "," : "{", item.name, value, item.unit, item.min, item.max, item.step);
+    }
+    if (n < 0) break;
+    used += (size_t)n;
   }
-}
-void adjustInactiveBuzzerSetting() {
-  inactiveBuzzerSetting = (inactiveBuzzerSetting + 1) % BUZZER_PATTERN_COUNT;
-  setInactiveBuzzerSetting(inactiveBuzzerSetting);
-  demoBuzzerPattern(inactiveBuzzerSetting);
-  showInactiveBuzzerSetting();
-}
-void confirmInactiveBuzzerSetting() {
-  showInactiveBuzzerSetting();
-}
-
-// ---------- MOTOR SPEED ----------------
-void showMotorSpeed() {
-  Serial.print("Motor Speed: ");
-  Serial.print(motorSpeed);
-  Serial.println("%");
-}
-void adjustMotorSpeed() {
-  int next = motorSpeed + 10;
-  if (next > 100) next = 40;
-  setMotorSpeed(next);
-  showMotorSpeed();
-  beepBuzzer(next/10, 100, 100);
-}
-void confirmMotorSpeed() {
-  showMotorSpeed();
+  if (used < size) used += snprintf(out + used, size - used, "}");
+  return used < size ? used : size - 1;
 }
 // ==================================================================
 
@@ -524,7 +1484,7 @@ void confirmMotorSpeed() {
 // === RGB LED CONTROL ==============================================
 void updateRGBModeFromBoxState() {
   // Set currentRGBMode based on whether this box is active or inactive
-  if (active_box == BOX_NAME) {
+  if (isThisBoxActive()) {
     // This box is active
     currentRGBMode = activeRGBSetting;
   } else {
@@ -534,33 +1494,102 @@ void updateRGBModeFromBoxState() {
   applyRGBMode();
 }
 
+void rebuildRGBDutyTable() {
+  for (int v = 0; v < 256; v++) {
+#if defined(RGB_GAMMA_CORRECTION)
+    int level = GAMMA_TABLE[v];
+#else
+    int level = v;
+#endif
+    // Apply brightness scaling, then common anode inversion
+    rgbDutyTable[v] = 255 - (level * rgb_brightness_percentage) / 100;
+  }
+}
+
+#if defined(RGB_HW_FADE)
+// True while any channel is still fading towards its target
+bool rgbFadeBusy() {
+  unsigned long now = millis();
+  if ((long)(now - rgbFadeEnd) < 0) return true;
+  if (now - rgbFadeEnd > RGB_FADE_TIMEOUT_MS) return false; // never wait forever
+  for (int i = 0; i < 3; i++) {
+    if (ledc_get_duty(LEDC_LOW_SPEED_MODE, (ledc_channel_t)RGB_LEDC_CHANNELS[i]) != rgbTargetDuty[i]) return true;
+  }
+  return false;
+}
+
+// Program the LEDC fade engine (ms = 0 writes the duty directly).
+// Channels already at their target are skipped: a zero-length fade never
+// raises the end interrupt and would wedge the next fade start.
+void fadeRGBTo(uint8_t r, uint8_t g, uint8_t b, uint32_t ms) {
+  if (!Board::Features::RGB) return;
+  if (rgbFadeBusy()) {
+    rgbPending = true;
+    rgbPendingValue[0] = r; rgbPendingValue[1] = g; rgbPendingValue[2] = b;
+    rgbPendingMs = ms;
+    return;
+  }
+  const uint8_t value[3] = { r, g, b };
+  for (int i = 0; i < 3; i++) {
+    ledc_channel_t ch = (ledc_channel_t)RGB_LEDC_CHANNELS[i];
+    uint8_t duty = rgbDutyTable[value[i]];
+    rgbTargetDuty[i] = duty;
+    if (ledc_get_duty(LEDC_LOW_SPEED_MODE, ch) == duty) continue;
+    if (ms == 0) {
+      ledc_set_duty(LEDC_LOW_SPEED_MODE, ch, duty);
+      ledc_update_duty(LEDC_LOW_SPEED_MODE, ch);
+    } else {
+      ledc_set_fade_time_and_start(LEDC_LOW_SPEED_MODE, ch, duty, ms, LEDC_FADE_NO_WAIT);
+    }
+  }
+  rgbFadeEnd = millis() + ms;
+}
+
+void setRGB(uint8_t r, uint8_t g, uint8_t b) {
+  fadeRGBTo(r, g, b, 0);
+}
+#else
 void setRGB(uint8_t r, uint8_t g, uint8_t b) {
-  // Apply brightness scaling
-  r = (r * rgb_brightness_percentage) / 100;
-  g = (g * rgb_brightness_percentage) / 100;
-  b = (b * rgb_brightness_percentage) / 100;
-  // Common anode inversion
-  analogWrite(RGB_R, 255 - r);
-  analogWrite(RGB_G, 255 - g);
-  analogWrite(RGB_B, 255 - b);
+  if (!Board::Features::RGB) return;
+  analogWrite(RGB_R, rgbDutyTable[r]);
+  analogWrite(RGB_G, rgbDutyTable[g]);
+  analogWrite(RGB_B, rgbDutyTable[b]);
+}
+#endif
+
+// Static colours crossfade in hardware when RGB_HW_FADE is enabled
+static void showRGBColor(uint8_t r, uint8_t g, uint8_t b) {
+#if defined(RGB_HW_FADE)
+  fadeRGBTo(r, g, b, RGB_CROSSFADE_MS);
+#else
+  setRGB(r, g, b);
+#endif
+}
+
+const char* rgbModeLabel(int mode) {
+  static const char* const LABELS[RGB_MODE_COUNT] = {
+    "OFF", "WHITE", "RAINBOW", "BREATHING", "RED", "GREEN", "BLUE"
+  };
+  if (mode < 0 || mode >= RGB_MODE_COUNT) return "UNKNOWN";
+  return LABELS[mode];
 }
 
 void applyRGBMode() {
   switch (currentRGBMode) {
     case RGB_OFF:
-      setRGB(0,0,0);
+      showRGBColor(0,0,0);
       break;
     case RGB_WHITE:
-      setRGB(255,255,255);
+      showRGBColor(255,255,255);
       break;
     case RGB_SOLID_RED:
-      setRGB(255,0,0);
+      showRGBColor(255,0,0);
       break;
     case RGB_SOLID_GREEN:
-      setRGB(0,255,0);
+      showRGBColor(0,255,0);
       break;
     case RGB_SOLID_BLUE:
-      setRGB(0,0,255);
+      showRGBColor(0,0,255);
       break;
     case RGB_RAINBOW:
     case RGB_BREATHING:
@@ -571,14 +1600,33 @@ void applyRGBMode() {
 
 void updateAnimations() {
   unsigned long now = millis();
-  
+
+#if defined(RGB_HW_FADE)
+  // The fade engine runs on its own; only act at fade endpoints
+  if (rgbFadeBusy()) return;
+  if (rgbPending) {
+    rgbPending = false;
+    fadeRGBTo(rgbPendingValue[0], rgbPendingValue[1], rgbPendingValue[2], rgbPendingMs);
+    return;
+  }
+  if (currentRGBMode == RGB_BREATHING) {
+    // Same 5..250 ramp as the software path, as a few long hardware fades
+    breathValue += breathDir * RGB_BREATH_SEGMENT_STEP;
+    if (breathValue >= 250) { breathValue = 250; breathDir = -1; }
+    if (breathValue <= 5) { breathValue = 5; breathDir = 1; }
+    fadeRGBTo(breathValue, breathValue, breathValue, RGB_BREATH_SEGMENT_MS);
+    return;
+  }
+#endif
+
   if (currentRGBMode == RGB_RAINBOW && now - lastRGBAnimation > RGB_UPDATE_INTERVAL) {
     lastRGBAnimation = now;
-    int r = (sin((rainbowPos) * 0.05) * 127) + 128;
-    int g = (sin((rainbowPos*2) * 0.05) * 127) + 128;
-    int b = (sin((rainbowPos*3) * 0.05) * 127) + 128;
+    uint16_t phase = (uint16_t)rainbowPos;
+    uint8_t r = SINE_TABLE[phase >> 8];
+    uint8_t g = SINE_TABLE[(uint16_t)(phase * 2) >> 8];
+    uint8_t b = SINE_TABLE[(uint16_t)(phase * 3) >> 8];
     setRGB(r,g,b);
-    rainbowPos++;
+    rainbowPos = (uint16_t)(phase + RAINBOW_PHASE_STEP);
   }
 
   if (currentRGBMode == RGB_BREATHING && now - lastRGBAnimation > RGB_UPDATE_INTERVAL) {
@@ -591,13 +1639,113 @@ void updateAnimations() {
 }
 
 
+void scheduleAnimationWake() {
+#if defined(RGB_HW_FADE)
+  unsigned long now = millis();
+  if (rgbPending || currentRGBMode == RGB_BREATHING || rgbFadeBusy()) {
+    // Next fade endpoint (poll each tick if the hardware is running late)
+    scheduleWake(SCHED_ANIMATIONS, (long)(rgbFadeEnd - now) > 0 ? rgbFadeEnd : now + 1);
+    return;
+  }
+  if (currentRGBMode == RGB_RAINBOW) {
+#else
+  if (currentRGBMode == RGB_RAINBOW || currentRGBMode == RGB_BREATHING) {
+#endif
+    scheduleWake(SCHED_ANIMATIONS, lastRGBAnimation + RGB_UPDATE_INTERVAL + 1);
+    return;
+  }
+  clearWake(SCHED_ANIMATIONS); // static colour: nothing to do until the mode changes
+}
+
 // === BUZZER CONTROL ===============================================
+// Every buzzer write goes through buzzerOutput(), which skips the
+// peripheral entirely when nothing changes.
+namespace {
+  uint16_t buzzerAppliedFreq = 0;   // LEDC: timer frequency; tone(): sounding freq
+#if !defined(BUZZER_TONE_API)
+  uint32_t buzzerAppliedDuty = 0;   // 0 = silent
+#endif
+}
+
+#if !defined(BUZZER_TONE_API)
+// Loudness rises roughly with the square of duty, up to 50% (square wave)
+uint32_t buzzerDutyForVolume(int percent) {
+  if (percent <= 0) return 0;
+  if (percent >= 100) return BUZZER_MAX_DUTY;
+  uint32_t duty = ((uint32_t)percent * percent * BUZZER_MAX_DUTY + 5000) / 10000;
+  return duty ? duty : 1;
+}
+#endif
+
+static void buzzerOutput(uint16_t freq) {
+  if (!Board::Features::BUZZER) return;
+#if defined(BUZZER_TONE_API)
+  if (freq == buzzerAppliedFreq) return;
+  if (freq > 0) tone(BUZZER_PIN, freq);
+  else noTone(BUZZER_PIN);
+  buzzerAppliedFreq = freq;
+#else
+  uint32_t duty = freq > 0 ? buzzerDutyForVolume(buzzerVolume) : 0;
+  if (duty > 0 && freq != buzzerAppliedFreq) {
+    ledcChangeFrequency(BUZZER_LEDC_CHANNEL, freq, BUZZER_PWM_RESOLUTION);
+    buzzerAppliedFreq = freq;
+  }
+  if (duty != buzzerAppliedDuty) {
+    ledcWrite(BUZZER_LEDC_CHANNEL, duty);
+    buzzerAppliedDuty = duty;
+  }
+#endif
+}
+
+static void buzzerSilence() {
+  buzzerOutput(0);
+}
+
+// Apply a volume change to a tone that is already sounding
+void refreshBuzzerVolume() {
+#if !defined(BUZZER_TONE_API)
+  if (buzzerAppliedDuty > 0) buzzerOutput(buzzerAppliedFreq);
+#endif
+}
+
+const char* buzzerPatternName(int pattern) {
+  if (pattern < 0 || pattern >= BUZZER_PATTERN_COUNT) return "UNKNOWN";
+  return BUZZER_PATTERNS[pattern].name;
+}
+
+static const BuzzerPatternDef& buzzerPatternDef(int pattern) {
+  return pattern == BUZZER_CUSTOM ? customPattern : BUZZER_PATTERNS[pattern];
+}
+
+// Sound playingPattern's current step from `now`
+static void startBuzzerStep(unsigned long now) {
+  const BuzzerTone& step = playingPattern->steps[buzzerStep];
+  buzzerState = true;
+  buzzerLast = now;
+  buzzerStepDue = now + step.duration_ms;
+  buzzerOutput(step.freq); // 0 Hz: rest
+}
+
 void triggerBuzzerPattern(int pattern) {
-  currentBuzzerPattern = pattern;
+  unsigned long now = millis();
+  if (pattern < 0 || pattern >= BUZZER_PATTERN_COUNT) pattern = BUZZER_OFF;
+  playingPattern = &buzzerPatternDef(pattern);
   buzzerStep = 0;
-  buzzerState = false;
-  buzzerLast = millis();
-  noTone(BUZZER_PIN);
+  buzzerLast = now;
+  if (playingPattern->count == 0) {
+    currentBuzzerPattern = BUZZER_OFF;
+    buzzerState = false;
+    if (!buzzerQueueBusy()) buzzerSilence();
+    return;
+  }
+  currentBuzzerPattern = pattern;
+  if (buzzerQueueBusy()) {
+    // The queue owns the pin; step 0 starts once it drains
+    buzzerState = true;
+    buzzerQueuePreempted = true;
+  } else {
+    startBuzzerStep(now);
+  }
 }
 
 void demoBuzzerPattern(int pattern) {
@@ -606,20 +1754,148 @@ void demoBuzzerPattern(int pattern) {
   triggerBuzzerPattern(pattern);
 }
 
+// === TONE QUEUE ===
+bool enqueueBuzzerTone(uint16_t freq, uint16_t duration_ms, uint16_t pause_ms) {
+  uint8_t next = (buzzerQueueTail + 1) & BUZZER_QUEUE_MASK;
+  if (next == buzzerQueueHead) return false; // full — drop rather than block
+  buzzerQueue[buzzerQueueTail] = { freq, duration_ms, pause_ms };
+  buzzerQueueTail = next;
+  return true;
+}
+
+void clearBuzzerQueue() {
+  buzzerQueueHead = buzzerQueueTail;
+  if (buzzerQueueActive) buzzerSilence();
+  buzzerQueueActive = false;
+  buzzerQueueToneOn = false;
+}
+
+bool buzzerQueueBusy() {
+  return buzzerQueueActive || buzzerQueueHead != buzzerQueueTail;
+}
+
+// Advance the tone queue; returns true while it owns the buzzer.
+static bool serviceBuzzerQueue(unsigned long now) {
+  while (buzzerQueueBusy()) {
+    const BuzzerTone& t = buzzerQueue[buzzerQueueHead];
+
+    if (!buzzerQueueActive) {
+      // Start the next queued tone
+      buzzerQueueActive = true;
+      buzzerQueueToneOn = true;
+      buzzerQueueStepStart = now;
+      buzzerOutput(t.freq);
+      return true;
+    }
+
+    if (buzzerQueueToneOn) {
+      if (now - buzzerQueueStepStart < t.duration_ms) return true;
+      buzzerSilence();
+      buzzerQueueToneOn = false;
+      buzzerQueueStepStart = now;
+    }
+
+    if (now - buzzerQueueStepStart < t.pause_ms) return true;
+
+    // Step finished — pop it and fall through to the next one
+    buzzerQueueHead = (buzzerQueueHead + 1) & BUZZER_QUEUE_MASK;
+    buzzerQueueActive = false;
+  }
+
+  return false;
+}
+
 void beepBuzzer(int quantity, int duration_ms, int pause_ms, int toneFreq) {
   for (int i = 0; i < quantity; i++) {
-    tone(BUZZER_PIN, toneFreq);
-    delay(duration_ms);
-    noTone(BUZZER_PIN);
-    delay(pause_ms);
+    if (!enqueueBuzzerTone(toneFreq, duration_ms, pause_ms)) break;
   }
 }
 
 void stopBuzzer() {
   currentBuzzerPattern = BUZZER_OFF;
+  playingPattern = &BUZZER_PATTERNS[BUZZER_OFF];
   buzzerStep = 0;
   buzzerState = false;
-  noTone(BUZZER_PIN);
+  if (!buzzerQueueBusy()) buzzerSilence();
+}
+
+// === CUSTOM PATTERN ===
+// Parses into the pending copy under a lock; any task may call this.
+bool setCustomBuzzerPattern(const char* spec) {
+  BuzzerTone steps[BUZZER_CUSTOM_MAX_STEPS];
+  uint8_t count = 0;
+  bool loop = false;
+  const char* p = spec;
+
+  while (*p == ' ') p++;
+  if (strncmp(p, "loop", 4) == 0 && (p[4] == ' ' || p[4] == ',' || p[4] == '\0')) {
+    loop = true;
+    p += 4;
+  }
+  while (*p) {
+    while (*p == ' ' || *p == ',') p++;
+    if (!*p) break;
+    if (count >= BUZZER_CUSTOM_MAX_STEPS) return false;
+    char* end;
+    unsigned long fields[3];
+    for (int i = 0; i < 3; i++) {
+      fields[i] = strtoul(p, &end, 10);
+      if (end == p) return false;
+      p = end;
+      if (i < 2) {
+        if (*p != ':') return false;
+        p++;
+      }
+    }
+    if (fields[0] > 20000 || fields[1] > 10000 || fields[2] > 10000) return false;
+    if (fields[1] == 0 && fields[2] == 0) return false; // would spin without advancing time
+    steps[count++] = { (uint16_t)fields[0], (uint16_t)fields[1], (uint16_t)fields[2] };
+    if (*p && *p != ',' && *p != ' ') return false;
+  }
+
+  portENTER_CRITICAL(&customPatternMux);
+  memcpy(pendingCustomSteps, steps, sizeof(BuzzerTone) * count);
+  pendingCustomCount = count;
+  pendingCustomLoop = loop && count > 0;
+  customPatternPending = true;
+  portEXIT_CRITICAL(&customPatternMux);
+  wakeControlTask();
+  return true;
+}
+
+// Control task: swap in a pattern posted by setCustomBuzzerPattern()
+static void applyPendingCustomPattern() {
+  portENTER_CRITICAL(&customPatternMux);
+  memcpy(customSteps, pendingCustomSteps, sizeof(BuzzerTone) * pendingCustomCount);
+  customPattern.count = pendingCustomCount;
+  customPattern.loop = pendingCustomLoop;
+  customPatternPending = false;
+  portEXIT_CRITICAL(&customPatternMux);
+  // Restart rather than continue at a step index the new list may not have
+  if (currentBuzzerPattern == BUZZER_CUSTOM) triggerBuzzerPattern(BUZZER_CUSTOM);
+}
+
+// Current phase is over: go silent for the step's pause, or move on
+static void advanceBuzzerPattern(unsigned long now) {
+  const BuzzerTone& step = playingPattern->steps[buzzerStep];
+  if (buzzerState && step.pause_ms > 0) {
+    buzzerSilence();
+    buzzerState = false;
+    buzzerLast = now;
+    buzzerStepDue = now + step.pause_ms;
+    return;
+  }
+  if (++buzzerStep >= playingPattern->count) {
+    if (!playingPattern->loop) {
+      buzzerSilence();
+      currentBuzzerPattern = BUZZER_OFF;
+      buzzerStep = 0;
+      buzzerState = false;
+      return;
+    }
+    buzzerStep = 0;
+  }
+  startBuzzerStep(now);
 }
 
 // Non-blocking update (call inside loop)
@@ -629,94 +1905,342 @@ void updateBuzzerAlarm() {
   if (now - buzzerDemoStart >= BUZZER_DEMO_DURATION && buzzerDemo) {
     // End demo after 5 seconds
     buzzerDemo = false;
-    currentBuzzerPattern = BUZZER_OFF;
-    buzzerStep = 0;
-    noTone(BUZZER_PIN);
+    stopBuzzer();
     return;
   }
 
-  switch (currentBuzzerPattern) {
-    case BUZZER_OFF:
-      noTone(BUZZER_PIN);
-      break;
+  if (customPatternPending) applyPendingCustomPattern();
 
-    case BUZZER_SINGLE:
-      if (buzzerStep == 0) {
-        tone(BUZZER_PIN, 1000);
-        buzzerLast = now;
-        buzzerStep = 1;
-      } else if (now - buzzerLast >= 120) {
-        noTone(BUZZER_PIN);
-        currentBuzzerPattern = BUZZER_OFF;
-        buzzerStep = 0;
-      }
-      break;
+  // Queued tones pre-empt the pattern; the interrupted phase restarts once they drain
+  if (serviceBuzzerQueue(now)) {
+    buzzerQueuePreempted = true;
+    return;
+  }
+  if (buzzerQueuePreempted) {
+    buzzerQueuePreempted = false;
+    if (currentBuzzerPattern != BUZZER_OFF) {
+      if (buzzerState) startBuzzerStep(now);
+      else buzzerStepDue = now + playingPattern->steps[buzzerStep].pause_ms;
+    }
+  }
 
-    case BUZZER_CHIRP: {
-      int chirpFreqs[3] = {800, 1200, 800};
-      int duration = 120;
-      if (buzzerStep < 3) {
-        if (now - buzzerLast >= duration + 50 || buzzerStep == 0) {
-          tone(BUZZER_PIN, chirpFreqs[buzzerStep]);
-          buzzerLast = now;
-          buzzerStep++;
-        }
-      } else if (now - buzzerLast >= duration) {
-        noTone(BUZZER_PIN);
-        currentBuzzerPattern = BUZZER_OFF;
-        buzzerStep = 0;
-      }
-      break;
+  if (currentBuzzerPattern == BUZZER_OFF || (long)(now - buzzerStepDue) < 0) return;
+  advanceBuzzerPattern(now);
+}
+
+void scheduleBuzzerWake() {
+  unsigned long now = millis();
+  bool armed = false;
+  unsigned long due = 0;
+  auto consider = [&](unsigned long t) {
+    if (!armed || (long)(t - due) < 0) due = t;
+    armed = true;
+  };
+
+  if (customPatternPending) consider(now);
+  if (buzzerQueueBusy()) {
+    const BuzzerTone& t = buzzerQueue[buzzerQueueHead];
+    if (!buzzerQueueActive) consider(now);
+    else consider(buzzerQueueStepStart + (buzzerQueueToneOn ? t.duration_ms : t.pause_ms));
+  } else if (currentBuzzerPattern != BUZZER_OFF) {
+    consider(buzzerStepDue);
+  }
+  if (buzzerDemo) consider(buzzerDemoStart + BUZZER_DEMO_DURATION);
+
+  if (armed) scheduleWake(SCHED_BUZZER, due);
+  else clearWake(SCHED_BUZZER);
+}
+
+// === SWITCH / LIMIT INTERRUPTS ====================================
+static inline uint8_t IRAM_ATTR readGpioFromISR(uint8_t gpio) {
+  if (gpio < 32) return (REG_READ(GPIO_IN_REG) >> gpio) & 1;
+  return (REG_READ(GPIO_IN1_REG) >> (gpio - 32)) & 1;
+}
+
+#if defined(LIGHT_SLEEP_IDLE)
+// Light-sleep GPIO wakeup is level-triggered and shares the pin's interrupt
+// type, so each input runs as a level interrupt armed for the opposite of
+// its current level; re-arming on every edge behaves like CHANGE.
+static inline void IRAM_ATTR armWakeLevelFromISR(uint8_t gpio, uint8_t level) {
+  GPIO.pin[gpio].int_type = level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+  GPIO.pin[gpio].wakeup_enable = 1;
+}
+#endif
+
+// Force EN1 low from interrupt context. With the LEDC backend the pad is
+// first switched back to plain GPIO output (ROM routine, ISR-safe) so the
+// PWM signal can't keep driving it.
+static void IRAM_ATTR cutMotorFromISR() {
+#if !defined(MOTOR_SOFT_PWM)
+  esp_rom_gpio_connect_out_signal(en1Gpio, SIG_GPIO_OUT_IDX, false, false);
+#endif
+  FastOutput<EN1>::low();
+  motorCutByISR = true;
+}
+
+// H-bridge direction inputs, written straight to the GPIO registers.
+// Lows go first so IN1 and IN2 are never both HIGH, even for one write.
+static inline void setBridge(bool in1High, bool in2High) {
+  if (!in1High) FastOutput<IN1>::low();
+  if (!in2High) FastOutput<IN2>::low();
+  if (in1High) FastOutput<IN1>::high();
+  if (in2High) FastOutput<IN2>::high();
+}
+
+static void IRAM_ATTR pushInputEdgeFromISR(uint8_t pin, uint8_t level, bool motorCut) {
+  uint8_t next = (inputEdgeTail + 1) & INPUT_EDGE_MASK;
+  if (next == inputEdgeHead) { inputEdgeDropped++; return; }
+  inputEdgeQueue[inputEdgeTail] = { pin, level, motorCut, (uint32_t)esp_timer_get_time() };
+  inputEdgeTail = next;
+}
+
+static void IRAM_ATTR onSwitchEdgeISR() {
+  uint8_t level = readGpioFromISR(switchGpio);
+#if defined(LIGHT_SLEEP_IDLE)
+  armWakeLevelFromISR(switchGpio, level);
+#endif
+  // Arm has knocked the switch off: the forward stroke is over
+  bool cut = (level == LOW && motorDirection == 1);
+  if (cut) cutMotorFromISR();
+  pushInputEdgeFromISR(SWITCH_PIN, level, cut);
+  wakeControlTaskFromISR();
+}
+
+static void IRAM_ATTR onLimitEdgeISR() {
+  uint8_t level = readGpioFromISR(limitGpio);
+#if defined(LIGHT_SLEEP_IDLE)
+  armWakeLevelFromISR(limitGpio, level);
+#endif
+  // Limit pressed (NC contact opens -> HIGH): the return stroke is over
+  bool cut = (level == HIGH && motorDirection == -1);
+  if (cut) cutMotorFromISR();
+  pushInputEdgeFromISR(LIMIT_PIN, level, cut);
+  wakeControlTaskFromISR();
+}
+
+static void IRAM_ATTR onButtonEdgeISR() {
+  uint8_t level = readGpioFromISR(buttonGpio);
+#if defined(LIGHT_SLEEP_IDLE)
+  armWakeLevelFromISR(buttonGpio, level);
+#endif
+  pushInputEdgeFromISR(BUTTON_PIN, level, false);
+  wakeControlTaskFromISR();
+}
+
+void setupInputInterrupts() {
+  // Debouncers start from what the consumers last saw, so a level that
+  // differs at boot is reported once it has settled
+  const bool seen[INPUT_CHANNEL_COUNT] = { settingsButtonState, switch_forward, limit_pressed };
+  uint32_t nowUs = (uint32_t)esp_timer_get_time();
+  for (int i = 0; i < INPUT_CHANNEL_COUNT; i++) {
+    InputChannelState& channel = inputChannels[i];
+    channel.debounce.reset(seen[i] ? HIGH : LOW);
+    channel.eventHead = channel.eventTail = 0;
+    channel.motorCutPending = false;
+    uint8_t level = digitalRead(INPUT_CHANNEL_PINS[i]);
+    if (level != channel.debounce.stable) channel.debounce.edge(level, nowUs);
+  }
+  inputEdgeDroppedSeen = inputEdgeDropped;
+  attachInterrupt(digitalPinToInterrupt(SWITCH_PIN), onSwitchEdgeISR, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(LIMIT_PIN), onLimitEdgeISR, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), onButtonEdgeISR, CHANGE);
+#if defined(LIGHT_SLEEP_IDLE)
+  // Switch the three inputs to level-triggered wake sources (see armWakeLevelFromISR)
+  const uint8_t wakeGpios[] = { switchGpio, limitGpio, buttonGpio };
+  for (uint8_t gpio : wakeGpios) {
+    gpio_wakeup_enable((gpio_num_t)gpio, readGpioFromISR(gpio) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  }
+#endif
+}
+
+#if defined(SOAK_TEST) || defined(LATENCY_BENCH)
+namespace {
+  bool virtualInputsTaken = false;
+  uint8_t virtualInputLevels[INPUT_CHANNEL_COUNT] = { HIGH, LOW, HIGH };
+  portMUX_TYPE virtualInjectMux = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void takeVirtualInputs(bool take) {
+  if (take == virtualInputsTaken) return;
+  virtualInputsTaken = take;
+  if (take) {
+    // Start from the settled levels so taking over changes nothing by itself
+    virtualInputLevels[INPUT_SWITCH] = inputChannels[INPUT_SWITCH].debounce.stable;
+    virtualInputLevels[INPUT_LIMIT] = inputChannels[INPUT_LIMIT].debounce.stable;
+    detachInterrupt(digitalPinToInterrupt(SWITCH_PIN));
+    detachInterrupt(digitalPinToInterrupt(LIMIT_PIN));
+    return;
+  }
+  // Back to the pins: let the debouncers settle on whatever they read now
+  uint32_t nowUs = (uint32_t)esp_timer_get_time();
+  inputChannels[INPUT_SWITCH].debounce.edge(digitalRead(SWITCH_PIN), nowUs);
+  inputChannels[INPUT_LIMIT].debounce.edge(digitalRead(LIMIT_PIN), nowUs);
+  attachInterrupt(digitalPinToInterrupt(SWITCH_PIN), onSwitchEdgeISR, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(LIMIT_PIN), onLimitEdgeISR, CHANGE);
+}
+
+// What the switch/limit ISR would do for this level, minus the GPIO read
+void injectInputLevel(InputChannel channel, uint8_t level) {
+  if (!virtualInputsTaken || channel == INPUT_BUTTON) return;
+  virtualInputLevels[channel] = level;
+  uint8_t pin = (uint8_t)INPUT_CHANNEL_PINS[channel];
+  bool cut = channel == INPUT_SWITCH ? (level == LOW && motorDirection == 1) : (level == HIGH && motorDirection == -1);
+  portENTER_CRITICAL(&virtualInjectMux);   // the button ISR shares the ring
+  if (cut) cutMotorFromISR();
+  pushInputEdgeFromISR(pin, level, cut);
+  portEXIT_CRITICAL(&virtualInjectMux);
+}
+#endif
+
+// The level the debouncers settle against
+static uint8_t readInputChannel(int channel) {
+#if defined(SOAK_TEST) || defined(LATENCY_BENCH)
+  if (virtualInputsTaken && channel != INPUT_BUTTON) return virtualInputLevels[channel];
+#endif
+  return digitalRead(INPUT_CHANNEL_PINS[channel]);
+}
+
+bool popInputEdge(InputEdgeEvent& event) {
+  if (inputEdgeHead == inputEdgeTail) return false;
+  event = inputEdgeQueue[inputEdgeHead];
+  inputEdgeHead = (inputEdgeHead + 1) & INPUT_EDGE_MASK;
+  return true;
+}
+
+// === INPUT EVENTS =================================================
+static int inputChannelForPin(uint8_t pin) {
+  for (int i = 0; i < INPUT_CHANNEL_COUNT; i++) {
+    if (INPUT_CHANNEL_PINS[i] == pin) return i;
+  }
+  return INPUT_BUTTON;
+}
+
+static uint32_t inputSettleUs(int channel) {
+  return (channel == INPUT_BUTTON ? DEBOUNCE_TIME : SWITCH_DEBOUNCE_TIME) * 1000UL;
+}
+
+static void queueInputEvent(InputChannelState& channel, const InputEvent& event) {
+  uint8_t next = (channel.eventTail + 1) & INPUT_EVENT_MASK;
+  if (next == channel.eventHead) {
+    LOG_WARN("⚠️ Input event queue full — change dropped");
+    return;
+  }
+  channel.events[channel.eventTail] = event;
+  channel.eventTail = next;
+}
+
+bool popInputEvent(InputChannel id, InputEvent& event) {
+  InputChannelState& channel = inputChannels[id];
+  if (channel.eventHead == channel.eventTail) return false;
+  event = channel.events[channel.eventHead];
+  channel.eventHead = (channel.eventHead + 1) & INPUT_EVENT_MASK;
+  return true;
+}
+
+int inputLevel(InputChannel id) {
+  return inputChannels[id].debounce.stable;
+}
+
+uint32_t inputBouncesFiltered(InputChannel id) {
+  return inputChannels[id].bouncesFiltered;
+}
+
+// Feeds the raw ISR edges through each pin's debouncer and queues the
+// settled changes. The stroke bookkeeping for an ISR cutoff happens here,
+// on the raw edge, so it keeps the edge's own timestamp.
+void serviceInputs() {
+  uint32_t nowUs = (uint32_t)esp_timer_get_time();
+  InputEdgeEvent edge;
+  while (popInputEdge(edge)) {
+    InputChannelState& channel = inputChannels[inputChannelForPin(edge.pin)];
+#if defined(LIGHT_SLEEP_IDLE)
+    noteWakeEvent(edge.timestamp_us);
+#endif
+    if (edge.motorCut) {
+      channel.motorCutPending = true;
+#if !defined(MOTOR_SOFT_PWM)
+      noteStrokeEnd(edge.timestamp_us);
+#endif
+      finishStrokeTiming(edge.pin == LIMIT_PIN ? -1 : 1, edge.timestamp_us);
+      LOG_INFO("⛔ %s ISR cut EN1 %lu us before loop handled it", edge.pin == LIMIT_PIN ? "Limit" : "Switch",
+               (unsigned long)(nowUs - edge.timestamp_us));
     }
+    channel.debounce.edge(edge.level, edge.timestamp_us);
+  }
 
-    case BUZZER_LOOP:
-      if (now - buzzerLast >= BUZZER_INTERVAL) {
-        buzzerLast = now;
-        buzzerState = !buzzerState;
-        if (buzzerState) tone(BUZZER_PIN, 1000);
-        else noTone(BUZZER_PIN);
-      }
-      break;
+  // The raw ring overflowed: restart every pin's settle from its level now
+  uint32_t dropped = inputEdgeDropped;
+  if (dropped != inputEdgeDroppedSeen) {
+    inputEdgeDroppedSeen = dropped;
+    LOG_WARN("⚠️ Input edges dropped — resampling");
+    for (int i = 0; i < INPUT_CHANNEL_COUNT; i++) {
+      inputChannels[i].debounce.edge(readInputChannel(i), nowUs);
+      inputChannels[i].motorCutPending = true;
+    }
+  }
 
-    case BUZZER_SOS: {
-      unsigned int sosDurations[10] = {0,150,150,150,450,450,450,150,150,150};
-      if (buzzerStep < 10) {
-        if (now - buzzerLast >= sosDurations[buzzerStep] + 150) {
-          tone(BUZZER_PIN, 900, sosDurations[buzzerStep]);
-          buzzerLast = now;
-          buzzerStep++;
-        }
-      } else if (now - buzzerLast >= 150) {
-        currentBuzzerPattern = BUZZER_OFF;
-        buzzerStep = 0;
-      }
-      break;
+  for (int i = 0; i < INPUT_CHANNEL_COUNT; i++) {
+    InputChannelState& channel = inputChannels[i];
+    if (!channel.debounce.settling) continue;
+    uint16_t edges = channel.debounce.edges;
+    uint32_t burstStartUs = channel.debounce.burstStartUs;
+    if (channel.debounce.settle(readInputChannel(i), nowUs, inputSettleUs(i))) {
+      channel.bouncesFiltered += edges - 1;
+      queueInputEvent(channel, InputEvent{ channel.debounce.stable, burstStartUs });
+    } else if (!channel.debounce.settling) {
+      // Pure bounce. If the ISR cut EN1 on it, re-evaluate so the stroke resumes.
+      channel.bouncesFiltered += edges;
+      if (channel.motorCutPending) stateChanged = true;
+    } else {
+      continue;
     }
+    channel.motorCutPending = false;
   }
 }
 
+void scheduleInputWake() {
+  uint32_t nowUs = (uint32_t)esp_timer_get_time();
+  bool armed = false;
+  uint32_t soonestUs = 0;
+  for (int i = 0; i < INPUT_CHANNEL_COUNT; i++) {
+    const DebouncedInput& debounce = inputChannels[i].debounce;
+    if (!debounce.settling) continue;
+    int32_t leftUs = (int32_t)(debounce.settlesAtUs(inputSettleUs(i)) - nowUs);
+    uint32_t waitUs = leftUs > 0 ? (uint32_t)leftUs : 0;
+    if (!armed || waitUs < soonestUs) soonestUs = waitUs;
+    armed = true;
+  }
+  if (armed) scheduleWake(SCHED_INPUT, millis() + (nowUs % 1000 + soonestUs + 999) / 1000);
+  else clearWake(SCHED_INPUT);
+}
+
 // === SWITCH HANDLER ========================================
 void handleSwitchDetection() {
-  bool switchState = digitalRead(SWITCH_PIN);
-  bool limitState = digitalRead(LIMIT_PIN);
-
-  if (switchState != switch_forward) {
-    Serial.print("Switch changed to: ");
-    Serial.println(switchState == HIGH ? "FORWARD" : "REVERSE");
+  InputEvent event;
+  while (popInputEvent(INPUT_SWITCH, event)) {
+    bool switchState = event.level;
+    LOG_INFO("Switch changed to: %s", switchState == HIGH ? "FORWARD" : "REVERSE");
+    telemetryRecord(TELEM_SWITCH, switchState);
+#if defined(SOAK_TEST)
+    soakNoteInput(INPUT_SWITCH, switchState, event.timestamp_us);
+#endif
     switch_forward = switchState;
     stateChanged = true;
 
     if (switchState == HIGH) {
       // Switch turned ON: always claim active and play active buzzer + LED
-      Serial.println("⚡ Switch ON — claiming this box as Active.");
+      LOG_INFO("⚡ Switch ON — claiming this box as Active.");
       currentRGBMode = activeRGBSetting;
       applyRGBMode();
       triggerBuzzerPattern(activeBuzzerSetting);
       // Broadcast active status and indicate this originated from the switch
-      setActiveBox(BOX_NAME);
-    } else if (switchState == LOW && active_box != BOX_NAME) {
+#if defined(LATENCY_BENCH)
+      benchNoteEdge(event.timestamp_us);
+#endif
+      setActiveBox(thisBoxId());
+    } else if (switchState == LOW && !isThisBoxActive()) {
       // Switch turned OFF
-      Serial.println("⚡ Switch OFF — this box is now inactive.");
+      LOG_INFO("⚡ Switch OFF — this box is now inactive.");
       currentRGBMode = inactiveRGBSetting;
       applyRGBMode();
       triggerBuzzerPattern(inactiveBuzzerSetting);
@@ -724,59 +2248,423 @@ void handleSwitchDetection() {
     }
     // Switch turned OFF: if we were still active (i.e. this change was instigated by the local box)
     // we release the claim without running the inactive buzzer (local switch shouldn't cause the inactive buzzer)
-    else if (switchState == LOW && active_box == BOX_NAME) {
-      Serial.println("⚡ Switch OFF — releasing this box as Active (no buzzer).");
+    else if (switchState == LOW && isThisBoxActive()) {
+      LOG_INFO("⚡ Switch OFF — releasing this box as Active (no buzzer).");
       currentRGBMode = inactiveRGBSetting;
       applyRGBMode();
-      setActiveBox("NONE");
+#if defined(LATENCY_BENCH)
+      benchNoteEdge(event.timestamp_us);
+#endif
+      setActiveBox(BOX_ID_NONE);
     } 
   }
 
-  if (limitState != limit_pressed) {
-    Serial.print("Limit changed to: ");
-    Serial.println(limitState == LOW ? "RELEASED" : "PRESSED");
+  while (popInputEvent(INPUT_LIMIT, event)) {
+    bool limitState = event.level;
+    LOG_INFO("Limit changed to: %s", limitState == LOW ? "RELEASED" : "PRESSED");
+#if defined(SOAK_TEST)
+    soakNoteInput(INPUT_LIMIT, limitState, event.timestamp_us);
+#endif
     limit_pressed = limitState;
     stateChanged = true;
   }
 
+  // The OTA hold ended without a reboot: start the stroke it held back
+  if (strokeHeldForOta && !otaHoldsStrokes()) {
+    strokeHeldForOta = false;
+    stateChanged = true;
+  }
+
   if (stateChanged) {
-    modifyMotorState(switchState, limitState);
+#if defined(LATENCY_BENCH) && !defined(MOTOR_SOFT_PWM)
+    int directionBefore = motorDirection;
+#endif
+    modifyMotorState(switch_forward, limit_pressed);
+#if defined(LATENCY_BENCH)
+    benchNoteMotorDecision(motorDirection != 0);
+#if !defined(MOTOR_SOFT_PWM)
+    // The stroke carried on with EN1 still driven: no new output write will come
+    if (motorDirection != 0 && motorDirection == directionBefore && motorAppliedDuty > 0) benchNoteMotorOutput();
+#endif
+#endif
     stateChanged = false;
   }
 }
 
+#if !defined(MOTOR_SOFT_PWM)
+// === MOTION PROFILE ===============================================
+static uint32_t expectedStrokeMs() {
+  if (bridgeDirection == 0) return 0;
+  return strokeExpectedMs[bridgeDirection > 0 ? 0 : 1];
+}
+
+// Set IN1/IN2 for `direction` and start its ramp (0 = coast, phase idle)
+static void beginStroke(int direction, unsigned long now) {
+  bridgeDirection = direction;
+  motionPhaseStart = now;
+  strokeStartUs = (uint32_t)esp_timer_get_time();
+  motionPhase = direction != 0 ? MOTION_STROKE : MOTION_IDLE;
+  setBridge(direction > 0, direction < 0);
+}
+
+// Point the bridge at `direction` (0 = stop). A running stroke is braked
+// first; asking again for the stroke in progress keeps its ramp going.
+void startMotion(int direction) {
+  unsigned long now = millis();
+  if (motionPhase == MOTION_BRAKE) {
+    directionAfterBrake = direction;
+    return;
+  }
+  if (motionPhase == MOTION_STROKE && bridgeDirection == direction) return;
+  if (motionPhase == MOTION_STROKE && motionProfile.brakeMs > 0) {
+    rearmMotorEnable(); // an ISR cutoff leaves EN1 low, which would only coast
+    setBridge(false, false);
+    bridgeDirection = 0;
+    directionAfterBrake = direction;
+    motionPhase = MOTION_BRAKE;
+    motionPhaseStart = now;
+    return;
+  }
+  beginStroke(direction, now);
+}
+
+// An ISR ended the stroke at its switch/limit: remember how long it took
+void noteStrokeEnd(uint32_t timestampUs) {
+  if (motionPhase != MOTION_STROKE || bridgeDirection == 0) return;
+  strokeExpectedMs[bridgeDirection > 0 ? 0 : 1] = (timestampUs - strokeStartUs) / 1000;
+}
+
+// Duty the profile wants right now (no state changes)
+static uint32_t motionTargetDuty(unsigned long now) {
+  if (motionPhase == MOTION_BRAKE) return MOTOR_PWM_MAX_DUTY;
+  if (motionPhase != MOTION_STROKE || !motorShouldRun) return 0;
+  uint16_t speed = motionSpeedAt(motionProfile, now - motionPhaseStart, expectedStrokeMs(), motorSpeed);
+  return ((uint32_t)speed * MOTOR_PWM_MAX_DUTY + 500) / 1000;
+}
+#endif
+
+// === STROKE WATCHDOG ==============================================
+namespace {
+  struct __attribute__((packed)) StrokeStatsBody {
+    StrokeStats stats[2];
+    uint32_t stalls;
+  };
+
+  struct __attribute__((packed)) StrokeStatsRecord {
+    SettingsHeader header;   // same framing as the settings blob
+    StrokeStatsBody body;
+  };
+
+  constexpr const char* STROKE_STATS_KEY = "stroke_stats";
+  constexpr uint8_t STROKE_STATS_SCHEMA_VERSION = 1;
+
+  void queueStrokeTelemetry() {
+    portENTER_CRITICAL(&strokeTelemetryMux);
+    pendingStrokeStats[0] = strokeStats[0];
+    pendingStrokeStats[1] = strokeStats[1];
+    pendingStrokeStalls = strokeStalls;
+    pendingStallFault = stallFault;
+    strokeTelemetryPending = true;
+    portEXIT_CRITICAL(&strokeTelemetryMux);
+  }
+
+  void formatStrokeStats(char* out, size_t len, const StrokeStats* stats, uint32_t stalls, bool fault) {
+    snprintf(out, len, "fwd n=%lu mean=%lu sd=%lu | rev n=%lu mean=%lu sd=%lu | stalls=%lu%s",
+             (unsigned long)stats[0].count, (unsigned long)(stats[0].meanMs + 0.5f), (unsigned long)(stats[0].stddevMs() + 0.5f),
+             (unsigned long)stats[1].count, (unsigned long)(stats[1].meanMs + 0.5f), (unsigned long)(stats[1].stddevMs() + 0.5f),
+             (unsigned long)stalls, fault ? " FAULT" : "");
+  }
+
+  void stopStalledMotor(unsigned long now) {
+    uint32_t elapsed = now - timedStrokeStartMs;
+    int direction = timedStrokeDirection;
+    timedStrokeDirection = 0;
+    motorShouldRun = false;
+    motorDirection = 0;   // before the cut, so an ISR can't act on the old stroke
+    cutMotorFromISR();    // same EN1 cutoff the limit/switch ISRs use
+#if defined(MOTOR_SOFT_PWM)
+    setBridge(false, false);
+#else
+    beginStroke(0, now);  // coast; no brake into a jammed arm
+#endif
+    stallFault = true;
+    strokeStalls++;
+    strokeStatsDirty = true;
+    queueStrokeTelemetry();
+    telemetryRecord(TELEM_STALL, (uint8_t)direction, (uint16_t)(elapsed > 0xFFFF ? 0xFFFF : elapsed));
+    LOG_WARN("⚠️ Motor stall: %s stroke ran %lu ms (limit %lu) — EN1 cut",
+             direction > 0 ? "forward" : "reverse", (unsigned long)elapsed,
+             (unsigned long)strokeStallTimeoutMs(direction));
+  }
+}
+
+uint32_t strokeStallTimeoutMs(int direction) {
+  const StrokeStats& stats = strokeStats[strokeIndex(direction)];
+  if (stats.count < STROKE_STALL_MIN_SAMPLES) return STROKE_STALL_DEFAULT_MS;
+  float margin = STROKE_STALL_SIGMAS * stats.stddevMs();
+  if (margin < stats.meanMs / 2) margin = stats.meanMs / 2;
+  uint32_t timeout = (uint32_t)(stats.meanMs + margin);
+  if (timeout < STROKE_STALL_MIN_MS) return STROKE_STALL_MIN_MS;
+  if (timeout > STROKE_STALL_MAX_MS) return STROKE_STALL_MAX_MS;
+  return timeout;
+}
+
+bool motorStallFault() { return stallFault; }
+
+// modifyMotorState() picked `direction` (0 = stop). A new stroke restarts
+// the timer; re-evaluating the stroke in progress leaves it running.
+static void startStrokeTiming(int direction) {
+  if (stallFault) {
+    stallFault = false; // the inputs changed: let the motor try again
+    LOG_INFO("Motor stall fault cleared");
+    queueStrokeTelemetry();
+  }
+  if (direction == timedStrokeDirection) return;
+  timedStrokeDirection = direction;
+  timedStrokeStartUs = (uint32_t)esp_timer_get_time();
+  timedStrokeStartMs = millis();
+}
+
+// An ISR ended the `direction` stroke at `timestampUs`
+static void finishStrokeTiming(int direction, uint32_t timestampUs) {
+  if (timedStrokeDirection != direction) return;
+  timedStrokeDirection = 0;
+  uint32_t strokeMs = (timestampUs - timedStrokeStartUs + 500) / 1000;
+  strokeStats[strokeIndex(direction)].record(strokeMs);
+  telemetryRecord(TELEM_STROKE, (uint8_t)direction, (uint16_t)(strokeMs > 0xFFFF ? 0xFFFF : strokeMs));
+  strokeStatsDirty = true;
+  queueStrokeTelemetry();
+}
+
+void saveStrokeStats() {
+  strokeStatsSavedAt = millis();
+  if (!strokeStatsDirty) return;
+  StrokeStatsRecord record;
+  record.header.magic = SETTINGS_MAGIC;
+  record.header.version = STROKE_STATS_SCHEMA_VERSION;
+  record.header.size = sizeof(record.body);
+  record.body.stats[0] = strokeStats[0];
+  record.body.stats[1] = strokeStats[1];
+  record.body.stalls = strokeStalls;
+  record.header.crc = settingsCrc((const uint8_t*)&record.body, sizeof(record.body));
+  NOTE_NVS_WRITE();
+  if (prefs.putBytes(STROKE_STATS_KEY, &record, sizeof(record)) != sizeof(record)) {
+    LOG_WARN("⚠️ Stroke stats write failed");
+    return; // still dirty: retried next interval
+  }
+  strokeStatsDirty = false;
+}
+
+void loadStrokeStats() {
+  strokeStats[0].reset();
+  strokeStats[1].reset();
+  strokeStalls = 0;
+  StrokeStatsRecord record;
+  size_t len = prefs.getBytes(STROKE_STATS_KEY, &record, sizeof(record));
+  if (len == sizeof(record) && record.header.magic == SETTINGS_MAGIC &&
+      record.header.version == STROKE_STATS_SCHEMA_VERSION && record.header.size == sizeof(record.body) &&
+      settingsCrc((const uint8_t*)&record.body, sizeof(record.body)) == record.header.crc) {
+    strokeStats[0] = record.body.stats[0];
+    strokeStats[1] = record.body.stats[1];
+    strokeStalls = record.body.stalls;
+  } else if (len != 0) {
+    LOG_WARN("⚠️ Stored stroke stats unreadable — starting over");
+  }
+  strokeStatsDirty = false;
+  strokeStatsSavedAt = millis();
+  queueStrokeTelemetry();
+}
+
+void serviceStrokeWatchdog(unsigned long now) {
+  if (timedStrokeDirection != 0 && !motorCutByISR &&
+      now - timedStrokeStartMs >= strokeStallTimeoutMs(timedStrokeDirection)) {
+    stopStalledMotor(now);
+  }
+  if (strokeStatsDirty && now - strokeStatsSavedAt >= STROKE_STATS_SAVE_INTERVAL_MS) {
+    saveStrokeStats();
+  }
+}
+
+void scheduleStrokeWake() {
+  if (timedStrokeDirection != 0 && !motorCutByISR) {
+    scheduleWake(SCHED_STROKE, timedStrokeStartMs + strokeStallTimeoutMs(timedStrokeDirection));
+  } else if (strokeStatsDirty) {
+    scheduleWake(SCHED_STROKE, strokeStatsSavedAt + STROKE_STATS_SAVE_INTERVAL_MS);
+  } else {
+    clearWake(SCHED_STROKE);
+  }
+}
+
+// "strokes" prints the learned stroke times; "strokes reset" clears them
+static void cmdStrokes(const char* args) {
+  if (strcmp(args, "reset") == 0) {
+    strokeStats[0].reset();
+    strokeStats[1].reset();
+    strokeStalls = 0;
+    strokeStatsDirty = true;
+    saveStrokeStats();
+    queueStrokeTelemetry();
+    Serial.println("🦾 Stroke stats reset.");
+    return;
+  }
+  char line[128];
+  formatStrokeStats(line, sizeof(line), strokeStats, strokeStalls, stallFault);
+  Serial.print("🦾 Strokes (ms): ");
+  Serial.println(line);
+  snprintf(line, sizeof(line), "Stall timeout (ms): forward %lu, reverse %lu",
+           (unsigned long)strokeStallTimeoutMs(1), (unsigned long)strokeStallTimeoutMs(-1));
+  Serial.println(line);
+}
+
+// Network task: mirror the latest stroke stats into the cloud property
+void publishStrokeTelemetry() {
+  StrokeStats stats[2];
+  uint32_t stalls;
+  bool fault;
+  portENTER_CRITICAL(&strokeTelemetryMux);
+  bool pending = strokeTelemetryPending;
+  strokeTelemetryPending = false;
+  stats[0] = pendingStrokeStats[0];
+  stats[1] = pendingStrokeStats[1];
+  stalls = pendingStrokeStalls;
+  fault = pendingStallFault;
+  portEXIT_CRITICAL(&strokeTelemetryMux);
+  if (!pending) return;
+  char summary[STROKE_STATS_SUMMARY_MAX_LEN];
+  formatStrokeStats(summary, sizeof(summary), stats, stalls, fault);
+  motor_stats = summary;
+}
+
 // === MOTOR BEHAVIOR ===============================================
 void modifyMotorState(bool switchState, bool limitState) {
-  Serial.println("Modifying motor state...");
+  LOG_DEBUG("Modifying motor state...");
+  int previousDirection = motorDirection;
   
   // Determine desired motor state
-  if (switchState == HIGH && active_box != BOX_NAME) {
+  bool forward = switchState == HIGH && !isThisBoxActive();
+  bool reverse = !forward && limitState == LOW;
+  // A confirmed OTA download may be writing flash: no new strokes. The
+  // direction is claimed before the hold is read and the OTA gate does the
+  // reverse, so a stroke and a download can't both start.
+  if ((forward || reverse) && previousDirection == 0) {
+    motorDirection = forward ? 1 : -1;
+    if (otaHoldsStrokes()) {
+      motorDirection = 0;
+      forward = reverse = false;
+      if (!strokeHeldForOta) LOG_INFO("⬇️ Stroke held until the OTA download ends");
+      strokeHeldForOta = true;
+    }
+  }
+
+  if (forward) {
     // Forward direction — limit switch ignored
-    Serial.println("Forward");
+    LOG_INFO("Forward");
     motorDirection = 1;
     motorShouldRun = true;
+    startStrokeTiming(1);
+#if defined(MOTOR_SOFT_PWM)
     lastMotorPWMUpdate = millis();
     motorPWMEnabled = false;  // Start with OFF phase of PWM
-    digitalWrite(IN1, HIGH);
-    digitalWrite(IN2, LOW);
-  } else if (limitState == LOW) {
+    setBridge(true, false);
+    rearmMotorEnable();
+#else
+    rearmMotorEnable();
+    startMotion(1);
+#endif
+#if defined(LIGHT_SLEEP_IDLE)
+    noteMotorStartForWake();
+#endif
+  } else if (reverse) {
     // Reverse direction
-    Serial.println("Reverse");
+    LOG_INFO("Reverse");
     motorDirection = -1;
     motorShouldRun = true;
+    startStrokeTiming(-1);
+#if defined(MOTOR_SOFT_PWM)
     lastMotorPWMUpdate = millis();
     motorPWMEnabled = false;  // Start with OFF phase of PWM
-    digitalWrite(IN1, LOW);
-    digitalWrite(IN2, HIGH);
+    setBridge(false, true);
+    rearmMotorEnable();
+#else
+    rearmMotorEnable();
+    startMotion(-1);
+#endif
+#if defined(LIGHT_SLEEP_IDLE)
+    noteMotorStartForWake();
+#endif
   } else {
     // Stop motor
-    Serial.println("Stop");
+    LOG_INFO("Stop");
     motorShouldRun = false;
     motorDirection = 0;
+    startStrokeTiming(0);
+#if !defined(MOTOR_SOFT_PWM)
+    startMotion(0);
+#endif
+  }
+  if (motorDirection != previousDirection) {
+    if (motorDirection != 0) telemetryRecord(TELEM_MOTOR_START, (uint8_t)motorDirection, (uint16_t)motorSpeed);
+    else telemetryRecord(TELEM_MOTOR_STOP);
+#if defined(SOAK_TEST)
+    soakNoteMotor(motorDirection);
+#endif
+  }
+}
+
+void scheduleMotorWake() {
+#if defined(MOTOR_SOFT_PWM)
+  if (motorShouldRun && !motorCutByISR) {
+    unsigned long onTime = (unsigned long)((float)motorSpeed / 100.0f * MOTOR_PWM_CYCLE_TIME);
+    unsigned long phase = motorPWMEnabled ? onTime : MOTOR_PWM_CYCLE_TIME - onTime;
+    scheduleWake(SCHED_MOTOR, lastMotorPWMUpdate + phase);
+    return;
+  }
+  if (motorPWMEnabled) {
+    scheduleWake(SCHED_MOTOR, lastMotorUpdate + MOTOR_UPDATE_INTERVAL); // EN1 still high
+    return;
+  }
+#else
+  unsigned long now = millis();
+  if (motionPhase == MOTION_BRAKE) {
+    scheduleWake(SCHED_MOTOR, motionPhaseStart + motionProfile.brakeMs);
+    return;
   }
+  if (!motorCutByISR) {
+    if (motionTargetDuty(now) != motorAppliedDuty) {
+      scheduleWake(SCHED_MOTOR, lastMotorUpdate + MOTOR_UPDATE_INTERVAL); // duty write pending
+      return;
+    }
+    uint32_t nextChange;
+    if (motionPhase == MOTION_STROKE) {
+      if (motionRamping(motionProfile, now - motionPhaseStart, expectedStrokeMs(), motorSpeed, nextChange)) {
+        scheduleWake(SCHED_MOTOR, lastMotorUpdate + MOTOR_UPDATE_INTERVAL); // ramp step
+        return;
+      }
+      if (nextChange) {
+        scheduleWake(SCHED_MOTOR, motionPhaseStart + nextChange); // approach ramp begins
+        return;
+      }
+    }
+  }
+#endif
+  clearWake(SCHED_MOTOR); // LEDC keeps running on its own
+}
+
+// Reconnect EN1 after an ISR cutoff so the next stroke can drive it again
+void rearmMotorEnable() {
+  if (!motorCutByISR) return;
+  motorCutByISR = false;
+#if defined(MOTOR_SOFT_PWM)
+  motorPWMEnabled = false;
+#else
+  ledcAttachPin(EN1, MOTOR_LEDC_CHANNEL); // routes the pad back to the LEDC signal
+  ledcWrite(MOTOR_LEDC_CHANNEL, 0);
+  motorAppliedDuty = 0;                   // forces updateMotorPWM() to rewrite duty
+#endif
 }
 
 // === MOTOR PWM UPDATE (Dynamic PWM based on motorSpeed) ===========
+#if defined(MOTOR_SOFT_PWM)
 void updateMotorPWM() {
   unsigned long now = millis();
   
@@ -785,9 +2673,9 @@ void updateMotorPWM() {
   unsigned long onTime = (unsigned long)((float)motorSpeed / 100.0f * MOTOR_PWM_CYCLE_TIME);
   unsigned long offTime = MOTOR_PWM_CYCLE_TIME - onTime;
   
-  // If motor shouldn't run, turn it off immediately
-  if (!motorShouldRun) { 
-    digitalWrite(EN1, LOW); // Disable motor
+  // If motor shouldn't run (or an ISR cut it), turn it off immediately
+  if (!motorShouldRun || motorCutByISR) { 
+    FastOutput<EN1>::low(); // Disable motor
     motorPWMEnabled = false;
     return;
   }
@@ -798,7 +2686,7 @@ void updateMotorPWM() {
     if (now - lastMotorPWMUpdate >= onTime) {
       // Turn motor OFF
       //Serial.println("Motor OFF phase");
-      digitalWrite(EN1, LOW);
+      FastOutput<EN1>::low();
       motorPWMEnabled = false;
       lastMotorPWMUpdate = now;
     }
@@ -810,34 +2698,266 @@ void updateMotorPWM() {
       if (motorDirection == 1) {
         //Serial.println("Motor ON Forward phase");
         // Forward
-        digitalWrite(EN1, HIGH);
+        FastOutput<EN1>::high();
       } else if (motorDirection == -1) {
         //Serial.println("Motor ON Reverse phase");
         // Reverse
-        digitalWrite(EN1, HIGH);
+        FastOutput<EN1>::high();
       }
       motorPWMEnabled = true;
       lastMotorPWMUpdate = now;
+#if defined(LATENCY_BENCH)
+      benchNoteMotorOutput();
+#endif
     }
   }
 }
+#else
+uint32_t motorDutyForSpeed(int speed) {
+  if (speed <= 0) return 0;
+  if (speed >= 100) return MOTOR_PWM_MAX_DUTY;
+  return ((uint32_t)speed * MOTOR_PWM_MAX_DUTY + 50) / 100;
+}
+
+// The LEDC peripheral generates the carrier; this only rewrites the duty
+// register when the profile's target changes.
+void updateMotorPWM() {
+  unsigned long now = millis();
+  if (motionPhase == MOTION_BRAKE && now - motionPhaseStart >= motionProfile.brakeMs) {
+    beginStroke(directionAfterBrake, now);
+  }
+  if (motorCutByISR) return; // pad is detached from LEDC until rearmMotorEnable()
+  uint32_t duty = motionTargetDuty(now);
+  if (duty != motorAppliedDuty) {
+    ledcWrite(MOTOR_LEDC_CHANNEL, duty);
+    motorAppliedDuty = duty;
+#if defined(LATENCY_BENCH)
+    if (duty > 0 && motionPhase == MOTION_STROKE) benchNoteMotorOutput();
+#endif
+  }
+}
+#endif
 
 
 // ==================================================================
 // === ACTIVE BOX SETTER ============================================
 // ==================================================================
-void setActiveBox(String box) {
-  active_box = box;
+// The Lamport clock survives resets: NVS holds a value the clock hasn't
+// reached yet, so claims made after an offline boot still outrank the
+// ones seen before it. Each boot starts from there and reserves the next
+// CLAIM_CLOCK_PERSIST_STEP ticks; running past them writes a new bound.
+static void reserveClaimClock() {
+  claimClockReserved = claimClock + CLAIM_CLOCK_PERSIST_STEP;
+  NOTE_NVS_WRITE();
+  prefs.putUInt(CLAIM_CLOCK_KEY, claimClockReserved);
+}
+
+void loadClaimClock() {
+  claimClock = prefs.getUInt(CLAIM_CLOCK_KEY, 0);
+  controlActiveStamp = { 0, BOX_ID_NONE };
+  reserveClaimClock();
+}
+
+static void advanceClaimClock(uint32_t seen) {
+  if (seen > claimClock) claimClock = seen;
+  if (claimClock >= claimClockReserved) reserveClaimClock();
+}
+
+#if defined(SOAK_TEST)
+// Soak claims, and any claim by or for its virtual peer, never leave the
+// box, so real peers don't play along
+static bool soakClaim(BoxId box, ClaimStamp stamp) {
+  return soakRunning() || box == soakPeerBox() || stamp.origin == soakPeerBox();
+}
+#endif
+
+static void queueClaimPublish(BoxId box, ClaimStamp stamp) {
+#if defined(SOAK_TEST)
+  if (soakClaim(box, stamp)) return;
+#endif
+  portENTER_CRITICAL(&activeBoxMux);
+  pendingActiveBox = box;
+  pendingActiveStamp = stamp;
+  activeBoxPublishPending = true;
+  portEXIT_CRITICAL(&activeBoxMux);
+}
+
+// Control task: take effect locally now, publish from the network task
+void setActiveBox(BoxId box) {
+  advanceClaimClock(claimClock + 1);
+  controlActiveBox = box;
+  controlActiveMask = boxBit(box);
+  controlActiveStamp = { claimClock, thisBoxId() };
+  queueClaimPublish(box, controlActiveStamp);
+#if defined(PEER_LINK_ESPNOW)
+#if defined(SOAK_TEST)
+  if (!soakClaim(box, controlActiveStamp))
+#endif
+  peerLinkAnnounce(box, claimClock);
+#endif
+#if defined(LATENCY_BENCH)
+  benchNoteClaim(box);
+#endif
+}
+
+bool isThisBoxActive() {
+  return (controlActiveMask & boxBit(thisBoxId())) != 0;
+}
+
+BoxId currentActiveBox() {
+  return controlActiveBox;
+}
+
+ClaimStamp currentActiveStamp() {
+  return controlActiveStamp;
+}
+
+namespace {
+  // Network task: hand a delivered claim to the control task
+  void postCloudClaim(BoxId box, ClaimStamp stamp, bool fresh) {
+    ActiveBoxEvent event;
+    event.box = box;
+    event.stamp = stamp;
+    event.fresh = fresh;
+    event.source = ACTIVE_SOURCE_CLOUD;
+    activeBoxPublisher.observed(box);
+    telemetryRecord(TELEM_CLAIM_ARRIVAL, box, ACTIVE_SOURCE_CLOUD);
+    event.received_us = (uint32_t)esp_timer_get_time();
+#if defined(LATENCY_BENCH)
+    benchNoteArrival(box, BENCH_VIA_CLOUD, event.received_us);
+#endif
+    if (xQueueSend(activeBoxEventQueue, &event, 0) != pdTRUE) {
+      LOG_WARN("⚠️ Active box queue full — change dropped");
+    }
+    wakeControlTask();
+  }
 }
 
 /*
   Since ActiveBox is READ_WRITE variable, onActiveBoxChange() is
   executed every time a new value is received from IoT Cloud.
+  It runs in the network task, so it only posts the new value to the
+  control task instead of touching motor state directly.
+  `active_stamp` is registered first, so when a box running this firmware
+  wrote both, the stamped claim has been posted already and the bare copy
+  is dropped. Any other bare name (dashboard edit, older firmware) is a
+  fresh claim only if it differs from the last bare value delivered; a
+  replay of that value gets no stamp and never beats a stamped claim.
 */
 void onActiveBoxChange()  {
-  Serial.print("Active Box Changed to: ");
-  Serial.println(active_box);
-  // Set stateChanged to true. This causes modifyMotorState() to run on the next loop even with not changes to 
-  // switch positions which will trigger the motor to run based on the active_box variable and the current switch positions
-  stateChanged = true; 
-}
\ No newline at end of file
+  if (active_box.length() == 0) return;  // not synced yet
+  BoxId box = registerBoxName(active_box.c_str()); // unknown names become new peers
+  bool copy = stampedCopyDue && box == stampedBareCopy;
+  bool repeat = box == cloudBareBox;
+  stampedCopyDue = false;
+  cloudBareBox = box;
+  if (copy) return;
+  postCloudClaim(box, { 0, BOX_ID_NONE }, !repeat);
+}
+
+// Network task: a box running this firmware published a stamped claim
+void onActiveStampChange() {
+  if (active_stamp.length() == 0) return;  // not synced yet
+  BoxName active, origin;
+  uint32_t lamport;
+  if (!parseClaimText(active_stamp.c_str(), active, lamport, origin)) {
+    LOG_WARN("⚠️ active_stamp ignored — expected <active>@<lamport>:<origin>");
+    return;
+  }
+  BoxId box = registerBoxName(active.c_str());
+  stampedBareCopy = box;
+  stampedCopyDue = true;
+  postCloudClaim(box, { lamport, registerBoxName(origin.c_str()) }, false);
+}
+
+// Network task: the dashboard pushed a new custom buzzer pattern
+void onBuzzerPatternChange() {
+  if (!setCustomBuzzerPattern(buzzer_pattern.c_str())) {
+    LOG_WARN("⚠️ buzzer_pattern ignored — expected [loop ]freq:on:off,...");
+  }
+}
+
+#if defined(PEER_LINK_ESPNOW)
+// Wi-Fi task: a peer announced a claim directly (already de-duplicated)
+void onPeerLinkActive(BoxId box, ClaimStamp stamp, uint32_t receivedUs) {
+  ActiveBoxEvent event;
+  event.box = box;
+  event.stamp = stamp;
+  event.fresh = false;
+  event.source = ACTIVE_SOURCE_LINK;
+  event.received_us = receivedUs;
+  telemetryRecord(TELEM_CLAIM_ARRIVAL, box, ACTIVE_SOURCE_LINK);
+#if defined(LATENCY_BENCH)
+  benchNoteArrival(box, BENCH_VIA_LINK, receivedUs);
+#endif
+  if (xQueueSend(activeBoxEventQueue, &event, 0) != pdTRUE) {
+    LOG_WARN("⚠️ Active box queue full — link change dropped");
+  }
+  wakeControlTask();
+}
+#endif
+
+#if defined(SOAK_TEST)
+// Control task: put back the claim a soak run displaced. Nothing is
+// published; the clock keeps the ticks the run used.
+void restoreActiveClaim(BoxId box, ClaimStamp stamp) {
+  controlActiveBox = box;
+  controlActiveMask = boxBit(box);
+  controlActiveStamp = stamp;
+  stateChanged = true;
+}
+
+// Control task: the soak's virtual peer claims, unstamped like a dashboard edit
+void postSimulatedClaim(BoxId box) {
+  ActiveBoxEvent event;
+  event.box = box;
+  event.stamp = { 0, BOX_ID_NONE };
+  event.fresh = true;
+  event.source = ACTIVE_SOURCE_CLOUD;
+  event.received_us = (uint32_t)esp_timer_get_time();
+  if (xQueueSend(activeBoxEventQueue, &event, 0) != pdTRUE) {
+    LOG_WARN("⚠️ Active box queue full — soak claim dropped");
+  }
+  wakeControlTask();
+}
+#endif
+
+// Control task: apply changes posted by onActiveBoxChange() / the peer link.
+// Only a claim with a newer stamp than the held one counts, so the second
+// copy of a claim (link first, cloud later) and old values replayed by a
+// cloud sync are dropped; only a real change re-runs modifyMotorState().
+void processActiveBoxEvents() {
+  ActiveBoxEvent event;
+  while (xQueueReceive(activeBoxEventQueue, &event, 0) == pdTRUE) {
+    if (event.stamp.lamport == 0 && event.fresh) {
+      event.stamp = { claimClock + 1, event.box };  // new bare name: a fresh claim by that box
+    }
+    advanceClaimClock(event.stamp.lamport);
+    if (!claimNewer(event.stamp, controlActiveStamp)) {
+      if (event.source == ACTIVE_SOURCE_CLOUD && controlActiveStamp.origin == thisBoxId() &&
+          claimNewer(controlActiveStamp, event.stamp)) {
+        // The cloud holds an older claim than ours (e.g. its sync after an
+        // outage): write ours back instead of letting the last writer win.
+        // Another box's claim is that box's to defend.
+        staleClaimsAnswered++;
+        queueClaimPublish(controlActiveBox, controlActiveStamp);
+        LOG_INFO("Ignoring stale claim for %s — republishing %s", boxName(event.box),
+                 boxName(controlActiveBox));
+      }
+      staleClaimsIgnored++;
+      continue;
+    }
+    controlActiveStamp = event.stamp;
+    if (event.box == controlActiveBox) continue;
+    controlActiveBox = event.box;
+    controlActiveMask = boxBit(event.box);
+#if defined(LIGHT_SLEEP_IDLE)
+    noteWakeEvent(event.received_us);
+#endif
+    LOG_INFO("Active Box Changed to: %s%s", boxName(controlActiveBox),
+             event.source == ACTIVE_SOURCE_LINK ? " (peer link)" : "");
+    // Set stateChanged to true. This causes modifyMotorState() to run on the next loop even with not changes to
+    // switch positions which will trigger the motor to run based on the active_box variable and the current switch positions
+    stateChanged = true;
+  }
+}
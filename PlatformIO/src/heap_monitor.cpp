@@ -0,0 +1,87 @@
+/*
+  Useless Boxes - Heap Monitor
+  -------------------------
+  Tracks free heap, the low-water mark and fragmentation against the
+  post-boot baseline. See heap_monitor.h.
+  -------------------------
+*/
+#include "heap_monitor.h"
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "log.h"
+
+namespace {
+  HeapSnapshot baseline = {};
+  uint32_t worstLargestBlock = 0;
+  uint8_t worstFragmentationPct = 0;
+  unsigned long lastSampleAt = 0;
+  unsigned long lastReportAt = 0;
+  bool lowBlockWarned = false;
+
+  void sample() {
+    HeapSnapshot now = heapSnapshot();
+    if (now.largestBlock < worstLargestBlock) worstLargestBlock = now.largestBlock;
+    if (now.fragmentationPct > worstFragmentationPct) worstFragmentationPct = now.fragmentationPct;
+    if (now.largestBlock < HEAP_LOW_BLOCK_WARN_BYTES) {
+      if (!lowBlockWarned) {
+        LOG_WARN("⚠️ Heap: largest free block %lu bytes (%u%% fragmented)",
+                 (unsigned long)now.largestBlock, (unsigned)now.fragmentationPct);
+      }
+      lowBlockWarned = true;
+    } else {
+      lowBlockWarned = false;
+    }
+  }
+}
+
+HeapSnapshot heapSnapshot() {
+  HeapSnapshot snap;
+  snap.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  snap.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  snap.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  snap.fragmentationPct = snap.freeBytes ? (uint8_t)(100 - (uint64_t)snap.largestBlock * 100 / snap.freeBytes) : 0;
+  return snap;
+}
+
+void beginHeapMonitor() {
+  baseline = heapSnapshot();
+  worstLargestBlock = baseline.largestBlock;
+  worstFragmentationPct = baseline.fragmentationPct;
+  lastSampleAt = lastReportAt = millis();
+  lowBlockWarned = false;
+  LOG_INFO("🧮 Heap after boot: %lu free, largest block %lu", (unsigned long)baseline.freeBytes,
+           (unsigned long)baseline.largestBlock);
+}
+
+void serviceHeapMonitor(unsigned long now) {
+  if (now - lastSampleAt >= HEAP_SAMPLE_INTERVAL_MS) {
+    lastSampleAt = now;
+    sample();
+  }
+  if (now - lastReportAt >= HEAP_REPORT_INTERVAL_MS) {
+    lastReportAt = now;
+    HeapSnapshot snap = heapSnapshot();
+    LOG_INFO("🧮 Heap: %lu free, %lu low-water, largest block %lu (%u%% fragmented)",
+             (unsigned long)snap.freeBytes, (unsigned long)snap.minFreeBytes,
+             (unsigned long)snap.largestBlock, (unsigned)snap.fragmentationPct);
+  }
+}
+
+void heapCommand(const char*) {
+  sample();
+  HeapSnapshot snap = heapSnapshot();
+  char line[96];
+  unsigned long uptimeMin = millis() / 60000;
+  snprintf(line, sizeof(line), "🧮 Heap after %lu h %lu min", uptimeMin / 60, uptimeMin % 60);
+  Serial.println(line);
+  snprintf(line, sizeof(line), "  free %lu bytes (boot %lu, %+ld)", (unsigned long)snap.freeBytes,
+           (unsigned long)baseline.freeBytes, (long)snap.freeBytes - (long)baseline.freeBytes);
+  Serial.println(line);
+  snprintf(line, sizeof(line), "  low-water %lu bytes", (unsigned long)snap.minFreeBytes);
+  Serial.println(line);
+  snprintf(line, sizeof(line), "  largest block %lu bytes, %u%% fragmented (worst %lu bytes, %u%%)",
+           (unsigned long)snap.largestBlock, (unsigned)snap.fragmentationPct,
+           (unsigned long)worstLargestBlock, (unsigned)worstFragmentationPct);
+  Serial.println(line);
+}
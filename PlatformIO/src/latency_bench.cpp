@@ -0,0 +1,382 @@
+/*
+  Useless Boxes - Latency Bench
+  -------------------------
+  Timestamps a claim from the driver's switch edge to the moment the
+  peer drives its motor output, over the cloud and peer-link paths. Compiled only with
+  -DLATENCY_BENCH. See latency_bench.h.
+  -------------------------
+*/
+#include "latency_bench.h"
+
+#if defined(LATENCY_BENCH)
+#include <sys/time.h>
+#include <time.h>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#include "Useless_Boxes.h"
+#include "latency_histogram.h"
+#include "log.h"
+
+namespace {
+  enum BenchStat {
+    BENCH_EDGE_TO_PUBLISH,   // t1 - t0   driver only
+    BENCH_EDGE_TO_CLOUD,     // t2c - t0
+    BENCH_EDGE_TO_LINK,      // t2l - t0
+    BENCH_ARRIVAL_TO_MOTOR,  // t3 - first arrival (peer local), motor started only
+    BENCH_EDGE_TO_MOTOR,     // t3 - t0   end to end, motor started only
+    BENCH_EDGE_TO_DECISION,  // decision - t0 for claims that left the motor stopped
+    BENCH_STAT_COUNT
+  };
+  const char* const BENCH_STAT_NAMES[BENCH_STAT_COUNT] = {
+    "edge->publish", "edge->cloud", "edge->link", "arrive->motor", "edge->motor", "edge->no start"
+  };
+
+  portMUX_TYPE benchMux = portMUX_INITIALIZER_UNLOCKED;
+
+  // Driver: the claim waiting for a peer report
+  struct OutstandingClaim {
+    BoxId box;
+    int64_t edgeWall;
+    int64_t publishWall;
+    bool open;
+  } claim = { BOX_ID_NONE, 0, 0, false };
+  int64_t pendingEdgeWall = 0;     // set by benchNoteEdge, consumed by benchNoteClaim
+
+  // Peer: arrivals for the most recent change
+  struct PeerObservation {
+    BoxId box;
+    int64_t cloudWall;
+    int64_t linkWall;
+    int64_t motorWall;
+    bool motorStarted;
+    bool awaitingMotor;
+    unsigned long firstArrivalMs;
+    bool open;
+  } observed = { BOX_ID_NONE, 0, 0, 0, false, false, 0, false };
+
+  // Written by the network task only; reports read them without locking
+  LatencyHistogram stats[BENCH_STAT_COUNT];
+  uint32_t reportsMatched = 0;
+  uint32_t reportsUnmatched = 0;
+  uint32_t noMotorStart = 0;
+  uint32_t clockSkewed = 0;
+
+  // Automated cycles (control task)
+  uint16_t cyclesRemaining = 0;
+  uint16_t cyclesTotal = 0;
+  unsigned long nextCycleAt = 0;
+  bool inputsTaken = false;         // the virtual switch replaces the real one
+
+  // Peer (`bench peer`): a virtual arm that runs each stroke and switches
+  // back on after the driver's release, so every claim meets a switch
+  // that is on and starts the motor (control task)
+  enum PeerArmStage : uint8_t {
+    ARM_OFF,
+    ARM_READY,        // home, switch on; next: a claim drives the motor
+    ARM_LEAVING,      // driving out; next: the limit is released
+    ARM_OUT,          // next: the arm knocks the switch off
+    ARM_RETURNING,    // next: the limit is pressed
+    ARM_HOME          // switch off; next: switch on after the driver's release
+  };
+  PeerArmStage armStage = ARM_OFF;
+  unsigned long armAt = 0;
+  bool releaseSeen = false;         // benchMux: a NONE claim arrived
+
+  int64_t wallNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+  }
+
+  // Convert an esp_timer_get_time() stamp taken earlier into wall time
+  int64_t wallFromMono(uint32_t monoUs) {
+    uint32_t age = (uint32_t)esp_timer_get_time() - monoUs;
+    return wallNowUs() - age;
+  }
+
+  bool clockSynced() {
+    return sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED || time(nullptr) > 1700000000;
+  }
+
+  void recordSpan(BenchStat stat, int64_t from, int64_t to) {
+    if (from == 0 || to == 0) return;
+    int64_t span = to - from;
+    if (span < 0) { clockSkewed++; span = 0; }
+    stats[stat].record(span > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)span);
+  }
+
+  void printBenchStats() {
+    Serial.println();
+    Serial.print("🏁 Latency bench (us) — clock ");
+    Serial.println(clockSynced() ? "synced" : "NOT synced");
+    Serial.println("span            count      min      p50      p90      p99      max");
+    char line[96];
+    for (int i = 0; i < BENCH_STAT_COUNT; i++) {
+      const LatencyHistogram& h = stats[i];
+      snprintf(line, sizeof(line), "%-14s %6lu %8lu %8lu %8lu %8lu %8lu", BENCH_STAT_NAMES[i],
+               (unsigned long)h.count(), (unsigned long)h.min(), (unsigned long)h.percentile(50),
+               (unsigned long)h.percentile(90), (unsigned long)h.percentile(99), (unsigned long)h.max());
+      Serial.println(line);
+    }
+    snprintf(line, sizeof(line), "matched %lu, unmatched %lu, no motor start %lu, skewed %lu, cycles left %u/%u",
+             (unsigned long)reportsMatched, (unsigned long)reportsUnmatched, (unsigned long)noMotorStart,
+             (unsigned long)clockSkewed, cyclesRemaining, cyclesTotal);
+    Serial.println(line);
+  }
+
+  void resetBenchStats() {
+    for (auto& h : stats) h.reset();
+    reportsMatched = reportsUnmatched = noMotorStart = clockSkewed = 0;
+  }
+}
+
+void beginLatencyBench() {
+  bench_report.reserve(BENCH_REPORT_MAX_LEN);
+  bench_report = "";
+}
+
+void onBenchCloudConnect() {
+  configTime(0, 0, BENCH_NTP_SERVER);
+}
+
+// ---------------- driver side ----------------
+void benchNoteEdge(uint32_t edgeMonoUs) {
+  int64_t wall = wallFromMono(edgeMonoUs);
+  portENTER_CRITICAL(&benchMux);
+  pendingEdgeWall = wall;
+  portEXIT_CRITICAL(&benchMux);
+}
+
+void benchNoteClaim(BoxId box) {
+  portENTER_CRITICAL(&benchMux);
+  if (pendingEdgeWall != 0) {
+    claim.box = box;
+    claim.edgeWall = pendingEdgeWall;
+    claim.publishWall = 0;
+    claim.open = true;
+    pendingEdgeWall = 0;
+  }
+  portEXIT_CRITICAL(&benchMux);
+}
+
+void benchNotePublish(BoxId box) {
+  int64_t wall = wallNowUs();
+  portENTER_CRITICAL(&benchMux);
+  if (claim.open && claim.box == box && claim.publishWall == 0) claim.publishWall = wall;
+  portEXIT_CRITICAL(&benchMux);
+}
+
+// ---------------- peer side ----------------
+void benchNoteArrival(BoxId box, BenchSource via, uint32_t monoUs) {
+  int64_t wall = wallFromMono(monoUs);
+  portENTER_CRITICAL(&benchMux);
+  if (!observed.open || observed.box != box) {
+    observed.box = box;
+    observed.cloudWall = 0;
+    observed.linkWall = 0;
+    observed.motorWall = 0;
+    observed.motorStarted = false;
+    observed.awaitingMotor = true;
+    observed.firstArrivalMs = millis();
+    observed.open = true;
+  }
+  int64_t& slot = (via == BENCH_VIA_LINK) ? observed.linkWall : observed.cloudWall;
+  if (slot == 0) slot = wall;
+  if (box == BOX_ID_NONE) releaseSeen = true;
+  portEXIT_CRITICAL(&benchMux);
+}
+
+// A start is timed when EN1 is driven (benchNoteMotorOutput); a decision
+// that leaves the motor stopped is final as it stands
+void benchNoteMotorDecision(bool started) {
+  int64_t wall = wallNowUs();
+  portENTER_CRITICAL(&benchMux);
+  if (observed.open && observed.awaitingMotor) {
+    observed.motorStarted = started;
+    if (!started) {
+      observed.motorWall = wall;
+      observed.awaitingMotor = false;
+    }
+  }
+  portEXIT_CRITICAL(&benchMux);
+}
+
+void benchNoteMotorOutput() {
+  int64_t wall = wallNowUs();
+  bool strokeStarts = armStage == ARM_READY;
+  if (strokeStarts) {
+    armStage = ARM_LEAVING;
+    armAt = millis() + BENCH_ARM_LEAVE_MS;
+  }
+  portENTER_CRITICAL(&benchMux);
+  if (strokeStarts) releaseSeen = false;   // only a release after this claim re-arms
+  if (observed.open && observed.awaitingMotor && observed.motorStarted) {
+    observed.motorWall = wall;
+    observed.awaitingMotor = false;
+  }
+  portEXIT_CRITICAL(&benchMux);
+}
+
+// ---------------- automated cycles ----------------
+namespace {
+  void stopCycles() {
+    cyclesRemaining = 0;
+    armStage = ARM_OFF;
+    inputsTaken = false;
+    takeVirtualInputs(false);
+  }
+
+  void servicePeerArm(unsigned long now) {
+    if (armStage == ARM_HOME) {
+      bool released;
+      portENTER_CRITICAL(&benchMux);
+      released = releaseSeen;
+      releaseSeen = false;
+      portEXIT_CRITICAL(&benchMux);
+      if (released) {
+        armStage = ARM_READY;   // the switch goes back on (this box claims)
+        armAt = now + BENCH_PEER_REARM_MS;
+        return;
+      }
+    }
+    if (armStage == ARM_OFF || (long)(now - armAt) < 0) return;
+    switch (armStage) {
+      case ARM_READY:
+        if (inputLevel(INPUT_SWITCH) == LOW) injectInputLevel(INPUT_SWITCH, HIGH);
+        armAt = now + BENCH_CYCLE_INTERVAL_MS;   // nothing due until a claim starts the stroke
+        break;
+      case ARM_LEAVING:
+        injectInputLevel(INPUT_LIMIT, LOW);
+        armStage = ARM_OUT;
+        armAt = now + BENCH_ARM_FORWARD_MS;
+        break;
+      case ARM_OUT:
+        injectInputLevel(INPUT_SWITCH, LOW);
+        armStage = ARM_RETURNING;
+        armAt = now + BENCH_ARM_RETURN_MS;
+        break;
+      case ARM_RETURNING:
+        injectInputLevel(INPUT_LIMIT, HIGH);
+        armStage = ARM_HOME;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Each cycle flips the virtual switch, so the claim goes through the edge
+// ring, debounce and handleSwitchDetection() like a real one
+void serviceLatencyBench(unsigned long now) {
+  if (armStage != ARM_OFF) {
+    servicePeerArm(now);
+    return;
+  }
+  if (!inputsTaken || (long)(now - nextCycleAt) < 0) return;
+  if (cyclesRemaining == 0) {
+    stopCycles(); // the last change has settled: back to the real switch
+    return;
+  }
+  // Alternate claim / release so every cycle changes active_box
+  injectInputLevel(INPUT_SWITCH, (cyclesRemaining % 2 == 0) ? HIGH : LOW);
+  cyclesRemaining--;
+  nextCycleAt = now + BENCH_CYCLE_INTERVAL_MS;
+  if (cyclesRemaining == 0) LOG_INFO("🏁 Bench cycles done — `bench` prints results");
+}
+
+unsigned long benchNextWake(bool& armed) {
+  armed = inputsTaken && armStage != ARM_HOME;   // at home the release claim wakes us
+  return armStage != ARM_OFF ? armAt : nextCycleAt;
+}
+
+// ---------------- reports ----------------
+// Peer: once the cloud copy has landed (or timed out) and the motor
+// decision is known, publish "reporter|box|t2c|t2l|t3|started".
+void serviceLatencyBenchNetwork(unsigned long now) {
+  PeerObservation snap;
+  bool ready = false;
+  portENTER_CRITICAL(&benchMux);
+  // Time out too: a change that didn't alter state never reaches the motor
+  if (observed.open && ((!observed.awaitingMotor && observed.cloudWall != 0) ||
+                        now - observed.firstArrivalMs >= BENCH_REPORT_TIMEOUT_MS)) {
+    snap = observed;
+    observed.open = false;
+    ready = true;
+  }
+  portEXIT_CRITICAL(&benchMux);
+  if (!ready) return;
+
+  char report[BENCH_REPORT_MAX_LEN];
+  snprintf(report, sizeof(report), "%s|%s|%lld|%lld|%lld|%d", boxName(thisBoxId()), boxName(snap.box),
+           (long long)snap.cloudWall, (long long)snap.linkWall, (long long)snap.motorWall,
+           snap.motorStarted ? 1 : 0);
+  bench_report = report;
+}
+
+// Driver: match a peer's report to the outstanding claim
+void onBenchReport() {
+  BoxName reporter;
+  BoxName box;
+  long long cloudWall = 0, linkWall = 0, motorWall = 0;
+  int started = 0;
+  if (sscanf(bench_report.c_str(), "%15[^|]|%15[^|]|%lld|%lld|%lld|%d",
+             reporter.text, box.text, &cloudWall, &linkWall, &motorWall, &started) != 6) {
+    return;
+  }
+  if (reporter.equals(boxName(thisBoxId()))) return;
+
+  OutstandingClaim c;
+  portENTER_CRITICAL(&benchMux);
+  c = claim;
+  bool matches = claim.open && findBoxId(box.c_str()) == claim.box;
+  if (matches) claim.open = false;
+  portEXIT_CRITICAL(&benchMux);
+  if (!matches) { reportsUnmatched++; return; }
+
+  reportsMatched++;
+  int64_t firstArrival = (linkWall != 0 && (cloudWall == 0 || linkWall < cloudWall)) ? linkWall : cloudWall;
+  recordSpan(BENCH_EDGE_TO_PUBLISH, c.edgeWall, c.publishWall);
+  recordSpan(BENCH_EDGE_TO_CLOUD, c.edgeWall, cloudWall);
+  recordSpan(BENCH_EDGE_TO_LINK, c.edgeWall, linkWall);
+  if (started) {
+    recordSpan(BENCH_ARRIVAL_TO_MOTOR, firstArrival, motorWall);
+    recordSpan(BENCH_EDGE_TO_MOTOR, c.edgeWall, motorWall);
+  } else {
+    // motorWall is the decision, not EN1: keep it out of the motor spans
+    noMotorStart++;
+    recordSpan(BENCH_EDGE_TO_DECISION, c.edgeWall, motorWall);
+  }
+}
+
+void benchCommand(const char* args) {
+  if (strncmp(args, "start", 5) == 0) {
+    if (!clockSynced()) Serial.println("⚠️ SNTP not synced yet — cross-box spans will be off");
+    int n = atoi(args + 5);
+    cyclesTotal = cyclesRemaining = (n > 0) ? n : BENCH_DEFAULT_CYCLES;
+    inputsTaken = true;
+    takeVirtualInputs(true);
+    injectInputLevel(INPUT_SWITCH, LOW);   // start from OFF, so the first claim is an edge
+    nextCycleAt = millis() + BENCH_CYCLE_INTERVAL_MS;
+    wakeControlTask();
+    Serial.print("🏁 Running ");
+    Serial.print(cyclesTotal);
+    Serial.println(" bench cycles");
+  } else if (strcmp(args, "peer") == 0) {
+    cyclesRemaining = 0;
+    inputsTaken = true;
+    takeVirtualInputs(true);
+    injectInputLevel(INPUT_LIMIT, HIGH);   // home, switch on: ready for the first claim
+    armStage = ARM_READY;
+    armAt = millis();
+    wakeControlTask();
+    Serial.println("🏁 Virtual arm on — run `bench start` on the driver, `bench stop` here when done");
+  } else if (strcmp(args, "stop") == 0) {
+    stopCycles();
+  } else if (strcmp(args, "reset") == 0) {
+    resetBenchStats();
+  } else {
+    printBenchStats();
+  }
+}
+
+#endif // LATENCY_BENCH
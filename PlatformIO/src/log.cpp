@@ -0,0 +1,140 @@
+/*
+  Useless Boxes - Buffered Log
+  -------------------------
+  Bounded multi-producer ring (Vyukov's sequence-numbered slots) holding
+  unformatted records, and the drain that formats and prints them. Any
+  task may log; only one drain runs at a time.
+  -------------------------
+*/
+#include "log.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdio.h>
+
+namespace {
+  struct LogRecord {
+    std::atomic<uint32_t> sequence;  // slot state, see logWrite()/logDrain()
+    uint32_t ms;
+    const char* fmt;
+    uintptr_t args[LOG_MAX_ARGS];
+    uint8_t level;
+  };
+
+  constexpr uint32_t RING_MASK = LOG_RING_CAPACITY - 1;
+
+  LogRecord ring[LOG_RING_CAPACITY];
+  std::atomic<uint32_t> enqueuePos(0);
+  std::atomic<uint32_t> dequeuePos(0);
+  std::atomic<uint32_t> dropped(0);
+  std::atomic<uint32_t> droppedReported(0);
+  std::atomic_flag draining = ATOMIC_FLAG_INIT;
+
+  void printRecord(const LogRecord& rec) {
+    char line[LOG_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "[%7lu %c] ", (unsigned long)rec.ms, logLevelName(rec.level)[0]);
+    if (n < 0 || (size_t)n >= sizeof(line)) n = 0;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+    // Unused trailing arguments are ignored by snprintf
+    snprintf(line + n, sizeof(line) - n, rec.fmt, rec.args[0], rec.args[1], rec.args[2], rec.args[3]);
+#pragma GCC diagnostic pop
+    Serial.println(line);
+  }
+}
+
+void logBegin() {
+  for (uint32_t i = 0; i < LOG_RING_CAPACITY; i++) {
+    ring[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  enqueuePos.store(0, std::memory_order_relaxed);
+  dequeuePos.store(0, std::memory_order_relaxed);
+  dropped.store(0, std::memory_order_relaxed);
+  droppedReported.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+// A slot whose sequence equals the enqueue position is free; the producer
+// that wins the CAS on enqueuePos owns it until it publishes pos + 1.
+bool logWrite(uint8_t level, const char* fmt, const uintptr_t* args, uint8_t argc) {
+  uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+  LogRecord* rec;
+  for (;;) {
+    rec = &ring[pos & RING_MASK];
+    uint32_t seq = rec->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(seq - pos);
+    if (diff == 0) {
+      if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed); // full: drop, never block
+      return false;
+    } else {
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+  rec->ms = millis();
+  rec->fmt = fmt;
+  rec->level = level;
+  for (uint8_t i = 0; i < LOG_MAX_ARGS; i++) rec->args[i] = i < argc ? args[i] : 0;
+  rec->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+namespace {
+  // A published slot has sequence pos + 1; handing it back as pos + capacity
+  // frees it for the producer one lap later. Caller holds `draining`.
+  size_t drainHeld(size_t maxRecords) {
+    size_t printed = 0;
+    uint32_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (printed < maxRecords) {
+      LogRecord& rec = ring[pos & RING_MASK];
+      if ((int32_t)(rec.sequence.load(std::memory_order_acquire) - (pos + 1)) < 0) break; // empty
+      printRecord(rec);
+      rec.sequence.store(pos + LOG_RING_CAPACITY, std::memory_order_release);
+      pos++;
+      printed++;
+    }
+    dequeuePos.store(pos, std::memory_order_relaxed);
+
+    uint32_t lost = dropped.load(std::memory_order_relaxed);
+    uint32_t reported = droppedReported.load(std::memory_order_relaxed);
+    if (lost != reported) {
+      char line[48];
+      snprintf(line, sizeof(line), "[log] %lu dropped", (unsigned long)(lost - reported));
+      Serial.println(line);
+      droppedReported.store(lost, std::memory_order_relaxed);
+    }
+    return printed;
+  }
+}
+
+size_t logDrain(size_t maxRecords) {
+  if (draining.test_and_set(std::memory_order_acquire)) return 0; // another task is draining
+  size_t printed = drainHeld(maxRecords);
+  draining.clear(std::memory_order_release);
+  return printed;
+}
+
+// The log task may be partway through printing the ring: wait for it
+// (sleeping, so a lower-priority drain can run), then empty the rest
+// while holding the flag so nothing else interleaves.
+void logFlush() {
+  while (draining.test_and_set(std::memory_order_acquire)) delay(1);
+  while (drainHeld(LOG_RING_CAPACITY) == LOG_RING_CAPACITY) {}
+  draining.clear(std::memory_order_release);
+}
+
+uint32_t logDropped() {
+  return dropped.load(std::memory_order_relaxed);
+}
+
+const char* logLevelName(uint8_t level) {
+  switch (level) {
+    case LOG_LEVEL_ERROR: return "ERROR";
+    case LOG_LEVEL_WARN:  return "WARN";
+    case LOG_LEVEL_INFO:  return "INFO";
+    case LOG_LEVEL_DEBUG: return "DEBUG";
+    default:              return "?";
+  }
+}
@@ -0,0 +1,82 @@
+/*
+  Useless Boxes - Loop Profiler
+  -------------------------
+  Per-stage latency histograms for the control and network loops.
+  Compiled only with -DLOOP_PROFILING.
+  -------------------------
+*/
+#include "loop_profiler.h"
+
+#if defined(LOOP_PROFILING)
+#include <Arduino.h>
+#include "latency_histogram.h"
+
+namespace {
+  // Each histogram has a single writer: STAGE_CLOUD_UPDATE is recorded by
+  // the network task, every other stage by the control task. Reports read
+  // without locking and may be off by a sample, which is fine for timing.
+  LatencyHistogram stageHistograms[LOOP_STAGE_COUNT];
+  int64_t lastPassStart = 0;
+
+  const char* const STAGE_NAMES[LOOP_STAGE_COUNT] = {
+    "cloud", "inputs", "button", "switch", "motor", "rgb", "buzzer", "menu", "pass", "period"
+  };
+}
+
+void recordLoopStage(LoopStage stage, uint32_t micros) {
+  stageHistograms[stage].record(micros);
+}
+
+void markControlPassStart() {
+  int64_t now = esp_timer_get_time();
+  if (lastPassStart != 0) {
+    stageHistograms[STAGE_CONTROL_PERIOD].record((uint32_t)(now - lastPassStart));
+  }
+  lastPassStart = now;
+}
+
+void resetLoopProfile() {
+  for (auto& h : stageHistograms) h.reset();
+  lastPassStart = 0;
+}
+
+const LatencyHistogram& loopStageHistogram(LoopStage stage) {
+  return stageHistograms[stage];
+}
+
+const char* loopStageName(LoopStage stage) {
+  return STAGE_NAMES[stage];
+}
+
+void printLoopProfile() {
+  Serial.println();
+  Serial.println("⏱️ Loop profile (us)");
+  Serial.println("stage      count      min      p50      p99      max");
+  char line[80];
+  for (int i = 0; i < LOOP_STAGE_COUNT; i++) {
+    const LatencyHistogram& h = stageHistograms[i];
+    snprintf(line, sizeof(line), "%-8s %8lu %8lu %8lu %8lu %8lu",
+             STAGE_NAMES[i], (unsigned long)h.count(), (unsigned long)h.min(),
+             (unsigned long)h.percentile(50), (unsigned long)h.percentile(99),
+             (unsigned long)h.max());
+    Serial.println(line);
+  }
+}
+
+// "stage:p50/p99/max;..." — small enough for a single cloud String property
+size_t formatLoopProfile(char* out, size_t len) {
+  size_t used = 0;
+  if (len == 0) return 0;
+  out[0] = '\0';
+  for (int i = 0; i < LOOP_STAGE_COUNT && used < len; i++) {
+    const LatencyHistogram& h = stageHistograms[i];
+    int n = snprintf(out + used, len - used, "%s%s:%lu/%lu/%lu", i ? ";" : "", STAGE_NAMES[i],
+                     (unsigned long)h.percentile(50), (unsigned long)h.percentile(99),
+                     (unsigned long)h.max());
+    if (n < 0) break;
+    used += (size_t)n;
+  }
+  return used < len ? used : len - 1;
+}
+
+#endif // LOOP_PROFILING
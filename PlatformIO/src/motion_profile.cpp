@@ -0,0 +1,81 @@
+/*
+  Useless Boxes - Motion Profile
+  -------------------------
+  Ramp math for the arm's strokes; the stroke/brake state machine that
+  uses it lives with the motor code in Useless_Boxes.cpp.
+  -------------------------
+*/
+#include "motion_profile.h"
+
+namespace {
+  constexpr uint16_t FULL = 1000; // per mille
+
+  // Position along a ramp of `length` ms at `t`, 0-1000
+  uint16_t rampFraction(MotionShape shape, uint32_t t, uint32_t length) {
+    if (length == 0 || t >= length) return FULL;
+    uint32_t x = t * FULL / length;
+    if (shape == MOTION_SCURVE) {
+      // smoothstep 3x^2 - 2x^3, x in per mille
+      return (uint16_t)(x * x / FULL * (3 * FULL - 2 * x) / FULL);
+    }
+    return (uint16_t)x;
+  }
+
+  uint16_t blend(uint16_t from, uint16_t to, uint16_t fraction) {
+    return (uint16_t)(from + ((int32_t)to - (int32_t)from) * fraction / FULL);
+  }
+
+  uint16_t perMille(uint8_t percent) {
+    return (uint16_t)(percent > 100 ? FULL : percent * 10);
+  }
+
+  // When the ramp down to approachSpeed begins; false if there is none
+  bool decelStart(const MotionProfile& p, uint32_t expectedMs, uint32_t& startMs) {
+    if (expectedMs == 0 || p.approachMs == 0) return false;
+    uint32_t lead = (uint32_t)p.approachMs + p.accelMs;
+    startMs = expectedMs > lead ? expectedMs - lead : 0;
+    return true;
+  }
+}
+
+uint16_t motionSpeedAt(const MotionProfile& p, uint32_t elapsedMs,
+                       uint32_t expectedMs, uint8_t cruiseSpeed) {
+  uint16_t cruise = perMille(cruiseSpeed);
+  if (p.shape == MOTION_STEP || cruise == 0) return cruise;
+
+  uint16_t start = perMille(p.startSpeed);
+  if (start > cruise) start = cruise;
+  uint16_t speed = blend(start, cruise, rampFraction(p.shape, elapsedMs, p.accelMs));
+
+  uint32_t decelAt;
+  if (decelStart(p, expectedMs, decelAt) && elapsedMs >= decelAt) {
+    uint16_t approach = perMille(p.approachSpeed);
+    if (approach > cruise) approach = cruise;
+    uint16_t slowing = blend(cruise, approach, rampFraction(p.shape, elapsedMs - decelAt, p.accelMs));
+    if (slowing < speed) speed = slowing; // short strokes: the two ramps overlap
+  }
+  return speed;
+}
+
+bool motionRamping(const MotionProfile& p, uint32_t elapsedMs,
+                   uint32_t expectedMs, uint8_t cruiseSpeed, uint32_t& nextChangeMs) {
+  nextChangeMs = 0;
+  if (p.shape == MOTION_STEP || cruiseSpeed == 0) return false;
+  if (elapsedMs < p.accelMs) return true;
+  uint32_t decelAt;
+  if (!decelStart(p, expectedMs, decelAt)) return false;
+  if (elapsedMs < decelAt) {
+    nextChangeMs = decelAt;
+    return false;
+  }
+  return elapsedMs < decelAt + p.accelMs;
+}
+
+const char* motionShapeName(MotionShape shape) {
+  switch (shape) {
+    case MOTION_STEP:      return "step";
+    case MOTION_TRAPEZOID: return "trapezoid";
+    case MOTION_SCURVE:    return "s-curve";
+    default:               return "unknown";
+  }
+}
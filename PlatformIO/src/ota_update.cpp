@@ -0,0 +1,174 @@
+/*
+  Useless Boxes - OTA Updates
+  -------------------------
+  Gates Arduino Cloud OTA on a parked arm, holds strokes while the image
+  streams, and validates the first boot of a new image on local health.
+  See ota_update.h.
+  -------------------------
+*/
+#include "ota_update.h"
+
+#include <ArduinoIoTCloud.h>
+#include <esp_ota_ops.h>
+#include <atomic>
+#include "log.h"
+
+namespace {
+  constexpr size_t OTA_STATUS_MAX_LEN = 64;   // bytes of the `firmware_version` text
+
+  OtaReadyCheck readyCheck = nullptr;
+  OtaImageState imageState = OTA_IMAGE_VALID;
+  unsigned long bootAt = 0;
+  bool cloudReached = false;          // since boot; reported, not required
+  bool statusPublished = false;
+  uint32_t deferredRequests = 0;
+  volatile unsigned long lastControlPassAt = 0;
+
+  std::atomic<bool> downloadHold(false);
+  unsigned long downloadConfirmedAt = 0;
+
+  // ArduinoIoTCloud asks before it starts a download; false re-asks on a
+  // later poll, so a request made mid-stroke just waits for the arm. The
+  // hold goes up before the arm is checked: modifyMotorState() sets the
+  // direction before it checks the hold, so one side always sees the other.
+  bool onOtaRequest() {
+    downloadHold.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (readyCheck && !readyCheck()) {
+      downloadHold.store(false);
+      if (deferredRequests++ == 0) LOG_INFO("⬇️ OTA update waiting for the arm to park");
+      return false;
+    }
+    LOG_INFO("⬇️ OTA update starting (%s running) — strokes held", FIRMWARE_VERSION);
+    downloadConfirmedAt = millis();
+    deferredRequests = 0;
+    return true;
+  }
+
+  void rollBack(const char* why) {
+    imageState = OTA_IMAGE_ROLLING_BACK;
+    LOG_ERROR("⬆️ Firmware %s — rolling back", why);
+    logFlush();
+    // Reboots into the previous image; returns an error if there is none
+    if (esp_ota_mark_app_invalid_rollback_and_reboot() != ESP_OK) {
+      esp_ota_mark_app_valid_cancel_rollback();
+      imageState = OTA_IMAGE_VALID;
+      LOG_ERROR("⬆️ No previous image — keeping this one");
+      statusPublished = false;
+    }
+  }
+
+  const char* imageStateName(OtaImageState state) {
+    switch (state) {
+      case OTA_IMAGE_VALID:        return "valid";
+      case OTA_IMAGE_PENDING:      return "pending verify";
+      case OTA_IMAGE_ROLLING_BACK: return "rolling back";
+      default:                     return "unknown";
+    }
+  }
+
+  const char* runningPartitionLabel() {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    return running ? running->label : "?";
+  }
+
+  void publishStatus() {
+    char status[OTA_STATUS_MAX_LEN];
+    snprintf(status, sizeof(status), "%s (%s, %s)", FIRMWARE_VERSION, runningPartitionLabel(),
+             imageStateName(imageState));
+    firmware_version = status;
+    statusPublished = true;
+  }
+}
+
+// The Arduino core marks every image valid during boot unless this says
+// the sketch will; only matters when the bootloader has rollback enabled.
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+void beginOtaUpdates(OtaReadyCheck ready) {
+  readyCheck = ready;
+  firmware_version.reserve(OTA_STATUS_MAX_LEN);
+  bootAt = millis();
+  lastControlPassAt = bootAt;
+  cloudReached = false;
+  statusPublished = false;
+  deferredRequests = 0;
+  downloadHold.store(false);
+  imageState = OTA_IMAGE_VALID;
+  esp_ota_img_states_t state;
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  if (running && esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+    imageState = OTA_IMAGE_PENDING;
+    LOG_WARN("⬆️ New firmware on %s — validating (kept after %lu s of healthy running)", runningPartitionLabel(),
+             (unsigned long)(OTA_VALIDATE_HEALTHY_MS / 1000));
+  }
+  ArduinoCloud.onOTARequestCb(onOtaRequest);
+}
+
+void serviceOtaUpdates(unsigned long now) {
+  bool connected = ArduinoCloud.connected();
+  if (connected) cloudReached = true;
+
+  if (downloadHold.load() && now - downloadConfirmedAt >= OTA_DOWNLOAD_HOLD_MS) {
+    downloadHold.store(false);
+    LOG_WARN("⬇️ OTA download never rebooted the box — strokes released");
+  }
+
+  if (imageState == OTA_IMAGE_PENDING) {
+    // The control task (other core) may have passed since `now` was
+    // sampled: a pass "after now" is no stall, so compare signed
+    unsigned long passAt = lastControlPassAt;
+    if ((long)(now - passAt) >= (long)OTA_CONTROL_STALL_MS) {
+      rollBack("control loop stalled");
+    } else if (now - bootAt >= OTA_VALIDATE_HEALTHY_MS) {
+      esp_ota_mark_app_valid_cancel_rollback();
+      imageState = OTA_IMAGE_VALID;
+      statusPublished = false;
+      if (cloudReached) LOG_INFO("⬆️ Firmware %s validated", FIRMWARE_VERSION);
+      else LOG_WARN("⬆️ Firmware %s validated on local health — cloud not reached yet", FIRMWARE_VERSION);
+    }
+  }
+  if (!statusPublished && connected) publishStatus();
+}
+
+void otaNoteControlPass(unsigned long now) {
+  lastControlPassAt = now;
+}
+
+// The fence orders the caller's motorDirection store before the load
+bool otaHoldsStrokes() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return downloadHold.load();
+}
+
+OtaImageState otaImageState() {
+  return imageState;
+}
+
+void otaCommand(const char*) {
+  Serial.print("⬆️ Firmware ");
+  Serial.print(FIRMWARE_VERSION);
+  Serial.print(" on ");
+  Serial.print(runningPartitionLabel());
+  Serial.print(": ");
+  Serial.println(imageStateName(imageState));
+  if (imageState == OTA_IMAGE_PENDING) {
+    Serial.print("  kept in ");
+    unsigned long elapsed = millis() - bootAt;
+    Serial.print(elapsed < OTA_VALIDATE_HEALTHY_MS ? (OTA_VALIDATE_HEALTHY_MS - elapsed) / 1000 : 0);
+    Serial.print(" s unless the box resets or the control loop stalls; cloud ");
+    Serial.println(cloudReached ? "reached" : "not reached yet");
+  }
+  if (downloadHold.load()) {
+    Serial.print("  download in progress, strokes held (");
+    Serial.print((millis() - downloadConfirmedAt) / 1000);
+    Serial.println(" s)");
+  }
+  if (deferredRequests > 0) {
+    Serial.print("  update waiting for the arm to park (");
+    Serial.print(deferredRequests);
+    Serial.println(" checks)");
+  }
+}
@@ -0,0 +1,174 @@
+/*
+  Useless Boxes - Peer Link
+  -------------------------
+  ESP-NOW broadcast of active-box claims between boxes, with sequence
+  numbers so repeats (and cloud echoes) fire the motor only once.
+  Compiled only with -DPEER_LINK_ESPNOW. See peer_link.h.
+  -------------------------
+*/
+#include "peer_link.h"
+
+#if defined(PEER_LINK_ESPNOW)
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_timer.h>
+#include "board_pins.h"
+#include "log.h"
+
+namespace {
+  constexpr uint16_t PEER_LINK_MAGIC = 0x4C55;   // "UL"
+  constexpr uint8_t PEER_LINK_VERSION = 2;      // 2: claims carry a Lamport stamp
+  constexpr uint8_t FRAME_ACTIVE_BOX = 1;
+  const uint8_t BROADCAST_MAC[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+  // Names on the wire: BoxIds are only meaningful on the device that made them
+  struct __attribute__((packed)) PeerLinkFrame {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint32_t bootId;                 // random per boot, so a reboot's seq restart isn't "old"
+    uint32_t seq;
+    uint32_t lamport;                // claim stamp; the origin breaks ties
+    BoxName origin;
+    BoxName active;
+  };
+
+  struct PeerSeen {
+    uint32_t bootId;
+    uint32_t seq;
+    bool valid;
+  };
+
+  PeerLinkActiveHandler activeHandler = nullptr;
+  bool linkUp = false;
+  uint32_t ownBootId = 0;
+  uint32_t nextSeq = 1;
+
+  // Outgoing frame + repeat schedule, shared by the control and network tasks
+  portMUX_TYPE txMux = portMUX_INITIALIZER_UNLOCKED;
+  PeerLinkFrame txFrame;
+  uint8_t txRemaining = 0;
+  unsigned long txLastSend = 0;
+
+  // Only touched from the Wi-Fi task's receive callback
+  PeerSeen lastSeen[MAX_BOXES + 1];
+
+  volatile uint32_t framesSent = 0;
+  volatile uint32_t framesReceived = 0;
+  volatile uint32_t framesDuplicate = 0;
+  volatile uint32_t framesRejected = 0;
+
+  void sendFrame(const PeerLinkFrame& frame) {
+    if (esp_now_send(BROADCAST_MAC, (const uint8_t*)&frame, sizeof(frame)) == ESP_OK) {
+      framesSent = framesSent + 1;
+    }
+  }
+
+  // Wi-Fi task context: keep it short, hand the result to the handler
+  void onPeerLinkReceive(const uint8_t* mac, const uint8_t* data, int len) {
+    (void)mac;
+    uint32_t receivedUs = (uint32_t)esp_timer_get_time();
+    PeerLinkFrame frame;
+    if (len != (int)sizeof(frame)) { framesRejected = framesRejected + 1; return; }
+    memcpy(&frame, data, sizeof(frame));
+    if (frame.magic != PEER_LINK_MAGIC || frame.version != PEER_LINK_VERSION ||
+        frame.type != FRAME_ACTIVE_BOX) {
+      framesRejected = framesRejected + 1;
+      return;
+    }
+    frame.origin.terminate();
+    frame.active.terminate();
+
+    BoxId origin = registerBoxName(frame.origin.c_str());
+    if (origin == BOX_ID_NONE || origin == thisBoxId()) { framesRejected = framesRejected + 1; return; }
+
+    PeerSeen& seen = lastSeen[origin];
+    if (seen.valid && seen.bootId == frame.bootId && (int32_t)(frame.seq - seen.seq) <= 0) {
+      framesDuplicate = framesDuplicate + 1;
+      return;
+    }
+    seen.bootId = frame.bootId;
+    seen.seq = frame.seq;
+    seen.valid = true;
+    framesReceived = framesReceived + 1;
+
+    ClaimStamp stamp = { frame.lamport, origin };
+    if (activeHandler) activeHandler(registerBoxName(frame.active.c_str()), stamp, receivedUs);
+  }
+}
+
+bool beginPeerLink(PeerLinkActiveHandler handler) {
+  activeHandler = handler;
+  ownBootId = esp_random();
+  if (esp_now_init() != ESP_OK) {
+    LOG_WARN("⚠️ ESP-NOW init failed — peer link disabled, cloud only");
+    return false;
+  }
+  esp_now_peer_info_t peer;
+  memset(&peer, 0, sizeof(peer));
+  memcpy(peer.peer_addr, BROADCAST_MAC, sizeof(BROADCAST_MAC));
+  peer.channel = 0;            // follow the STA's current (AP) channel
+  peer.ifidx = WIFI_IF_STA;
+  peer.encrypt = false;
+  if (esp_now_add_peer(&peer) != ESP_OK || esp_now_register_recv_cb(onPeerLinkReceive) != ESP_OK) {
+    LOG_WARN("⚠️ ESP-NOW peer setup failed — peer link disabled, cloud only");
+    esp_now_deinit();
+    return false;
+  }
+  linkUp = true;
+  return true;
+}
+
+void peerLinkAnnounce(BoxId active, uint32_t lamport) {
+  if (!linkUp) return;
+  PeerLinkFrame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.magic = PEER_LINK_MAGIC;
+  frame.version = PEER_LINK_VERSION;
+  frame.type = FRAME_ACTIVE_BOX;
+  frame.bootId = ownBootId;
+  frame.lamport = lamport;
+  frame.origin.set(BOX_NAME);
+  frame.active.set(boxName(active));
+
+  portENTER_CRITICAL(&txMux);
+  frame.seq = nextSeq++;
+  txFrame = frame;
+  txRemaining = PEER_LINK_REPEATS - 1;
+  txLastSend = millis();
+  portEXIT_CRITICAL(&txMux);
+
+  sendFrame(frame); // first copy goes out immediately
+}
+
+void servicePeerLink(unsigned long now) {
+  if (!linkUp) return;
+  PeerLinkFrame frame;
+  bool due = false;
+  portENTER_CRITICAL(&txMux);
+  if (txRemaining > 0 && now - txLastSend >= PEER_LINK_REPEAT_INTERVAL_MS) {
+    frame = txFrame;
+    txRemaining--;
+    txLastSend = now;
+    due = true;
+  }
+  portEXIT_CRITICAL(&txMux);
+  if (due) sendFrame(frame);
+}
+
+void printPeerLinkStats() {
+  Serial.println();
+  Serial.print("📶 ESP-NOW peer link: ");
+  Serial.println(linkUp ? "up" : "down (cloud only)");
+  Serial.print("  sent ");
+  Serial.print(framesSent);
+  Serial.print(", received ");
+  Serial.print(framesReceived);
+  Serial.print(", duplicates ");
+  Serial.print(framesDuplicate);
+  Serial.print(", rejected ");
+  Serial.println(framesRejected);
+}
+
+#endif // PEER_LINK_ESPNOW
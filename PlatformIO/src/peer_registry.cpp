@@ -0,0 +1,91 @@
+/*
+  Useless Boxes - Peer Registry
+  -------------------------
+  Maps box names to small numeric IDs so box state can be kept as a
+  bitmask. See peer_registry.h.
+  -------------------------
+*/
+#include "peer_registry.h"
+#include <Arduino.h>
+#include "board_pins.h"
+
+namespace {
+  // Boxes with built-in board files; keep their order stable so their IDs
+  // match across firmware versions.
+  const char* const KNOWN_BOX_NAMES[] = { "MICHAEL", "TREVOR" };
+
+  BoxName boxNames[MAX_BOXES];
+  volatile uint8_t boxCount = 0;   // published after the name is written
+  portMUX_TYPE registryMux = portMUX_INITIALIZER_UNLOCKED; // serialises writers
+  BoxId ownId = BOX_ID_NONE;
+
+  bool isNoneName(const char* name) {
+    return name == nullptr || name[0] == '\0' || strcmp(name, BOX_NAME_NONE) == 0;
+  }
+}
+
+void initPeerRegistry() {
+  for (const char* name : KNOWN_BOX_NAMES) registerBoxName(name);
+  ownId = registerBoxName(BOX_NAME);
+}
+
+BoxId thisBoxId() {
+  return ownId;
+}
+
+BoxId findBoxId(const char* name) {
+  if (isNoneName(name)) return BOX_ID_NONE;
+  uint8_t count = boxCount;
+  for (uint8_t i = 0; i < count; i++) {
+    if (boxNames[i].equals(name)) return i + 1;
+  }
+  return BOX_ID_NONE;
+}
+
+BoxId registerBoxName(const char* name) {
+  BoxId id = findBoxId(name);
+  if (id != BOX_ID_NONE || isNoneName(name)) return id;
+  bool full = false;
+  portENTER_CRITICAL(&registryMux);
+  id = findBoxId(name); // another writer may have added it meanwhile
+  if (id == BOX_ID_NONE) {
+    if (boxCount >= MAX_BOXES) {
+      full = true;
+    } else {
+      boxNames[boxCount].set(name);
+      boxCount = boxCount + 1;
+      id = boxCount;
+    }
+  }
+  portEXIT_CRITICAL(&registryMux);
+  if (full) {
+    // Printed directly: `name` is the caller's buffer, too short-lived for
+    // a deferred LOG_WARN()
+    Serial.print("⚠️ Peer registry full — ignoring box ");
+    Serial.println(name);
+  }
+  return id;
+}
+
+const char* boxName(BoxId id) {
+  if (id == BOX_ID_NONE || id > boxCount) return BOX_NAME_NONE;
+  return boxNames[id - 1].c_str();
+}
+
+uint8_t registeredBoxCount() {
+  return boxCount;
+}
+
+void printPeerRegistry(BoxMask active) {
+  Serial.println();
+  Serial.println("📡 Known boxes");
+  for (BoxId id = 1; id <= boxCount; id++) {
+    Serial.print("  ");
+    Serial.print(id);
+    Serial.print(": ");
+    Serial.print(boxNames[id - 1].c_str());
+    if (id == ownId) Serial.print(" (this box)");
+    if (active & boxBit(id)) Serial.print(" [active]");
+    Serial.println();
+  }
+}
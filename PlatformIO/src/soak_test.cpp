@@ -0,0 +1,344 @@
+/*
+  Useless Boxes - Soak Test
+  -------------------------
+  Runs thousands of switch -> arm -> limit cycles against a virtual arm or
+  a switch fixture and reports reaction-time histograms, loop timings,
+  heap and NVS writes as one JSON line. Compiled only with -DSOAK_TEST.
+  See soak_test.h.
+  -------------------------
+*/
+#include "soak_test.h"
+
+#if defined(SOAK_TEST)
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include "Useless_Boxes.h"
+#include "latency_histogram.h"
+#include "loop_profiler.h"
+#include "heap_monitor.h"
+#include "ota_update.h"
+#include "log.h"
+
+namespace {
+  enum SoakPhase : uint8_t {
+    SOAK_IDLE,
+    SOAK_REST,            // gap between cycles; next: switch ON
+    SOAK_CLAIMING,        // switch ON, this box claimed; next: peer claim
+    SOAK_FORWARD_WAIT,    // peer claim posted; waiting for the forward drive
+    SOAK_FORWARD,         // arm travelling out; waiting for the switch-off edge
+    SOAK_REVERSE_WAIT,    // switch knocked off; waiting for the reverse drive
+    SOAK_RETURN           // arm travelling back; waiting for the stop
+  };
+
+  enum SoakStat {
+    SOAK_CLAIM_TO_FORWARD,
+    SOAK_SWITCH_TO_REVERSE,
+    SOAK_LIMIT_TO_STOP,
+    SOAK_CYCLE,
+    SOAK_STAT_COUNT
+  };
+  const char* const SOAK_STAT_NAMES[SOAK_STAT_COUNT] = { "claim_us", "reverse_us", "stop_us", "cycle_us" };
+
+  // Control task only, apart from nvsWrites
+  LatencyHistogram stats[SOAK_STAT_COUNT];
+  SoakPhase phase = SOAK_IDLE;
+  uint32_t cyclesTotal = 0;
+  uint32_t cyclesDone = 0;
+  uint32_t cycleTimeouts = 0;
+  unsigned long phaseAt = 0;        // ms: the phase's next action, or the cycle timeout
+  unsigned long cycleStartMs = 0;
+  uint32_t cycleStartUs = 0;
+  uint32_t claimPostedUs = 0;
+  uint32_t claimToForwardUs = 0;    // this cycle's, for the SOAK_CYCLE line
+  uint32_t switchToReverseUs = 0;
+  uint32_t switchOffEdgeUs = 0;
+  uint32_t limitPressEdgeUs = 0;
+  bool limitPressSeen = false;
+#if defined(SOAK_FIXTURE_PIN)
+  bool fixtureHeld = false;
+#else
+  unsigned long armStartedMs = 0;   // drive decision that started the current stroke
+  bool limitLeft = false;           // forward travel has released the limit
+#endif
+  unsigned long runStartMs = 0;
+  unsigned long runEndMs = 0;
+  HeapSnapshot heapAtStart = {};
+  HeapSnapshot heapAtEnd = {};
+  BoxId peerBox = BOX_ID_NONE;
+  BoxId activeBeforeRun = BOX_ID_NONE;   // claim the run displaced, restored by finishRun()
+  ClaimStamp stampBeforeRun = { 0, BOX_ID_NONE };
+
+  portMUX_TYPE nvsMux = portMUX_INITIALIZER_UNLOCKED;
+  uint32_t nvsWrites = 0;           // since boot
+  uint32_t nvsWritesAtStart = 0;
+  uint32_t nvsWritesAtEnd = 0;
+
+  uint32_t nowUs() { return (uint32_t)esp_timer_get_time(); }
+
+  uint32_t nvsWriteCount() {
+    portENTER_CRITICAL(&nvsMux);
+    uint32_t count = nvsWrites;
+    portEXIT_CRITICAL(&nvsMux);
+    return count;
+  }
+
+  // The arm at rest: switch off, limit pressed
+  void restInputs() {
+#if !defined(SOAK_FIXTURE_PIN)
+    injectInputLevel(INPUT_SWITCH, LOW);
+    injectInputLevel(INPUT_LIMIT, HIGH);
+#endif
+  }
+
+  void waitForFirmware() { phaseAt = cycleStartMs + SOAK_CYCLE_TIMEOUT_MS; }
+
+  void pressSwitch(unsigned long now) {
+    cycleStartMs = now;
+    cycleStartUs = nowUs();
+    limitPressSeen = false;
+#if defined(SOAK_FIXTURE_PIN)
+    digitalWrite(SOAK_FIXTURE_PIN, HIGH);
+    fixtureHeld = true;
+#else
+    injectInputLevel(INPUT_SWITCH, HIGH);
+#endif
+    phase = SOAK_CLAIMING;
+    phaseAt = now + SOAK_PEER_DELAY_MS;
+  }
+
+  void printHistogram(const char* name, const LatencyHistogram& h, bool first) {
+    char item[144];
+    snprintf(item, sizeof(item),
+             "%s\"%s\":{\"n\":%lu,\"min\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu,\"mean\":%lu}",
+             first ? "" : ",", name, (unsigned long)h.count(), (unsigned long)h.min(),
+             (unsigned long)h.percentile(50), (unsigned long)h.percentile(90), (unsigned long)h.percentile(99),
+             (unsigned long)h.max(), (unsigned long)h.mean());
+    Serial.print(item);
+  }
+
+  // One line, so a log capture can be grepped for it and diffed
+  void printResult() {
+    bool running = phase != SOAK_IDLE;
+    HeapSnapshot heapNow = running ? heapSnapshot() : heapAtEnd;
+    unsigned long runMs = (running ? millis() : runEndMs) - runStartMs;
+    uint32_t writes = (running ? nvsWriteCount() : nvsWritesAtEnd) - nvsWritesAtStart;
+    char item[160];
+    snprintf(item, sizeof(item),
+             "SOAK_RESULT {\"soak\":1,\"fw\":\"%s\",\"box\":\"%s\",\"mode\":\"%s\",\"cycles\":%lu,"
+             "\"done\":%lu,\"timeouts\":%lu,\"run_ms\":%lu,",
+             FIRMWARE_VERSION, boxName(thisBoxId()),
+#if defined(SOAK_FIXTURE_PIN)
+             "fixture",
+#else
+             "virtual",
+#endif
+             (unsigned long)cyclesTotal, (unsigned long)cyclesDone, (unsigned long)cycleTimeouts, runMs);
+    Serial.print(item);
+    Serial.print("\"react\":{");
+    for (int i = 0; i < SOAK_STAT_COUNT; i++) printHistogram(SOAK_STAT_NAMES[i], stats[i], i == 0);
+    Serial.print("},\"loop_us\":{");
+    for (int i = 0; i < LOOP_STAGE_COUNT; i++) {
+      printHistogram(loopStageName((LoopStage)i), loopStageHistogram((LoopStage)i), i == 0);
+    }
+    snprintf(item, sizeof(item),
+             "},\"heap\":{\"free_start\":%lu,\"free_end\":%lu,\"min_free\":%lu,\"largest_end\":%lu,"
+             "\"frag_end\":%u},\"nvs_writes\":%lu}",
+             (unsigned long)heapAtStart.freeBytes, (unsigned long)heapNow.freeBytes,
+             (unsigned long)heapNow.minFreeBytes, (unsigned long)heapNow.largestBlock,
+             (unsigned)heapNow.fragmentationPct, (unsigned long)writes);
+    Serial.println(item);
+  }
+
+  void finishRun() {
+#if defined(SOAK_FIXTURE_PIN)
+    digitalWrite(SOAK_FIXTURE_PIN, LOW);
+    fixtureHeld = false;
+#else
+    restInputs();
+    takeVirtualInputs(false);
+#endif
+    phase = SOAK_IDLE;
+    // The run's claims (ours or the virtual peer's) go; a real one that came in meanwhile stays
+    ClaimStamp held = currentActiveStamp();
+    if (held.origin == thisBoxId() || held.origin == peerBox) restoreActiveClaim(activeBeforeRun, stampBeforeRun);
+    runEndMs = millis();
+    heapAtEnd = heapSnapshot();
+    nvsWritesAtEnd = nvsWriteCount();
+    LOG_INFO("🏁 Soak done: %lu cycles, %lu timed out", (unsigned long)cyclesDone, (unsigned long)cycleTimeouts);
+    printResult();
+  }
+
+  void endCycle(unsigned long now) {
+    cyclesDone++;
+    if (cyclesDone >= cyclesTotal) {
+      finishRun();
+      return;
+    }
+    phase = SOAK_REST;
+    phaseAt = now + SOAK_CYCLE_GAP_MS;
+  }
+}
+
+void beginSoakTest() {
+  peerBox = registerBoxName(SOAK_PEER_NAME);
+#if defined(SOAK_FIXTURE_PIN)
+  pinMode(SOAK_FIXTURE_PIN, OUTPUT);
+  digitalWrite(SOAK_FIXTURE_PIN, LOW);
+#endif
+}
+
+bool soakRunning() { return phase != SOAK_IDLE; }
+
+BoxId soakPeerBox() { return peerBox; }
+
+void soakNoteNvsWrite() {
+  portENTER_CRITICAL(&nvsMux);
+  nvsWrites++;
+  portEXIT_CRITICAL(&nvsMux);
+}
+
+void soakNoteInput(uint8_t channel, uint8_t level, uint32_t edgeUs) {
+  if (channel == INPUT_SWITCH && level == LOW && phase == SOAK_FORWARD) {
+    switchOffEdgeUs = edgeUs;
+    phase = SOAK_REVERSE_WAIT;
+    waitForFirmware();
+  } else if (channel == INPUT_LIMIT && level == HIGH && phase == SOAK_RETURN) {
+    limitPressEdgeUs = edgeUs;
+    limitPressSeen = true;
+  }
+}
+
+void soakNoteMotor(int direction) {
+  uint32_t now = nowUs();
+  if (direction == 1 && phase == SOAK_FORWARD_WAIT) {
+    claimToForwardUs = now - claimPostedUs;
+    stats[SOAK_CLAIM_TO_FORWARD].record(claimToForwardUs);
+    phase = SOAK_FORWARD;
+#if defined(SOAK_FIXTURE_PIN)
+    waitForFirmware();
+#else
+    armStartedMs = millis();
+    limitLeft = false;
+    phaseAt = armStartedMs + SOAK_ARM_LEAVE_MS;
+#endif
+  } else if (direction == -1 && phase == SOAK_REVERSE_WAIT) {
+    switchToReverseUs = now - switchOffEdgeUs;
+    stats[SOAK_SWITCH_TO_REVERSE].record(switchToReverseUs);
+    phase = SOAK_RETURN;
+#if defined(SOAK_FIXTURE_PIN)
+    waitForFirmware();
+#else
+    armStartedMs = millis();
+    phaseAt = armStartedMs + SOAK_ARM_RETURN_MS;
+#endif
+  } else if (direction == 0 && phase == SOAK_RETURN && limitPressSeen) {
+    stats[SOAK_LIMIT_TO_STOP].record(now - limitPressEdgeUs);
+    stats[SOAK_CYCLE].record(now - cycleStartUs);
+    LOG_INFO("SOAK_CYCLE %lu,%lu,%lu,%lu", (unsigned long)cyclesDone + 1, (unsigned long)claimToForwardUs,
+             (unsigned long)switchToReverseUs, (unsigned long)(now - limitPressEdgeUs));
+    endCycle(millis());
+  }
+}
+
+void serviceSoakTest(unsigned long now) {
+  if (phase == SOAK_IDLE) return;
+#if defined(SOAK_FIXTURE_PIN)
+  if (fixtureHeld && now - cycleStartMs >= SOAK_FIXTURE_PULSE_MS) {
+    digitalWrite(SOAK_FIXTURE_PIN, LOW);
+    fixtureHeld = false;
+  }
+#endif
+  if (phase != SOAK_REST && now - cycleStartMs >= SOAK_CYCLE_TIMEOUT_MS) {
+    cycleTimeouts++;
+    LOG_WARN("⚠️ Soak cycle %lu stuck (phase %u) — resetting the arm", (unsigned long)cyclesDone + 1,
+             (unsigned)phase);
+    restInputs();
+    endCycle(now);
+    return;
+  }
+  switch (phase) {
+    case SOAK_REST:
+      if ((long)(now - phaseAt) >= 0) pressSwitch(now);
+      break;
+    case SOAK_CLAIMING:
+      if ((long)(now - phaseAt) < 0) break;
+      claimPostedUs = nowUs();
+      phase = SOAK_FORWARD_WAIT;
+      waitForFirmware();
+      postSimulatedClaim(peerBox);
+      break;
+#if !defined(SOAK_FIXTURE_PIN)
+    case SOAK_FORWARD:
+      if ((long)(now - phaseAt) < 0) break;
+      if (!limitLeft) {
+        limitLeft = true;
+        injectInputLevel(INPUT_LIMIT, LOW);
+        phaseAt = armStartedMs + SOAK_ARM_FORWARD_MS;
+      } else {
+        injectInputLevel(INPUT_SWITCH, LOW);
+        waitForFirmware();   // the settled edge moves us on
+      }
+      break;
+    case SOAK_RETURN:
+      if (limitPressSeen || (long)(now - phaseAt) < 0) break;
+      injectInputLevel(INPUT_LIMIT, HIGH);
+      waitForFirmware();
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+// The phase's next action (never later than the cycle timeout) or the fixture release
+unsigned long soakNextWake(bool& armed) {
+  armed = phase != SOAK_IDLE;
+  unsigned long due = phaseAt;
+#if defined(SOAK_FIXTURE_PIN)
+  unsigned long release = cycleStartMs + SOAK_FIXTURE_PULSE_MS;
+  if (fixtureHeld && (long)(release - due) < 0) due = release;
+#endif
+  return due;
+}
+
+// "soak" status; "soak start [n]", "soak stop" (ends the run and reports), "soak report"
+void soakCommand(const char* args) {
+  if (strncmp(args, "start", 5) == 0) {
+    if (phase != SOAK_IDLE) {
+      Serial.println("⚠️ Soak already running — `soak stop` first");
+      return;
+    }
+    int n = atoi(args + 5);
+    cyclesTotal = n > 0 ? (uint32_t)n : SOAK_DEFAULT_CYCLES;
+    cyclesDone = cycleTimeouts = 0;
+    activeBeforeRun = currentActiveBox();
+    stampBeforeRun = currentActiveStamp();
+    for (auto& h : stats) h.reset();
+    resetLoopProfile();
+    heapAtStart = heapSnapshot();
+    nvsWritesAtStart = nvsWriteCount();
+    runStartMs = cycleStartMs = millis();
+#if !defined(SOAK_FIXTURE_PIN)
+    takeVirtualInputs(true);
+    restInputs();
+#endif
+    phase = SOAK_REST;
+    phaseAt = runStartMs + SOAK_CYCLE_GAP_MS;
+    wakeControlTask();
+    Serial.print("🏁 Running ");
+    Serial.print(cyclesTotal);
+    Serial.println(" soak cycles");
+  } else if (strcmp(args, "stop") == 0) {
+    if (phase != SOAK_IDLE) finishRun();
+  } else if (strcmp(args, "report") == 0) {
+    printResult();
+  } else {
+    char line[96];
+    snprintf(line, sizeof(line), "🏁 Soak %s: %lu/%lu cycles, %lu timed out",
+             phase == SOAK_IDLE ? "idle" : "running", (unsigned long)cyclesDone, (unsigned long)cyclesTotal,
+             (unsigned long)cycleTimeouts);
+    Serial.println(line);
+  }
+}
+
+#endif // SOAK_TEST
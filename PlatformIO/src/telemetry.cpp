@@ -0,0 +1,415 @@
+/*
+  Useless Boxes - Telemetry
+  -------------------------
+  RAM ring of 8-byte events, delta/varint batches uploaded through the
+  `telemetry` cloud String, and an NVS spill for when the cloud is away.
+  See telemetry.h.
+  -------------------------
+*/
+#include "telemetry.h"
+
+#include <ArduinoIoTCloud.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <sys/time.h>
+#include <time.h>
+#include "log.h"
+#include "soak_test.h"
+
+namespace {
+  constexpr const char* TELEMETRY_NAMESPACE = "telemetry"; // own NVS namespace, apart from settings
+
+  // Ring: any task records, only the network task consumes
+  TelemetryEvent ring[TELEMETRY_RING_CAPACITY];
+  uint32_t ringHead = 0;         // next slot to write
+  uint32_t ringTail = 0;         // oldest event not yet batched
+  uint32_t droppedPending = 0;   // ring was full; reported by the next batch
+  uint32_t recordedTotal = 0;
+  uint32_t droppedTotal = 0;
+  portMUX_TYPE telemetryMux = portMUX_INITIALIZER_UNLOCKED;
+
+  // Network task only
+  struct SpillSlot {
+    bool used;
+    bool thisBoot;     // its millis() stamps belong to this boot, so the clock pair applies
+    uint32_t seq;
+  };
+  Preferences spillPrefs;
+  SpillSlot spillSlots[TELEMETRY_SPILL_SLOTS];
+
+  // The batch last handed to `telemetry`. It stays in the ring (or its NVS
+  // slot) until the cloud has been connected for a whole drain gap since,
+  // so a drop before ArduinoCloud.update() sent it loses nothing.
+  struct SentBatch {
+    bool pending;
+    int spillSlot;     // -1: events still at the ring's tail
+    uint32_t seq;
+    size_t taken;      // ring events and drop count it covers
+    uint32_t dropped;
+    size_t len;
+    uint8_t bytes[TELEMETRY_BATCH_MAX_BYTES];
+  } sent = {};
+  uint32_t nextSeq = 0;
+  uint32_t batchesSent = 0;
+  uint32_t batchesSpilled = 0;
+  uint32_t spillOverwrites = 0;
+  unsigned long lastUploadAt = 0;
+  unsigned long lastBatchAt = 0;
+  unsigned long connectionEdgeAt = 0;
+  bool connectedLast = false;
+  bool draining = false;         // sending the ring one batch per gap until it is empty
+  bool clockRequested = false;   // SNTP started on the first connect
+  volatile bool flushRequested = false;
+
+  bool putVarint(uint8_t* out, size_t size, size_t& len, uint32_t value) {
+    do {
+      if (len >= size) return false;
+      uint8_t byte = value & 0x7F;
+      value >>= 7;
+      out[len++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    return true;
+  }
+
+  bool getVarint(const uint8_t* in, size_t size, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < size; shift += 7) {
+      uint8_t byte = in[pos++];
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) return true;
+    }
+    return false;
+  }
+
+  void toBase64(const uint8_t* in, size_t len, char* out, size_t size) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < len && o + 4 < size; i += 3) {
+      uint32_t group = (uint32_t)in[i] << 16;
+      if (i + 1 < len) group |= (uint32_t)in[i + 1] << 8;
+      if (i + 2 < len) group |= in[i + 2];
+      out[o++] = alphabet[(group >> 18) & 0x3F];
+      out[o++] = alphabet[(group >> 12) & 0x3F];
+      out[o++] = i + 1 < len ? alphabet[(group >> 6) & 0x3F] : '=';
+      out[o++] = i + 2 < len ? alphabet[group & 0x3F] : '=';
+    }
+    out[o] = '\0';
+  }
+
+  void slotKey(uint8_t slot, char* key, size_t size) {
+    snprintf(key, size, "b%u", (unsigned)slot);
+  }
+
+  int oldestSpillSlot() {
+    int oldest = -1;
+    for (uint8_t i = 0; i < TELEMETRY_SPILL_SLOTS; i++) {
+      if (spillSlots[i].used && (oldest < 0 || spillSlots[i].seq < spillSlots[oldest].seq)) oldest = i;
+    }
+    return oldest;
+  }
+
+  uint8_t spilledCount() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < TELEMETRY_SPILL_SLOTS; i++) count += spillSlots[i].used;
+    return count;
+  }
+
+  // Copies the oldest events without removing them; commitEvents() does
+  // that once the batch is safely out (uploaded or spilled)
+  size_t peekEvents(TelemetryEvent* out, size_t max, uint32_t& dropped) {
+    portENTER_CRITICAL(&telemetryMux);
+    size_t count = ringHead - ringTail;
+    if (count > max) count = max;
+    for (size_t i = 0; i < count; i++) out[i] = ring[(ringTail + i) & (TELEMETRY_RING_CAPACITY - 1)];
+    dropped = droppedPending;
+    portEXIT_CRITICAL(&telemetryMux);
+    return count;
+  }
+
+  void commitEvents(size_t count, uint32_t dropped) {
+    portENTER_CRITICAL(&telemetryMux);
+    ringTail += count;
+    droppedPending -= dropped;
+    portEXIT_CRITICAL(&telemetryMux);
+  }
+
+  // Encodes the oldest events under nextSeq; 0 when there is nothing to say
+  size_t takeRingBatch(uint8_t* batch, size_t& taken, uint32_t& dropped) {
+    TelemetryEvent events[TELEMETRY_BATCH_MAX_EVENTS];
+    size_t count = peekEvents(events, TELEMETRY_BATCH_MAX_EVENTS, dropped);
+    taken = 0;
+    if (count == 0 && dropped == 0) return 0;
+    return encodeTelemetryBatch(batch, TELEMETRY_BATCH_MAX_BYTES, nextSeq, dropped, events, count, &taken);
+  }
+
+  // Wall-clock ms, 0 until SNTP (or the cloud's time service) has set it
+  uint64_t wallClockMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < TELEMETRY_CLOCK_VALID_AFTER) return 0;
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  }
+
+  // "t2:<seq>:<wall ms>:<millis>:" pairs the box clock with wall time when
+  // the batch's stamps are from this boot and the clock is set; else "t1:<seq>:"
+  void publishBatch(uint32_t seq, const uint8_t* batch, size_t len, bool thisBoot) {
+    char text[TELEMETRY_TEXT_MAX_LEN];
+    uint64_t wall = thisBoot ? wallClockMs() : 0;
+    int prefix = wall ? snprintf(text, sizeof(text), "t2:%lu:%llu:%lu:", (unsigned long)seq,
+                                 (unsigned long long)wall, (unsigned long)millis())
+                      : snprintf(text, sizeof(text), "t1:%lu:", (unsigned long)seq);
+    toBase64(batch, len, text + prefix, sizeof(text) - prefix);
+    telemetry = text;
+    batchesSent++;
+  }
+
+  void removeSpilled(uint8_t slot) {
+    char key[8];
+    slotKey(slot, key, sizeof(key));
+    NOTE_NVS_WRITE();
+    spillPrefs.remove(key);
+    spillSlots[slot].used = false;
+  }
+
+  // Into a free NVS slot, or over the oldest spilled batch when every slot
+  // is taken (the seq gap shows it)
+  bool storeSpill(uint32_t seq, const uint8_t* batch, size_t len) {
+    int slot = -1;
+    for (uint8_t i = 0; i < TELEMETRY_SPILL_SLOTS && slot < 0; i++) {
+      if (!spillSlots[i].used) slot = i;
+    }
+    if (slot < 0) {
+      slot = oldestSpillSlot();
+      if (spillOverwrites++ == 0) LOG_WARN("⚠️ Telemetry spill full — overwriting the oldest batch");
+    }
+    char key[8];
+    slotKey(slot, key, sizeof(key));
+    NOTE_NVS_WRITE();
+    if (spillPrefs.putBytes(key, batch, len) != len) {
+      LOG_WARN("⚠️ Telemetry spill write failed");
+      return false;
+    }
+    spillSlots[slot].used = true;
+    spillSlots[slot].thisBoot = true;
+    spillSlots[slot].seq = seq;
+    batchesSpilled++;
+    return true;
+  }
+
+  bool uploadSpilled(uint8_t slot) {
+    char key[8];
+    slotKey(slot, key, sizeof(key));
+    size_t len = spillPrefs.getBytes(key, sent.bytes, sizeof(sent.bytes));
+    if (len == 0) {
+      removeSpilled(slot);
+      return false;
+    }
+    publishBatch(spillSlots[slot].seq, sent.bytes, len, spillSlots[slot].thisBoot);
+    sent.pending = true;
+    sent.spillSlot = slot;
+    sent.len = len;
+    return true;
+  }
+
+  bool uploadRing() {
+    size_t taken;
+    uint32_t dropped;
+    size_t len = takeRingBatch(sent.bytes, taken, dropped);
+    if (len == 0) return false;
+    sent.pending = true;
+    sent.spillSlot = -1;
+    sent.seq = nextSeq++;
+    sent.taken = taken;
+    sent.dropped = dropped;
+    sent.len = len;
+    publishBatch(sent.seq, sent.bytes, len, true);
+    return true;
+  }
+
+  // Connected for the whole gap since it was published: it has gone out
+  void confirmSent() {
+    if (!sent.pending) return;
+    sent.pending = false;
+    if (sent.spillSlot < 0) commitEvents(sent.taken, sent.dropped);
+    else removeSpilled((uint8_t)sent.spillSlot);
+  }
+
+  // Dropped before it was confirmed: a spilled batch simply stays queued;
+  // a ring batch keeps its seq and moves to NVS, so the copy that may have
+  // gone out and the one sent later carry the same events under one seq
+  void requeueSent() {
+    if (!sent.pending) return;
+    sent.pending = false;
+    if (sent.spillSlot >= 0) return;
+    if (storeSpill(sent.seq, sent.bytes, sent.len)) commitEvents(sent.taken, sent.dropped);
+  }
+
+  // Offline: move the oldest batch of the ring into NVS
+  void spillRing() {
+    uint8_t batch[TELEMETRY_BATCH_MAX_BYTES];
+    size_t taken;
+    uint32_t dropped;
+    size_t len = takeRingBatch(batch, taken, dropped);
+    if (len == 0) return;
+    if (!storeSpill(nextSeq, batch, len)) return;  // events stay in the ring; retried after the drain gap
+    nextSeq++;
+    commitEvents(taken, dropped);
+  }
+}
+
+size_t encodeTelemetryBatch(uint8_t* out, size_t size, uint32_t seq, uint32_t dropped,
+                            const TelemetryEvent* events, size_t count, size_t* taken) {
+  size_t len = 0;
+  *taken = 0;
+  uint32_t previousMs = count ? events[0].atMs : 0;
+  if (!putVarint(out, size, len, seq) || !putVarint(out, size, len, previousMs) ||
+      !putVarint(out, size, len, dropped)) {
+    return 0;
+  }
+  for (size_t i = 0; i < count; i++) {
+    uint8_t event[12];
+    size_t eventLen = 0;
+    putVarint(event, sizeof(event), eventLen, events[i].atMs - previousMs);
+    event[eventLen++] = events[i].type;
+    event[eventLen++] = events[i].aux;
+    putVarint(event, sizeof(event), eventLen, events[i].value);
+    if (len + eventLen > size) break;
+    memcpy(out + len, event, eventLen);
+    len += eventLen;
+    previousMs = events[i].atMs;
+    (*taken)++;
+  }
+  return len;
+}
+
+void telemetryRecord(TelemetryType type, uint8_t aux, uint16_t value) {
+  portENTER_CRITICAL(&telemetryMux);
+  if (ringHead - ringTail >= TELEMETRY_RING_CAPACITY) {
+    droppedPending++;
+    droppedTotal++;
+  } else {
+    TelemetryEvent& event = ring[ringHead & (TELEMETRY_RING_CAPACITY - 1)];
+    event.atMs = millis();   // taken under the lock, so the ring stays in time order
+    event.value = value;
+    event.type = type;
+    event.aux = aux;
+    ringHead++;
+    recordedTotal++;
+  }
+  portEXIT_CRITICAL(&telemetryMux);
+}
+
+size_t telemetryPending() {
+  portENTER_CRITICAL(&telemetryMux);
+  size_t pending = ringHead - ringTail;
+  portEXIT_CRITICAL(&telemetryMux);
+  return pending;
+}
+
+void beginTelemetry() {
+  portENTER_CRITICAL(&telemetryMux);
+  ringHead = ringTail = 0;
+  droppedPending = recordedTotal = droppedTotal = 0;
+  portEXIT_CRITICAL(&telemetryMux);
+  telemetry.reserve(TELEMETRY_TEXT_MAX_LEN);
+
+  nextSeq = 0;
+  sent.pending = false;
+  batchesSent = batchesSpilled = spillOverwrites = 0;
+  spillPrefs.begin(TELEMETRY_NAMESPACE, false);
+  for (uint8_t i = 0; i < TELEMETRY_SPILL_SLOTS; i++) {
+    spillSlots[i].used = false;
+    spillSlots[i].thisBoot = false;
+    char key[8];
+    slotKey(i, key, sizeof(key));
+    if (!spillPrefs.isKey(key)) continue;
+    uint8_t batch[TELEMETRY_BATCH_MAX_BYTES];
+    size_t len = spillPrefs.getBytes(key, batch, sizeof(batch));
+    size_t pos = 0;
+    uint32_t seq;
+    if (len == 0 || !getVarint(batch, len, pos, seq)) {
+      NOTE_NVS_WRITE();
+      spillPrefs.remove(key);
+      continue;
+    }
+    spillSlots[i].used = true;
+    spillSlots[i].seq = seq;
+    if (seq >= nextSeq) nextSeq = seq + 1;  // keep counting past what is still queued
+  }
+  uint8_t spilled = spilledCount();
+  if (spilled) LOG_INFO("📈 Telemetry: %u spilled batches waiting for the cloud", (unsigned)spilled);
+
+  unsigned long now = millis();
+  lastUploadAt = connectionEdgeAt = now;
+  lastBatchAt = now - TELEMETRY_DRAIN_GAP_MS;
+  connectedLast = false;
+  draining = false;
+  flushRequested = false;
+}
+
+void serviceTelemetry(unsigned long now) {
+  bool connected = ArduinoCloud.connected();
+  if (connected != connectedLast) {
+    unsigned long seconds = (now - connectionEdgeAt) / 1000;
+    telemetryRecord(connected ? TELEM_CLOUD_CONNECT : TELEM_CLOUD_DISCONNECT, 0,
+                    (uint16_t)(seconds > 0xFFFF ? 0xFFFF : seconds));
+    connectionEdgeAt = now;
+    connectedLast = connected;
+    if (!connected) requeueSent();  // may not have gone out: send it again
+    if (connected && !clockRequested) {
+      clockRequested = true;
+      configTime(0, 0, TELEMETRY_NTP_SERVER);   // wall time for the batches' clock pair
+    }
+  }
+
+  if (flushRequested) {
+    flushRequested = false;
+    lastUploadAt = now - TELEMETRY_UPLOAD_INTERVAL_MS;
+  }
+  if (now - lastBatchAt < TELEMETRY_DRAIN_GAP_MS) return;  // one batch per gap, uploaded or spilled
+
+  if (!connected) {
+    if (telemetryPending() >= TELEMETRY_SPILL_THRESHOLD) {
+      lastBatchAt = now;
+      spillRing();
+    }
+    return;
+  }
+
+  if (now - lastUploadAt >= TELEMETRY_UPLOAD_INTERVAL_MS) {
+    lastUploadAt = now;
+    draining = true;
+  }
+  confirmSent();  // connected for the whole gap since it was published
+  int slot = oldestSpillSlot();
+  if (slot >= 0) {  // older than anything in the ring: goes first, without waiting for the interval
+    lastBatchAt = now;
+    uploadSpilled(slot);
+    return;
+  }
+  if (!draining) return;
+  lastBatchAt = now;
+  if (!uploadRing() || telemetryPending() == 0) draining = false;
+}
+
+// "telemetry" prints the counters; "telemetry flush" uploads the ring now
+void telemetryCommand(const char* args) {
+  if (strcmp(args, "flush") == 0) {
+    flushRequested = true;
+    Serial.println("📈 Telemetry upload requested.");
+    return;
+  }
+  portENTER_CRITICAL(&telemetryMux);
+  uint32_t recorded = recordedTotal;
+  uint32_t dropped = droppedTotal;
+  uint32_t pending = ringHead - ringTail;
+  portEXIT_CRITICAL(&telemetryMux);
+  char line[112];
+  snprintf(line, sizeof(line), "📈 Telemetry: %lu events recorded, %lu waiting, %lu dropped",
+           (unsigned long)recorded, (unsigned long)pending, (unsigned long)dropped);
+  Serial.println(line);
+  snprintf(line, sizeof(line), "  batches: %lu uploaded, %lu spilled (%u in NVS, %lu overwritten), next seq %lu",
+           (unsigned long)batchesSent, (unsigned long)batchesSpilled, (unsigned)spilledCount(),
+           (unsigned long)spillOverwrites, (unsigned long)nextSeq);
+  Serial.println(line);
+}
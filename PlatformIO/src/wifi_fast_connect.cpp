@@ -0,0 +1,249 @@
+/*
+  Useless Boxes - Wi-Fi Fast Connect
+  -------------------------
+  Connection handler that rejoins the cached AP (BSSID, channel, lease)
+  before falling back to a scan. Compiled only with -DWIFI_FAST_CONNECT.
+  See wifi_fast_connect.h.
+  -------------------------
+*/
+#include "wifi_fast_connect.h"
+
+#if defined(WIFI_FAST_CONNECT)
+#include <Arduino.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <esp_rom_crc.h>
+#include "log.h"
+#include "soak_test.h"
+#if defined(WIFI_REUSE_LEASE)
+#include <ArduinoIoTCloud.h>
+#endif
+
+namespace {
+  constexpr const char* WIFI_NAMESPACE = "wifi";   // own NVS namespace, apart from settings
+  constexpr const char* WIFI_RECORD_KEY = "ap";
+  constexpr uint8_t WIFI_RECORD_VERSION = 1;
+
+  // What a good connection looked like; IPv4 addresses as IPAddress stores them
+  struct WifiApRecord {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t crc;   // over everything above
+  };
+
+  Preferences wifiPrefs;
+  WifiApRecord record = {};
+  bool recordLoaded = false;
+  bool recordValid = false;      // false after a miss until the next good connection
+  bool attemptCached = false;
+#if defined(WIFI_REUSE_LEASE) && !defined(WIFI_STATIC_IP)
+  bool leaseTrusted = true;      // false once the stored lease failed to reach the cloud
+  bool leaseOnTrial = false;     // connected on the stored lease, cloud not reached yet
+  unsigned long connectedAt = 0;
+  uint32_t leaseDrops = 0;
+#endif
+  unsigned long attemptStartedAt = 0;
+  unsigned long lastConnectMs = 0;
+  unsigned long bootToOnlineMs = 0;
+  uint32_t cachedConnects = 0;
+  uint32_t scanConnects = 0;
+  uint32_t cacheMisses = 0;
+
+  uint32_t recordCrc(const WifiApRecord& r) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&r, offsetof(WifiApRecord, crc));
+  }
+
+  void loadRecord() {
+    recordLoaded = true;
+    wifiPrefs.begin(WIFI_NAMESPACE, false);
+    recordValid = wifiPrefs.isKey(WIFI_RECORD_KEY) &&
+                  wifiPrefs.getBytes(WIFI_RECORD_KEY, &record, sizeof(record)) == sizeof(record) &&
+                  record.version == WIFI_RECORD_VERSION && record.crc == recordCrc(record) &&
+                  record.channel >= 1 && record.channel <= 14;
+  }
+
+  // Only written when the AP or lease changed, so a steady box never touches flash
+  void saveRecord() {
+    WifiApRecord fresh = {};
+    fresh.version = WIFI_RECORD_VERSION;
+    fresh.channel = (uint8_t)WiFi.channel();
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid) memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+    fresh.ip = (uint32_t)WiFi.localIP();
+    fresh.gateway = (uint32_t)WiFi.gatewayIP();
+    fresh.subnet = (uint32_t)WiFi.subnetMask();
+    fresh.dns = (uint32_t)WiFi.dnsIP(0);
+    fresh.crc = recordCrc(fresh);
+    bool same = recordValid && memcmp(&fresh, &record, sizeof(record)) == 0;
+    record = fresh;
+    recordValid = bssid && fresh.ip != 0;
+    if (same || !recordValid) return;
+    NOTE_NVS_WRITE();
+    if (wifiPrefs.putBytes(WIFI_RECORD_KEY, &record, sizeof(record)) != sizeof(record)) {
+      LOG_WARN("⚠️ Wi-Fi record write failed");
+    }
+  }
+
+  void applyAddressing(bool cached) {
+#if defined(WIFI_STATIC_IP)
+    (void)cached;
+    IPAddress ip, gateway, subnet, dns;
+    ip.fromString(WIFI_STATIC_IP);
+    gateway.fromString(WIFI_GATEWAY);
+    subnet.fromString(WIFI_SUBNET);
+#if defined(WIFI_DNS)
+    dns.fromString(WIFI_DNS);
+#else
+    dns = gateway;
+#endif
+    WiFi.config(ip, gateway, subnet, dns);
+#elif defined(WIFI_REUSE_LEASE)
+    if (cached && leaseTrusted) {
+      WiFi.config(IPAddress(record.ip), IPAddress(record.gateway), IPAddress(record.subnet), IPAddress(record.dns));
+    } else {
+      WiFi.config(IPAddress(), IPAddress(), IPAddress());  // all zero: DHCP
+    }
+#else
+    (void)cached;
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());    // DHCP, on the cached AP or after a scan
+#endif
+  }
+
+  // True when this attempt joins on the stored lease rather than DHCP
+  bool attemptReusesLease() {
+#if defined(WIFI_REUSE_LEASE) && !defined(WIFI_STATIC_IP)
+    return attemptCached && leaseTrusted;
+#else
+    return false;
+#endif
+  }
+
+  void beginAttempt(const char* ssid, const char* pass) {
+    if (!recordLoaded) loadRecord();
+    attemptCached = recordValid;
+    attemptStartedAt = millis();
+    WiFi.persistent(false);   // the SDK would rewrite its own flash copy on every begin
+    WiFi.mode(WIFI_STA);
+    applyAddressing(attemptCached);
+    if (attemptCached) {
+      WiFi.begin(ssid, pass, record.channel, record.bssid);
+      LOG_INFO("📶 Wi-Fi: joining cached AP on channel %u", (unsigned)record.channel);
+    } else {
+      WiFi.begin(ssid, pass);
+      LOG_INFO("📶 Wi-Fi: scanning for the AP");
+    }
+  }
+
+  void formatMac(char* out, size_t size, const uint8_t* mac) {
+    snprintf(out, size, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  }
+}
+
+FastWiFiConnectionHandler::FastWiFiConnectionHandler(const char* ssid, const char* pass)
+    : WiFiConnectionHandler(ssid, pass, true), ssid(ssid), pass(pass) {}
+
+// Replaces the library's init (disconnect, begin, fixed delays) with a
+// non-blocking begin; reconnects come back through here too
+NetworkConnectionState FastWiFiConnectionHandler::update_handleInit() {
+  beginAttempt(ssid, pass);
+  return NetworkConnectionState::CONNECTING;
+}
+
+NetworkConnectionState FastWiFiConnectionHandler::update_handleConnecting() {
+  if (WiFi.status() != WL_CONNECTED) {
+    if (attemptCached && millis() - attemptStartedAt >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+      cacheMisses++;
+      recordValid = false;   // kept in NVS; the scan's result replaces it
+      LOG_WARN("⚠️ Wi-Fi: cached AP didn't answer in %lu ms — full scan",
+               (unsigned long)WIFI_FAST_CONNECT_TIMEOUT_MS);
+      beginAttempt(ssid, pass);
+    }
+    return NetworkConnectionState::CONNECTING;
+  }
+  NetworkConnectionState state = WiFiConnectionHandler::update_handleConnecting();
+  if (state == NetworkConnectionState::CONNECTED) {
+    lastConnectMs = millis() - attemptStartedAt;
+    if (bootToOnlineMs == 0) bootToOnlineMs = millis();
+    if (attemptCached) cachedConnects++;
+    else scanConnects++;
+    LOG_INFO("📶 Wi-Fi up in %lu ms (%s)", lastConnectMs,
+             attemptReusesLease() ? "cached AP and lease" : attemptCached ? "cached AP" : "full scan");
+#if defined(WIFI_REUSE_LEASE) && !defined(WIFI_STATIC_IP)
+    leaseOnTrial = attemptReusesLease();
+    connectedAt = millis();
+    if (!leaseOnTrial) leaseTrusted = true;   // DHCP just handed out the lease being saved
+#endif
+    saveRecord();
+  }
+  return state;
+}
+
+#if defined(WIFI_REUSE_LEASE)
+// A join on a stale lease associates fine but never reaches anything:
+// give it WIFI_LEASE_TRIAL_MS to reach the cloud, then reconnect with DHCP
+NetworkConnectionState FastWiFiConnectionHandler::update_handleConnected() {
+#if !defined(WIFI_STATIC_IP)
+  if (leaseOnTrial) {
+    if (ArduinoCloud.connected()) {
+      leaseOnTrial = false;
+    } else if (millis() - connectedAt >= WIFI_LEASE_TRIAL_MS) {
+      leaseOnTrial = false;
+      leaseTrusted = false;
+      leaseDrops++;
+      LOG_WARN("⚠️ Wi-Fi: cloud not reached on the stored lease in %lu ms — reconnecting with DHCP",
+               (unsigned long)WIFI_LEASE_TRIAL_MS);
+      WiFi.disconnect();
+      return NetworkConnectionState::DISCONNECTED;
+    }
+  }
+#endif
+  return WiFiConnectionHandler::update_handleConnected();
+}
+#endif
+
+// "wifi" prints the cached AP and connect times; "wifi forget" drops the record
+void wifiCommand(const char* args) {
+  if (!recordLoaded) loadRecord();
+  if (strcmp(args, "forget") == 0) {
+    NOTE_NVS_WRITE();
+    wifiPrefs.remove(WIFI_RECORD_KEY);
+    recordValid = false;
+    Serial.println("📶 Wi-Fi record cleared; the next connect scans.");
+    return;
+  }
+  char line[112];
+  char mac[18];
+  if (recordValid) {
+    formatMac(mac, sizeof(mac), record.bssid);
+    snprintf(line, sizeof(line), "📶 Wi-Fi record: %s on channel %u, lease %s", mac, (unsigned)record.channel,
+             IPAddress(record.ip).toString().c_str());
+  } else {
+    snprintf(line, sizeof(line), "📶 Wi-Fi record: none (next connect scans)");
+  }
+  Serial.println(line);
+  snprintf(line, sizeof(line), "  %s, last connect %lu ms, boot to online %lu ms",
+           WiFi.status() == WL_CONNECTED ? "connected" : "not connected", lastConnectMs, bootToOnlineMs);
+  Serial.println(line);
+  snprintf(line, sizeof(line), "  connects: %lu cached, %lu scanned, %lu cache misses%s",
+           (unsigned long)cachedConnects, (unsigned long)scanConnects, (unsigned long)cacheMisses,
+#if defined(WIFI_STATIC_IP)
+           "; static IP " WIFI_STATIC_IP
+#elif defined(WIFI_REUSE_LEASE)
+           "; lease reused"
+#else
+           "; DHCP"
+#endif
+          );
+  Serial.println(line);
+#if defined(WIFI_REUSE_LEASE) && !defined(WIFI_STATIC_IP)
+  snprintf(line, sizeof(line), "  stored lease %s, %lu dropped for not reaching the cloud",
+           leaseTrusted ? "trusted" : "dropped until the next DHCP join", (unsigned long)leaseDrops);
+  Serial.println(line);
+#endif
+}
+#endif
@@ -0,0 +1,155 @@
+/*
+  Useless Boxes - Buzzer pattern engine tests (env:native)
+  -------------------------
+  Plays the table-driven patterns against the captured buzzer output and
+  checks step timing, looping, pre-emption by queued beeps, custom
+  patterns pushed over the cloud or the "buzz" serial command, and the
+  LEDC backend's volume and write economy.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+
+namespace {
+  // Frequency sounding `ms` from now, without disturbing the pattern
+  unsigned toneAfter(unsigned long ms) {
+    sim::runFor(ms);
+    return fake::soundFrequency(BUZZER_PIN);
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  sim::runFor(3000); // let boot beeps and patterns finish
+  stopBuzzer();
+  fake::serialOutput().clear();
+}
+
+void tearDown() {}
+
+void test_chirp_steps_follow_table() {
+  triggerBuzzerPattern(BUZZER_CHIRP);
+  TEST_ASSERT_EQUAL_UINT(800, fake::soundFrequency(BUZZER_PIN));
+  TEST_ASSERT_EQUAL_UINT(800, toneAfter(100));
+  TEST_ASSERT_EQUAL_UINT(0, toneAfter(40));      // 140 ms: inside the 50 ms gap
+  TEST_ASSERT_EQUAL_UINT(1200, toneAfter(60));   // 200 ms: second step
+  TEST_ASSERT_EQUAL_UINT(800, toneAfter(170));   // 370 ms: third step
+  TEST_ASSERT_EQUAL_UINT(0, toneAfter(200));
+  TEST_ASSERT_EQUAL_INT(BUZZER_OFF, currentBuzzerPattern);
+}
+
+void test_sos_plays_nine_tones() {
+  uint32_t before = fake::soundStarts(BUZZER_PIN);
+  triggerBuzzerPattern(BUZZER_SOS);
+  sim::runFor(6000);
+  TEST_ASSERT_EQUAL_UINT32(before + 9, fake::soundStarts(BUZZER_PIN));
+  TEST_ASSERT_EQUAL_INT(BUZZER_OFF, currentBuzzerPattern);
+}
+
+void test_loop_repeats_until_stopped() {
+  triggerBuzzerPattern(BUZZER_LOOP);
+  uint32_t before = fake::soundStarts(BUZZER_PIN);
+  sim::runFor(BUZZER_INTERVAL * 2 * 10);
+  TEST_ASSERT_GREATER_OR_EQUAL(before + 9, fake::soundStarts(BUZZER_PIN));
+  TEST_ASSERT_EQUAL_INT(BUZZER_LOOP, currentBuzzerPattern);
+  stopBuzzer();
+  TEST_ASSERT_EQUAL_UINT(0, fake::soundFrequency(BUZZER_PIN));
+}
+
+void test_queued_beep_preempts_and_pattern_resumes() {
+  triggerBuzzerPattern(BUZZER_LOOP);
+  beepBuzzer(1, 100, 0, 2000);
+  TEST_ASSERT_EQUAL_UINT(2000, toneAfter(10));
+  TEST_ASSERT_EQUAL_UINT(1000, toneAfter(150));
+  stopBuzzer();
+}
+
+void test_cloud_custom_pattern_plays() {
+  fake::cloudWrite(buzzer_pattern, "500:100:100,700:100:0");
+  sim::runFor(20);
+  triggerBuzzerPattern(BUZZER_CUSTOM);
+  TEST_ASSERT_EQUAL_UINT(500, fake::soundFrequency(BUZZER_PIN));
+  TEST_ASSERT_EQUAL_UINT(700, toneAfter(250));
+  TEST_ASSERT_EQUAL_UINT(0, toneAfter(100));
+  TEST_ASSERT_EQUAL_INT(BUZZER_OFF, currentBuzzerPattern);
+}
+
+void test_malformed_custom_pattern_is_rejected() {
+  TEST_ASSERT_TRUE(setCustomBuzzerPattern("loop 900:50:50"));
+  TEST_ASSERT_FALSE(setCustomBuzzerPattern("900:50"));
+  TEST_ASSERT_FALSE(setCustomBuzzerPattern("900:0:0"));
+  TEST_ASSERT_FALSE(setCustomBuzzerPattern("abc"));
+  sim::runFor(10);
+  triggerBuzzerPattern(BUZZER_CUSTOM);
+  TEST_ASSERT_EQUAL_UINT(900, fake::soundFrequency(BUZZER_PIN));
+  sim::runFor(1000);
+  TEST_ASSERT_EQUAL_INT(BUZZER_CUSTOM, currentBuzzerPattern); // still looping
+  stopBuzzer();
+}
+
+void test_serial_buzz_command() {
+  fake::serialInput("buzz 440:60:40,880:60:0\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("Custom pattern: 440:60:40,880:60:0"));
+  TEST_ASSERT_EQUAL_INT(BUZZER_CUSTOM, currentBuzzerPattern);
+  TEST_ASSERT_EQUAL_UINT(880, toneAfter(100));
+}
+
+void test_empty_custom_pattern_is_silent() {
+  TEST_ASSERT_TRUE(setCustomBuzzerPattern(""));
+  sim::runFor(10);
+  uint32_t before = fake::soundStarts(BUZZER_PIN);
+  triggerBuzzerPattern(BUZZER_CUSTOM);
+  sim::runFor(500);
+  TEST_ASSERT_EQUAL_UINT32(before, fake::soundStarts(BUZZER_PIN));
+  TEST_ASSERT_EQUAL_INT(BUZZER_OFF, currentBuzzerPattern);
+}
+
+#if !defined(BUZZER_TONE_API)
+void test_idle_buzzer_leaves_ledc_alone() {
+  uint32_t writes = fake::ledcWrites(BUZZER_LEDC_CHANNEL);
+  sim::runFor(10000);
+  TEST_ASSERT_EQUAL_UINT32(writes, fake::ledcWrites(BUZZER_LEDC_CHANNEL));
+  TEST_ASSERT_EQUAL_INT(BUZZER_LEDC_CHANNEL, fake::ledcPinChannel(BUZZER_PIN));
+}
+
+void test_steps_only_write_on_change() {
+  uint32_t writes = fake::ledcWrites(BUZZER_LEDC_CHANNEL);
+  triggerBuzzerPattern(BUZZER_CHIRP);
+  sim::runFor(1000);
+  // 800, 1200, 800 Hz with gaps: at most a retune + duty write per edge
+  TEST_ASSERT_LESS_OR_EQUAL(writes + 9, fake::ledcWrites(BUZZER_LEDC_CHANNEL));
+}
+
+void test_volume_sets_duty() {
+  setBuzzerVolume(100);
+  triggerBuzzerPattern(BUZZER_LOOP);
+  TEST_ASSERT_EQUAL_UINT32(BUZZER_MAX_DUTY, fake::ledcDuty(BUZZER_LEDC_CHANNEL));
+  setBuzzerVolume(50);  // applies to the tone already sounding
+  TEST_ASSERT_EQUAL_UINT32(buzzerDutyForVolume(50), fake::ledcDuty(BUZZER_LEDC_CHANNEL));
+  TEST_ASSERT_LESS_THAN(BUZZER_MAX_DUTY, buzzerDutyForVolume(50));
+  setBuzzerVolume(0);
+  TEST_ASSERT_EQUAL_UINT(0, fake::soundFrequency(BUZZER_PIN));
+  stopBuzzer();
+  setBuzzerVolume(DEFAULT_BUZZER_VOLUME);
+}
+#endif
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_chirp_steps_follow_table);
+  RUN_TEST(test_sos_plays_nine_tones);
+  RUN_TEST(test_loop_repeats_until_stopped);
+  RUN_TEST(test_queued_beep_preempts_and_pattern_resumes);
+  RUN_TEST(test_cloud_custom_pattern_plays);
+  RUN_TEST(test_malformed_custom_pattern_is_rejected);
+  RUN_TEST(test_serial_buzz_command);
+  RUN_TEST(test_empty_custom_pattern_is_silent);
+#if !defined(BUZZER_TONE_API)
+  RUN_TEST(test_idle_buzzer_leaves_ledc_alone);
+  RUN_TEST(test_steps_only_write_on_change);
+  RUN_TEST(test_volume_sets_duty);
+#endif
+  return UNITY_END();
+}
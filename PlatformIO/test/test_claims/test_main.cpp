@@ -0,0 +1,196 @@
+/*
+  Useless Boxes - Lamport-stamped claim tests (env:native)
+  -------------------------
+  `active_stamp` carries "<active>@<lamport>:<origin>" next to the bare
+  `active_box`. A box applies a claim only when its stamp is newer than the
+  one it holds, answers an older cloud value for its own claim, keeps its
+  clock across reboots, and never lets a replayed bare name win.
+  Checked on the text helpers and through the firmware.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+
+namespace {
+  void flipSwitch(int level) {
+    fake::setInput(SWITCH_PIN, level);
+    sim::runFor(SWITCH_DEBOUNCE_TIME + 2 * NETWORK_TASK_INTERVAL_MS); // settle, then one network pass
+  }
+
+  // What a peer on this firmware writes: the stamp, then its bare copy
+  void claimFromCloud(const char* text) {
+    BoxName active, origin;
+    uint32_t lamport;
+    parseClaimText(text, active, lamport, origin);
+    fake::cloudWrite(active_stamp, text);
+    fake::cloudWrite(active_box, active.c_str());
+    sim::runFor(20);
+  }
+
+  // Dashboard edit or a box on older firmware
+  void bareFromCloud(const char* name) {
+    fake::cloudWrite(active_box, name);
+    sim::runFor(20);
+  }
+
+  // At rest past boot's publish window, with TREVOR's release the newest claim
+  void settleReleased() {
+    sim::settleAtRest();
+    sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS);
+    claimFromCloud("NONE@10:TREVOR");         // TREVOR released: newer than anything seen at boot
+    sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS + 100);
+    fake::serialOutput().clear();
+  }
+
+  uint32_t cloudLamport() {
+    BoxName active, origin;
+    uint32_t lamport;
+    parseClaimText(active_stamp.c_str(), active, lamport, origin);
+    return lamport;
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  active_stamp = "";                        // the cloud would replay the last test's claim
+  active_box = "";
+  sim::boot();
+  settleReleased();
+}
+
+void tearDown() {}
+
+void test_newer_compares_clock_then_origin_name() {
+  BoxId michael = registerBoxName("MICHAEL");
+  BoxId trevor = registerBoxName("TREVOR");
+  TEST_ASSERT_TRUE(claimNewer({ 5, michael }, { 4, trevor }));
+  TEST_ASSERT_FALSE(claimNewer({ 4, trevor }, { 5, michael }));
+  TEST_ASSERT_TRUE(claimNewer({ 5, trevor }, { 5, michael }));
+  TEST_ASSERT_FALSE(claimNewer({ 5, michael }, { 5, trevor }));
+  TEST_ASSERT_FALSE(claimNewer({ 5, michael }, { 5, michael }));
+}
+
+void test_text_round_trip_and_bare_names() {
+  char text[CLAIM_TEXT_MAX_LEN];
+  formatClaimText(text, sizeof(text), "NONE", 43, "MICHAEL");
+  TEST_ASSERT_EQUAL_STRING("NONE@43:MICHAEL", text);
+
+  BoxName active, origin;
+  uint32_t lamport;
+  TEST_ASSERT_TRUE(parseClaimText(text, active, lamport, origin));
+  TEST_ASSERT_EQUAL_STRING("NONE", active.c_str());
+  TEST_ASSERT_EQUAL_UINT32(43, lamport);
+  TEST_ASSERT_EQUAL_STRING("MICHAEL", origin.c_str());
+
+  TEST_ASSERT_FALSE(parseClaimText("TREVOR", active, lamport, origin));
+  TEST_ASSERT_EQUAL_STRING("TREVOR", active.c_str());
+  TEST_ASSERT_EQUAL_UINT32(0, lamport);
+  TEST_ASSERT_FALSE(parseClaimText("TREVOR@x:MICHAEL", active, lamport, origin));
+  TEST_ASSERT_FALSE(parseClaimText("TREVOR@0:MICHAEL", active, lamport, origin));
+}
+
+void test_local_claim_is_stamped_past_the_seen_clock() {
+  flipSwitch(HIGH);
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, active_box.c_str());   // bare, for older firmware
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME "@11:" BOX_NAME, active_stamp.c_str());
+  TEST_ASSERT_EQUAL_UINT32(11, cloudLamport());
+  TEST_ASSERT_EQUAL_INT(thisBoxId(), currentActiveStamp().origin);
+  TEST_ASSERT_EQUAL_UINT32(cloudLamport(), currentActiveStamp().lamport);
+}
+
+void test_older_cloud_claim_is_ignored_and_answered() {
+  flipSwitch(HIGH);
+  uint32_t ours = cloudLamport();
+  claimFromCloud("TREVOR@5:TREVOR");
+  TEST_ASSERT_EQUAL_INT(thisBoxId(), currentActiveBox());
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS + 2 * NETWORK_TASK_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+  TEST_ASSERT_EQUAL_UINT32(ours, cloudLamport());
+}
+
+void test_newer_claim_is_applied_and_moves_the_clock() {
+  claimFromCloud("NONE@100:TREVOR");
+  TEST_ASSERT_EQUAL_UINT32(100, currentActiveStamp().lamport);
+  flipSwitch(HIGH);
+  TEST_ASSERT_EQUAL_UINT32(101, cloudLamport());
+  fake::serialInput("peers\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("held claim " BOX_NAME "@101:" BOX_NAME));
+  TEST_ASSERT_TRUE(sim::outputContains("claim clock 101;"));
+}
+
+void test_equal_clocks_tie_break_by_origin_name() {
+  claimFromCloud("TREVOR@50:TREVOR");
+  TEST_ASSERT_EQUAL_INT(findBoxId("TREVOR"), currentActiveBox());
+  claimFromCloud("ALICE@50:ALICE");          // sorts before TREVOR: loses
+  TEST_ASSERT_EQUAL_INT(findBoxId("TREVOR"), currentActiveBox());
+  claimFromCloud("ZOE@50:ZOE");              // sorts after TREVOR: wins
+  TEST_ASSERT_EQUAL_INT(findBoxId("ZOE"), currentActiveBox());
+}
+
+void test_offline_flip_survives_reconnect_sync() {
+  fake::setCloudConnected(false);
+  flipSwitch(HIGH);
+  TEST_ASSERT_EQUAL_INT(thisBoxId(), currentActiveBox());
+  fake::setCloudConnected(true);
+  claimFromCloud("NONE@10:TREVOR");         // the sync replays what the cloud held
+  TEST_ASSERT_EQUAL_INT(thisBoxId(), currentActiveBox());
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS + 2 * NETWORK_TASK_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+}
+
+void test_clock_survives_reboot() {
+  claimFromCloud("NONE@900:TREVOR");
+  active_stamp = "";                        // offline boot: only NVS remembers the clock
+  active_box = "";
+  sim::boot();
+  settleReleased();
+  flipSwitch(HIGH);
+  TEST_ASSERT_TRUE(cloudLamport() > 900);
+}
+
+void test_older_claim_of_another_box_is_not_answered() {
+  claimFromCloud("TREVOR@50:TREVOR");
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS + 100);
+  fake::cloudWrite(active_stamp, "ALICE@20:ALICE");   // a late copy: TREVOR's to answer, not ours
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS + 2 * NETWORK_TASK_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_INT(findBoxId("TREVOR"), currentActiveBox());
+  TEST_ASSERT_EQUAL_STRING("ALICE@20:ALICE", active_stamp.c_str());
+}
+
+void test_new_bare_name_is_a_fresh_claim() {
+  claimFromCloud("TREVOR@50:TREVOR");
+  bareFromCloud("ALICE");                   // dashboard edit
+  TEST_ASSERT_EQUAL_INT(findBoxId("ALICE"), currentActiveBox());
+  TEST_ASSERT_TRUE(currentActiveStamp().lamport > 50);
+}
+
+void test_replayed_bare_name_never_wins() {
+  bareFromCloud("ALICE");
+  TEST_ASSERT_EQUAL_INT(findBoxId("ALICE"), currentActiveBox());
+  flipSwitch(HIGH);
+  TEST_ASSERT_EQUAL_INT(thisBoxId(), currentActiveBox());
+  bareFromCloud("ALICE");                   // the same value delivered again (sync replay)
+  TEST_ASSERT_EQUAL_INT(thisBoxId(), currentActiveBox());
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS + 2 * NETWORK_TASK_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, active_box.c_str());   // ours written back
+  bareFromCloud("ALICE");
+  bareFromCloud("ALICE");
+  TEST_ASSERT_EQUAL_INT(thisBoxId(), currentActiveBox());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_newer_compares_clock_then_origin_name);
+  RUN_TEST(test_text_round_trip_and_bare_names);
+  RUN_TEST(test_local_claim_is_stamped_past_the_seen_clock);
+  RUN_TEST(test_older_cloud_claim_is_ignored_and_answered);
+  RUN_TEST(test_newer_claim_is_applied_and_moves_the_clock);
+  RUN_TEST(test_equal_clocks_tie_break_by_origin_name);
+  RUN_TEST(test_offline_flip_survives_reconnect_sync);
+  RUN_TEST(test_clock_survives_reboot);
+  RUN_TEST(test_older_claim_of_another_box_is_not_answered);
+  RUN_TEST(test_new_bare_name_is_a_fresh_claim);
+  RUN_TEST(test_replayed_bare_name_never_wins);
+  return UNITY_END();
+}
@@ -0,0 +1,152 @@
+/*
+  Useless Boxes - Control logic tests (env:native)
+  -------------------------
+  Drives the firmware through the fake HAL: button presses walk the menu,
+  switch/limit edges and cloud claims steer the motor, and the buzzer and
+  RGB outputs are checked on the captured buzzer and analogWrite() output.
+  Firmware globals outlive sim::boot(), so no test assumes a menu position.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+
+namespace {
+  // Arm retracted: switch OFF, limit pressed (NC contact open)
+  void claimFromCloud(const char* box) {
+    fake::cloudWrite(active_box, box);
+    sim::runFor(20);
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  sim::settleAtRest();
+  claimFromCloud("NONE");
+  fake::serialOutput().clear();
+}
+
+void tearDown() {}
+
+void test_boot_leaves_motor_stopped() {
+  TEST_ASSERT_EQUAL_INT(0, sim::motorDrive());
+  TEST_ASSERT_EQUAL_INT(MOTOR_LEDC_CHANNEL, fake::ledcPinChannel(EN1));
+}
+
+void test_short_press_advances_menu() {
+  sim::press(BUTTON_PIN, 120);
+  sim::runFor(100);
+  TEST_ASSERT_TRUE(sim::outputContains("> Setting "));
+  TEST_ASSERT_FALSE(sim::outputContains("Editing"));
+}
+
+void test_long_press_enters_and_confirms_submenu() {
+  sim::press(BUTTON_PIN, DEFAULT_LONG_PRESS_TIME + 200);
+  sim::runFor(100);
+  TEST_ASSERT_TRUE(sim::outputContains("⚙️ Editing"));
+
+  sim::press(BUTTON_PIN, DEFAULT_LONG_PRESS_TIME + 200);
+  sim::runFor(100);
+  TEST_ASSERT_TRUE(sim::outputContains("✅ Saved and returned to main menu."));
+}
+
+void test_button_bounce_is_ignored() {
+  for (int i = 0; i < 5; i++) {
+    fake::setInput(BUTTON_PIN, LOW);
+    sim::runFor(5);
+    fake::setInput(BUTTON_PIN, HIGH);
+    sim::runFor(5);
+  }
+  sim::runFor(200);
+  TEST_ASSERT_FALSE(sim::outputContains("> Setting "));
+}
+
+void test_local_switch_claims_without_moving() {
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(50);
+  TEST_ASSERT_TRUE(sim::outputContains("claiming this box as Active"));
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+  TEST_ASSERT_EQUAL_INT(0, sim::motorDrive());
+}
+
+void test_full_stroke_when_other_box_claims() {
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(50);
+  claimFromCloud("TREVOR");
+  TEST_ASSERT_EQUAL_INT(1, sim::motorDrive());
+  sim::runFor(motionProfile.accelMs);
+  TEST_ASSERT_EQUAL_UINT32(MOTOR_PWM_MAX_DUTY, (uint32_t)fake::pwmDuty(EN1));
+
+  // Arm leaves the limit, then knocks the switch off
+  fake::setInput(LIMIT_PIN, LOW);
+  sim::runFor(20);
+  TEST_ASSERT_EQUAL_INT(1, sim::motorDrive());
+  fake::setInput(SWITCH_PIN, LOW);
+  // The ISR has already cut EN1, before any loop pass
+  TEST_ASSERT_EQUAL_INT(-1, fake::ledcPinChannel(EN1));
+  TEST_ASSERT_EQUAL_INT(LOW, fake::pinLevel(EN1));
+
+  // Brake (IN1 = IN2 = LOW, EN1 on) before the return stroke
+  sim::runFor(motionProfile.brakeMs / 2);
+  TEST_ASSERT_TRUE(sim::outputContains("Switch ISR cut EN1"));
+  TEST_ASSERT_EQUAL_INT(LOW, fake::pinLevel(IN1));
+  TEST_ASSERT_EQUAL_INT(LOW, fake::pinLevel(IN2));
+  TEST_ASSERT_EQUAL_UINT32(MOTOR_PWM_MAX_DUTY, (uint32_t)fake::pwmDuty(EN1));
+  sim::runFor(motionProfile.brakeMs);
+  TEST_ASSERT_EQUAL_INT(-1, sim::motorDrive());
+
+  // Back on the limit: the ISR stops the return stroke
+  fake::setInput(LIMIT_PIN, HIGH);
+  TEST_ASSERT_EQUAL_INT(0, sim::motorDrive());
+  sim::runFor(20);
+  TEST_ASSERT_EQUAL_INT(0, sim::motorDrive());
+}
+
+void test_motor_speed_scales_duty() {
+  setMotorSpeed(50);
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(50);
+  uint16_t approachMs = motionProfile.approachMs;
+  motionProfile.approachMs = 0; // cruise only; the approach window has its own suite
+  claimFromCloud("TREVOR");
+  sim::runFor(motionProfile.accelMs);
+  TEST_ASSERT_EQUAL_UINT32(motorDutyForSpeed(50), (uint32_t)fake::pwmDuty(EN1));
+  motionProfile.approachMs = approachMs;
+  setMotorSpeed(100);
+}
+
+void test_switch_on_plays_active_pattern() {
+  uint32_t before = fake::soundStarts(BUZZER_PIN);
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(2000);
+  TEST_ASSERT_TRUE(fake::soundStarts(BUZZER_PIN) > before);
+  TEST_ASSERT_EQUAL_UINT(0, fake::soundFrequency(BUZZER_PIN));
+}
+
+void test_rgb_follows_inactive_setting() {
+  setInactiveRGBSetting(RGB_SOLID_GREEN);
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(50);
+  claimFromCloud("TREVOR");
+  fake::setInput(LIMIT_PIN, LOW);
+  fake::setInput(SWITCH_PIN, LOW);
+  sim::runFor(50);
+  // Common anode: 0 is full on, 255 off
+  TEST_ASSERT_EQUAL_INT(255, fake::analogValue(RGB_R));
+  TEST_ASSERT_EQUAL_INT(0, fake::analogValue(RGB_G));
+  TEST_ASSERT_EQUAL_INT(255, fake::analogValue(RGB_B));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_leaves_motor_stopped);
+  RUN_TEST(test_short_press_advances_menu);
+  RUN_TEST(test_long_press_enters_and_confirms_submenu);
+  RUN_TEST(test_button_bounce_is_ignored);
+  RUN_TEST(test_local_switch_claims_without_moving);
+  RUN_TEST(test_full_stroke_when_other_box_claims);
+  RUN_TEST(test_motor_speed_scales_duty);
+  RUN_TEST(test_switch_on_plays_active_pattern);
+  RUN_TEST(test_rgb_follows_inactive_setting);
+  return UNITY_END();
+}
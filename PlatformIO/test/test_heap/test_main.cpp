@@ -0,0 +1,111 @@
+/*
+  Useless Boxes - Heap monitor and fixed box name tests (env:native)
+  -------------------------
+  The fake heap is scripted with fake::setHeap(); these tests check the
+  boot baseline, fragmentation maths, the once-per-dip low block warning,
+  the periodic summary and the `heap` command, plus the BoxName type that
+  keeps box names off the heap.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+#include "heap_monitor.h"
+
+namespace {
+  size_t occurrences(const char* text) {
+    logFlush();
+    const std::string& out = fake::serialOutput();
+    size_t count = 0;
+    for (size_t at = out.find(text); at != std::string::npos; at = out.find(text, at + 1)) count++;
+    return count;
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  fake::setInput(SWITCH_PIN, LOW);
+  fake::setInput(LIMIT_PIN, HIGH);
+  sim::boot();
+}
+
+void tearDown() {}
+
+void test_boot_records_baseline() {
+  TEST_ASSERT_TRUE(sim::outputContains("Heap after boot: 262144 free, largest block 114688"));
+}
+
+void test_fragmentation_from_largest_block() {
+  fake::setHeap(200000, 50000);
+  HeapSnapshot snap = heapSnapshot();
+  TEST_ASSERT_EQUAL_UINT32(200000, snap.freeBytes);
+  TEST_ASSERT_EQUAL_UINT32(200000, snap.minFreeBytes);
+  TEST_ASSERT_EQUAL_INT(75, snap.fragmentationPct);
+  fake::setHeap(220000, 220000);
+  snap = heapSnapshot();
+  TEST_ASSERT_EQUAL_INT(0, snap.fragmentationPct);
+  TEST_ASSERT_EQUAL_UINT32(200000, snap.minFreeBytes);  // low-water mark stays
+}
+
+void test_low_block_warned_once_per_dip() {
+  fake::serialOutput().clear();
+  fake::setHeap(100000, HEAP_LOW_BLOCK_WARN_BYTES - 1);
+  sim::runFor(3 * HEAP_SAMPLE_INTERVAL_MS);
+  TEST_ASSERT_EQUAL_UINT(1, occurrences("Heap: largest free block"));
+  fake::setHeap(100000, 60000);
+  sim::runFor(HEAP_SAMPLE_INTERVAL_MS + 10);
+  fake::setHeap(100000, 8000);
+  sim::runFor(HEAP_SAMPLE_INTERVAL_MS + 10);
+  TEST_ASSERT_EQUAL_UINT(2, occurrences("Heap: largest free block"));
+  TEST_ASSERT_TRUE(sim::outputContains("largest free block 8000 bytes (92% fragmented)"));
+}
+
+void test_periodic_summary() {
+  fake::serialOutput().clear();
+  fake::setHeap(250000, 100000);
+  sim::runFor(HEAP_REPORT_INTERVAL_MS + 10);
+  TEST_ASSERT_EQUAL_UINT(1, occurrences("Heap: 250000 free, 250000 low-water, largest block 100000 (60% fragmented)"));
+}
+
+void test_heap_command() {
+  fake::setHeap(258000, 90000);
+  fake::serialOutput().clear();
+  fake::serialInput("heap\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("free 258000 bytes (boot 262144, -4144)"));
+  TEST_ASSERT_TRUE(sim::outputContains("low-water 258000 bytes"));
+  TEST_ASSERT_TRUE(sim::outputContains("largest block 90000 bytes, 66% fragmented (worst 90000 bytes, 66%)"));
+}
+
+void test_box_name_is_fixed_capacity() {
+  BoxName name;
+  name.set("A_VERY_LONG_BOX_NAME_INDEED");
+  TEST_ASSERT_EQUAL_UINT(BOX_NAME_MAX_LEN - 1, strlen(name.c_str()));
+  TEST_ASSERT_TRUE(name.equals("A_VERY_LONG_BOX_NAME_INDEED"));  // same prefix findBoxId() uses
+  TEST_ASSERT_FALSE(name.equals("A_VERY_LONG"));
+  TEST_ASSERT_FALSE(name.equals(nullptr));
+  name.set(nullptr);
+  TEST_ASSERT_EQUAL_STRING("", name.c_str());
+
+  memset(name.text, 'x', sizeof(name.text));
+  name.terminate();
+  TEST_ASSERT_EQUAL_UINT(BOX_NAME_MAX_LEN - 1, strlen(name.c_str()));
+}
+
+void test_registry_round_trips_through_box_name() {
+  BoxId id = registerBoxName("HEAPTEST_BOX_NAME_TOO_LONG");
+  TEST_ASSERT_NOT_EQUAL(BOX_ID_NONE, id);
+  TEST_ASSERT_EQUAL_INT(id, findBoxId("HEAPTEST_BOX_NAME_TOO_LONG"));
+  TEST_ASSERT_EQUAL_STRING("HEAPTEST_BOX_NA", boxName(id));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_records_baseline);
+  RUN_TEST(test_fragmentation_from_largest_block);
+  RUN_TEST(test_low_block_warned_once_per_dip);
+  RUN_TEST(test_periodic_summary);
+  RUN_TEST(test_heap_command);
+  RUN_TEST(test_box_name_is_fixed_capacity);
+  RUN_TEST(test_registry_round_trips_through_box_name);
+  return UNITY_END();
+}
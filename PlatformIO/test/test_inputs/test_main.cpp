@@ -0,0 +1,173 @@
+/*
+  Useless Boxes - Input pipeline tests (env:native)
+  -------------------------
+  Every digital input goes ISR edge -> timestamped ring -> debounce ->
+  per-channel event. These tests bounce the contacts at µs spacing and
+  check that each burst reaches the control logic once (or not at all),
+  stamped with its first edge, and that an ISR motor cut on a pure
+  bounce doesn't leave the arm stuck.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+#include "input_debounce.h"
+
+namespace {
+  const uint32_t SETTLE_US = SWITCH_DEBOUNCE_TIME * 1000UL;
+
+  // `edges` alternating edges 200 µs apart, ending at `finalLevel`
+  void bounce(int pin, int finalLevel, int edges) {
+    int level = (edges % 2) ? finalLevel : !finalLevel;
+    for (int i = 0; i < edges; i++) {
+      fake::setInput(pin, level);
+      fake::advanceUs(200);
+      level = !level;
+    }
+  }
+
+  size_t occurrences(const char* text) {
+    logFlush();
+    const std::string& out = fake::serialOutput();
+    size_t count = 0;
+    for (size_t at = out.find(text); at != std::string::npos; at = out.find(text, at + 1)) count++;
+    return count;
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  sim::settleAtRest();
+  fake::cloudWrite(active_box, "NONE");
+  sim::runFor(20);
+  fake::serialOutput().clear();
+}
+
+void tearDown() {}
+
+void test_debouncer_reports_one_change_per_burst() {
+  DebouncedInput in;
+  in.reset(LOW);
+  in.edge(HIGH, 1000);
+  in.edge(LOW, 1200);
+  in.edge(HIGH, 1400);
+  TEST_ASSERT_FALSE(in.settle(HIGH, 1400 + SETTLE_US - 1, SETTLE_US));
+  TEST_ASSERT_EQUAL_UINT32(1400 + SETTLE_US, in.settlesAtUs(SETTLE_US));
+  TEST_ASSERT_TRUE(in.settle(HIGH, 1400 + SETTLE_US, SETTLE_US));
+  TEST_ASSERT_EQUAL_INT(HIGH, in.stable);
+  TEST_ASSERT_EQUAL_UINT32(1000, in.burstStartUs);
+  TEST_ASSERT_EQUAL_INT(3, in.edges);
+  TEST_ASSERT_FALSE(in.settle(HIGH, 1400 + 2 * SETTLE_US, SETTLE_US));
+}
+
+void test_debouncer_ignores_glitch_and_catches_missed_edge() {
+  DebouncedInput in;
+  in.reset(HIGH);
+  in.edge(LOW, 0);
+  in.edge(HIGH, 300);
+  TEST_ASSERT_FALSE(in.settle(HIGH, 300 + SETTLE_US, SETTLE_US)); // back where it was
+  TEST_ASSERT_EQUAL_INT(HIGH, in.stable);
+
+  in.edge(LOW, 50000);
+  // the rising edge was lost: the read-back restarts the settle time
+  TEST_ASSERT_FALSE(in.settle(HIGH, 50000 + SETTLE_US, SETTLE_US));
+  TEST_ASSERT_FALSE(in.settle(HIGH, 50000 + 2 * SETTLE_US - 1, SETTLE_US));
+  TEST_ASSERT_FALSE(in.settle(HIGH, 50000 + 2 * SETTLE_US, SETTLE_US));
+  TEST_ASSERT_EQUAL_INT(HIGH, in.stable);
+}
+
+void test_switch_bounce_claims_once() {
+  uint32_t filtered = inputBouncesFiltered(INPUT_SWITCH);
+  bounce(SWITCH_PIN, HIGH, 7);
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 20);
+  TEST_ASSERT_EQUAL_UINT(1, occurrences("Switch changed to: FORWARD"));
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+  TEST_ASSERT_EQUAL_UINT32(filtered + 6, inputBouncesFiltered(INPUT_SWITCH));
+}
+
+void test_switch_glitch_is_filtered() {
+  bounce(SWITCH_PIN, LOW, 4);
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 20);
+  TEST_ASSERT_EQUAL_UINT(0, occurrences("Switch changed"));
+  TEST_ASSERT_EQUAL_STRING("NONE", sim::cloudActive().c_str());
+  TEST_ASSERT_EQUAL_INT(0, sim::motorDrive());
+  TEST_ASSERT_EQUAL_INT(LOW, inputLevel(INPUT_SWITCH));
+}
+
+void test_limit_bounce_is_one_change() {
+  uint32_t filtered = inputBouncesFiltered(INPUT_LIMIT);
+  bounce(LIMIT_PIN, LOW, 5);
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 20);
+  TEST_ASSERT_EQUAL_INT(LOW, inputLevel(INPUT_LIMIT));
+  TEST_ASSERT_EQUAL_UINT32(filtered + 4, inputBouncesFiltered(INPUT_LIMIT));
+  bounce(LIMIT_PIN, HIGH, 5);
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 20);
+  TEST_ASSERT_EQUAL_INT(HIGH, inputLevel(INPUT_LIMIT));
+}
+
+void test_isr_cut_on_bounce_rearms_motor() {
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(50);
+  fake::cloudWrite(active_box, "TREVOR"); // another box claims: forward stroke
+  sim::runFor(20);
+  fake::setInput(LIMIT_PIN, LOW);   // arm has left the limit
+  sim::runFor(50);
+  TEST_ASSERT_EQUAL_INT(1, sim::motorDrive());
+
+  // a brief drop on the switch cuts EN1 from the ISR...
+  fake::setInput(SWITCH_PIN, LOW);
+  TEST_ASSERT_EQUAL_INT(0, sim::motorDrive());
+  fake::advanceUs(300);
+  fake::setInput(SWITCH_PIN, HIGH);
+  // ...and once it has settled back the stroke carries on
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 5);
+  TEST_ASSERT_EQUAL_INT(1, sim::motorDrive());
+  TEST_ASSERT_EQUAL_UINT(0, occurrences("Switch changed to: REVERSE"));
+}
+
+void test_button_bounce_is_one_short_press() {
+  bounce(BUTTON_PIN, LOW, 5);
+  sim::runFor(120);
+  bounce(BUTTON_PIN, HIGH, 5);
+  sim::runFor(100);
+  TEST_ASSERT_EQUAL_UINT(1, occurrences("> Setting "));
+  TEST_ASSERT_EQUAL_INT(HIGH, inputLevel(INPUT_BUTTON));
+}
+
+void test_edge_ring_overflow_resamples() {
+  // more edges than the ring holds before the control task runs
+  for (size_t i = 0; i < INPUT_EDGE_QUEUE_CAPACITY + 9; i++) {
+    fake::setInput(LIMIT_PIN, (i % 2) ? HIGH : LOW);
+    fake::advanceUs(50);
+  }
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 20);
+  TEST_ASSERT_EQUAL_INT(fake::pinLevel(LIMIT_PIN), inputLevel(INPUT_LIMIT));
+  fake::setInput(LIMIT_PIN, HIGH);
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 20);
+  TEST_ASSERT_EQUAL_INT(HIGH, inputLevel(INPUT_LIMIT));
+}
+
+void test_inputs_command() {
+  bounce(SWITCH_PIN, LOW, 2);
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 5);
+  fake::serialInput("inputs\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("button HIGH"));
+  TEST_ASSERT_TRUE(sim::outputContains("switch LOW"));
+  TEST_ASSERT_TRUE(sim::outputContains("limit  HIGH"));
+  TEST_ASSERT_TRUE(sim::outputContains("bounce edges filtered"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_debouncer_reports_one_change_per_burst);
+  RUN_TEST(test_debouncer_ignores_glitch_and_catches_missed_edge);
+  RUN_TEST(test_switch_bounce_claims_once);
+  RUN_TEST(test_switch_glitch_is_filtered);
+  RUN_TEST(test_limit_bounce_is_one_change);
+  RUN_TEST(test_isr_cut_on_bounce_rearms_motor);
+  RUN_TEST(test_button_bounce_is_one_short_press);
+  RUN_TEST(test_edge_ring_overflow_resamples);
+  RUN_TEST(test_inputs_command);
+  return UNITY_END();
+}
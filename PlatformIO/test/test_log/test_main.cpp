@@ -0,0 +1,101 @@
+/*
+  Useless Boxes - Buffered log tests (env:native)
+  -------------------------
+  Checks the deferred-format ring on its own: records print in order with
+  their arguments, a full ring drops instead of blocking and reports the
+  loss, levels compile out, and firmware messages reach the serial port
+  only when the log is drained.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+
+namespace {
+  const std::string& output() { return fake::serialOutput(); }
+}
+
+void setUp() {
+  fake::reset();
+  logBegin();
+}
+
+void tearDown() {}
+
+void test_records_wait_for_drain() {
+  LOG_INFO("first %d", 1);
+  TEST_ASSERT_TRUE(output().empty());
+  TEST_ASSERT_EQUAL_UINT(1, logDrain());
+  TEST_ASSERT_TRUE(output().find("first 1") != std::string::npos);
+  TEST_ASSERT_EQUAL_UINT(0, logDrain());
+}
+
+void test_records_keep_order_and_arguments() {
+  LOG_WARN("%s stroke %lu ms", "forward", (unsigned long)1234);
+  LOG_INFO("speed %d%%, delta %d", 80, -5);
+  LOG_ERROR("four %u %u %u %u", 1u, 2u, 3u, 4u);
+  logFlush();
+  size_t a = output().find("W] forward stroke 1234 ms");
+  size_t b = output().find("I] speed 80%, delta -5");
+  size_t c = output().find("E] four 1 2 3 4");
+  TEST_ASSERT_TRUE(a != std::string::npos);
+  TEST_ASSERT_TRUE(b != std::string::npos);
+  TEST_ASSERT_TRUE(c != std::string::npos);
+  TEST_ASSERT_TRUE(a < b && b < c);
+}
+
+void test_full_ring_drops_and_reports() {
+  for (size_t i = 0; i < LOG_RING_CAPACITY; i++) LOG_INFO("fill %u", (unsigned)i);
+  TEST_ASSERT_FALSE(logDeferred(LOG_LEVEL_INFO, "overflow"));
+  LOG_INFO("overflow");
+  TEST_ASSERT_EQUAL_UINT32(2, logDropped());
+  TEST_ASSERT_EQUAL_UINT(LOG_RING_CAPACITY, logDrain());
+  TEST_ASSERT_TRUE(output().find("fill 63") != std::string::npos);
+  TEST_ASSERT_TRUE(output().find("overflow") == std::string::npos);
+  TEST_ASSERT_TRUE(output().find("[log] 2 dropped") != std::string::npos);
+  // the slots are reusable after a lap
+  LOG_INFO("after lap");
+  logFlush();
+  TEST_ASSERT_TRUE(output().find("after lap") != std::string::npos);
+}
+
+void test_debug_compiled_out_by_default() {
+  LOG_DEBUG("hidden %d", 7);
+  logFlush();
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  TEST_ASSERT_TRUE(output().find("hidden 7") != std::string::npos);
+#else
+  TEST_ASSERT_TRUE(output().find("hidden 7") == std::string::npos);
+  TEST_ASSERT_EQUAL_UINT32(0, logDropped());
+#endif
+}
+
+void test_long_lines_are_truncated() {
+  LOG_INFO("%s%s%s", "0123456789012345678901234567890123456789012345678901234567890123456789",
+           "0123456789012345678901234567890123456789012345678901234567890123456789",
+           "0123456789012345678901234567890123456789012345678901234567890123456789");
+  logFlush();
+  TEST_ASSERT_LESS_OR_EQUAL(LOG_LINE_MAX + 2, output().size()); // + "\r\n"
+}
+
+void test_firmware_messages_go_through_the_log() {
+  fake::clearPreferences();
+  sim::boot();
+  TEST_ASSERT_TRUE(sim::outputContains("System Initialized."));
+  fake::serialOutput().clear();
+  fake::setInput(SWITCH_PIN, LOW);
+  sim::runFor(20);
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(20);
+  TEST_ASSERT_TRUE(sim::outputContains("I] Switch changed to: FORWARD"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_wait_for_drain);
+  RUN_TEST(test_records_keep_order_and_arguments);
+  RUN_TEST(test_full_ring_drops_and_reports);
+  RUN_TEST(test_debug_compiled_out_by_default);
+  RUN_TEST(test_long_lines_are_truncated);
+  RUN_TEST(test_firmware_messages_go_through_the_log);
+  return UNITY_END();
+}
@@ -0,0 +1,140 @@
+/*
+  Useless Boxes - Data-driven menu tests (env:native)
+  -------------------------
+  Every setting is a MenuItem descriptor handled by one engine: these
+  tests walk to entries with the button, check the generic show/adjust
+  wrap-around and hooks, and the single-call JSON export behind `menu`.
+  Firmware globals outlive sim::boot(), so entries are found by name.
+  -------------------------
+*/
+#include <unity.h>
+#include <string.h>
+#include "sim_harness.h"
+
+namespace {
+  void shortPress() {
+    sim::press(BUTTON_PIN, 120);
+    sim::runFor(100);
+  }
+
+  void longPress() {
+    sim::press(BUTTON_PIN, DEFAULT_LONG_PRESS_TIME + 200);
+    sim::runFor(100);
+  }
+
+  // Short-press until the main menu shows `name`
+  void selectMenu(const char* name) {
+    std::string wanted = std::string(": ") + name + "\r\n";
+    for (int i = 0; i <= totalMenus; i++) {
+      fake::serialOutput().clear();
+      shortPress();
+      for (int n = 1; n <= totalMenus; n++) {
+        if (sim::outputContains(("> Setting " + std::to_string(n) + wanted).c_str())) return;
+      }
+    }
+    TEST_FAIL_MESSAGE("menu entry not found");
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  fake::setInput(SWITCH_PIN, LOW);
+  fake::setInput(LIMIT_PIN, HIGH);
+  sim::runFor(100);
+}
+
+void tearDown() {}
+
+void test_table_describes_every_setting() {
+  TEST_ASSERT_EQUAL_INT(7, totalMenus);
+  for (int i = 0; i < totalMenus; i++) {
+    const MenuItem& item = menuItems[i];
+    TEST_ASSERT_NOT_NULL(item.value);
+    TEST_ASSERT_NOT_NULL(item.set);
+    TEST_ASSERT_TRUE(item.min <= item.max);
+    TEST_ASSERT_TRUE(item.step > 0);
+  }
+}
+
+void test_number_setting_wraps_to_minimum() {
+  selectMenu("Motor Speed");
+  longPress();
+  setMotorSpeed(90);
+  fake::serialOutput().clear();
+  shortPress();
+  TEST_ASSERT_EQUAL_INT(100, motorSpeed);
+  TEST_ASSERT_TRUE(sim::outputContains("Motor Speed: 100%"));
+  shortPress();
+  TEST_ASSERT_EQUAL_INT(40, motorSpeed);
+  longPress();
+  TEST_ASSERT_TRUE(sim::outputContains("✅ Saved and returned to main menu."));
+}
+
+void test_named_setting_cycles_and_previews() {
+  selectMenu("Active RGB");
+  longPress();
+  setActiveRGBSetting(RGB_MODE_COUNT - 1);
+  fake::serialOutput().clear();
+  shortPress();
+  TEST_ASSERT_EQUAL_INT(RGB_OFF, activeRGBSetting);
+  TEST_ASSERT_TRUE(sim::outputContains("Active RGB Mode: OFF"));
+  TEST_ASSERT_EQUAL_INT(RGB_OFF, currentRGBMode);   // live preview
+  shortPress();
+  TEST_ASSERT_EQUAL_INT(RGB_WHITE, activeRGBSetting);
+  longPress();
+  TEST_ASSERT_TRUE(sim::outputContains("Active RGB Mode: WHITE"));
+}
+
+void test_buzzer_setting_demos_new_pattern() {
+  selectMenu("Inactive Buzzer");
+  longPress();
+  setInactiveBuzzerSetting(BUZZER_OFF);
+  fake::serialOutput().clear();
+  shortPress();
+  TEST_ASSERT_EQUAL_INT(BUZZER_SINGLE, inactiveBuzzerSetting);
+  TEST_ASSERT_TRUE(sim::outputContains("Inactive Buzzer: "));
+  TEST_ASSERT_TRUE(sim::outputContains(buzzerPatternName(BUZZER_SINGLE)));
+  longPress();
+}
+
+void test_format_menu_exports_all_settings() {
+  setRGBBrightness(70);
+  char json[768];
+  size_t len = formatMenu(json, sizeof(json));
+  TEST_ASSERT_EQUAL_UINT(strlen(json), len);
+  TEST_ASSERT_EQUAL_INT('{', json[0]);
+  TEST_ASSERT_EQUAL_INT('}', json[len - 1]);
+  TEST_ASSERT_NOT_NULL(strstr(json, "\"RGB Brightness\":{\"value\":70,\"unit\":\"%\",\"min\":0,\"max\":100,\"step\":10}"));
+  for (int i = 0; i < totalMenus; i++) {
+    TEST_ASSERT_NOT_NULL(strstr(json, menuItems[i].name));
+  }
+}
+
+void test_format_menu_truncates_safely() {
+  char small[40];
+  memset(small, 'x', sizeof(small));
+  size_t len = formatMenu(small, sizeof(small));
+  TEST_ASSERT_EQUAL_UINT(sizeof(small) - 1, len);
+  TEST_ASSERT_EQUAL_INT('\0', small[sizeof(small) - 1]);
+}
+
+void test_menu_command() {
+  fake::serialOutput().clear();
+  fake::serialInput("menu\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("{\"Active RGB\":{\"value\":"));
+  TEST_ASSERT_TRUE(sim::outputContains("\"Buzzer Volume\":{"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_table_describes_every_setting);
+  RUN_TEST(test_number_setting_wraps_to_minimum);
+  RUN_TEST(test_named_setting_cycles_and_previews);
+  RUN_TEST(test_buzzer_setting_demos_new_pattern);
+  RUN_TEST(test_format_menu_exports_all_settings);
+  RUN_TEST(test_format_menu_truncates_safely);
+  RUN_TEST(test_menu_command);
+  return UNITY_END();
+}
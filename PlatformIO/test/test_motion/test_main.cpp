@@ -0,0 +1,149 @@
+/*
+  Useless Boxes - Motion profile tests (env:native, LEDC motor backend)
+  -------------------------
+  Checks the ramp math in motion_profile.cpp directly, then drives strokes
+  through the fake HAL: the EN1 duty ramps up from the start speed, the
+  bridge brakes before reversing, and once a stroke's duration is known the
+  next one in that direction slows down for its last approachMs.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+
+namespace {
+  const MotionProfile TRAPEZOID = { MOTION_TRAPEZOID, 100, 40, 100, 20, 40 };
+  const MotionProfile SCURVE = { MOTION_SCURVE, 100, 40, 100, 20, 40 };
+
+  // Forward stroke of about `ms`, the return stroke, and back at rest
+  void runFullCycle(unsigned long ms) {
+    sim::startForwardStroke(true);
+    sim::runFor(ms);
+    fake::setInput(SWITCH_PIN, LOW);
+    sim::runFor(300);
+    fake::setInput(LIMIT_PIN, HIGH);
+    sim::runFor(50);
+    fake::cloudWrite(active_box, "NONE");  // TREVOR releases, so its next claim is a new value
+    sim::runFor(20);
+  }
+
+  uint32_t duty() { return (uint32_t)fake::pwmDuty(EN1); }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  motionProfile = DEFAULT_MOTION_PROFILE;
+  setMotorSpeed(100);
+  sim::settleAtRest();
+  fake::cloudWrite(active_box, "NONE");
+  sim::runFor(20);
+  fake::serialInput("motion forget\n");
+  sim::runFor(10);
+  fake::serialOutput().clear();
+}
+
+void tearDown() {}
+
+void test_ramp_reaches_cruise_at_accel_end() {
+  TEST_ASSERT_EQUAL_UINT32(200, motionSpeedAt(TRAPEZOID, 0, 0, 100));
+  TEST_ASSERT_EQUAL_UINT32(600, motionSpeedAt(TRAPEZOID, 50, 0, 100));
+  TEST_ASSERT_EQUAL_UINT32(1000, motionSpeedAt(TRAPEZOID, 100, 0, 100));
+  TEST_ASSERT_EQUAL_UINT32(500, motionSpeedAt(TRAPEZOID, 5000, 0, 50));
+}
+
+void test_scurve_starts_and_ends_gently() {
+  // Same midpoint as the linear ramp, but flatter near both ends
+  TEST_ASSERT_EQUAL_UINT32(600, motionSpeedAt(SCURVE, 50, 0, 100));
+  TEST_ASSERT_LESS_THAN(motionSpeedAt(TRAPEZOID, 10, 0, 100), motionSpeedAt(SCURVE, 10, 0, 100));
+  TEST_ASSERT_GREATER_THAN(motionSpeedAt(TRAPEZOID, 90, 0, 100), motionSpeedAt(SCURVE, 90, 0, 100));
+}
+
+void test_approach_window_slows_known_stroke() {
+  // 500 ms stroke: slowdown ramps from 300 ms, approach speed from 400 ms
+  TEST_ASSERT_EQUAL_UINT32(1000, motionSpeedAt(TRAPEZOID, 299, 500, 100));
+  TEST_ASSERT_EQUAL_UINT32(700, motionSpeedAt(TRAPEZOID, 350, 500, 100));
+  TEST_ASSERT_EQUAL_UINT32(400, motionSpeedAt(TRAPEZOID, 450, 500, 100));
+  uint32_t next;
+  TEST_ASSERT_FALSE(motionRamping(TRAPEZOID, 150, 500, 100, next));
+  TEST_ASSERT_EQUAL_UINT32(300, next);
+  // Never sped up by the approach speed
+  TEST_ASSERT_EQUAL_UINT32(300, motionSpeedAt(TRAPEZOID, 450, 500, 30));
+}
+
+void test_step_shape_is_flat() {
+  MotionProfile step = TRAPEZOID;
+  step.shape = MOTION_STEP;
+  TEST_ASSERT_EQUAL_UINT32(1000, motionSpeedAt(step, 0, 500, 100));
+  TEST_ASSERT_EQUAL_UINT32(1000, motionSpeedAt(step, 450, 500, 100));
+}
+
+void test_stroke_duty_ramps_up() {
+  sim::startForwardStroke(false);
+  uint32_t last = duty();
+  TEST_ASSERT_LESS_THAN(motorDutyForSpeed(motionProfile.startSpeed + 5), last);
+  for (int i = 0; i < motionProfile.accelMs; i += 10) {
+    sim::runFor(10);
+    TEST_ASSERT_GREATER_OR_EQUAL(last, duty());
+    last = duty();
+  }
+  TEST_ASSERT_EQUAL_UINT32(MOTOR_PWM_MAX_DUTY, duty());
+}
+
+void test_step_profile_drives_full_duty_at_once() {
+  motionProfile.shape = MOTION_STEP;
+  sim::startForwardStroke(false);
+  TEST_ASSERT_EQUAL_UINT32(MOTOR_PWM_MAX_DUTY, duty());
+}
+
+void test_second_stroke_uses_learned_duration() {
+  motionProfile = TRAPEZOID;
+  runFullCycle(500);
+  fake::serialInput("motion\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("Learned strokes (ms): forward 5"));
+
+  sim::startForwardStroke(false);
+  fake::setInput(LIMIT_PIN, LOW);
+  sim::runFor(250);
+  TEST_ASSERT_EQUAL_UINT32(MOTOR_PWM_MAX_DUTY, duty());
+  sim::runFor(500 - 250 - motionProfile.approachMs / 2);
+  TEST_ASSERT_UINT32_WITHIN(3, motorDutyForSpeed(motionProfile.approachSpeed), duty());
+}
+
+void test_reversal_without_brake_phase() {
+  motionProfile.brakeMs = 0;
+  sim::startForwardStroke(false);
+  fake::setInput(LIMIT_PIN, LOW);
+  sim::runFor(200);
+  fake::setInput(SWITCH_PIN, LOW);
+  sim::runFor(SWITCH_DEBOUNCE_TIME + 1); // reverses as soon as the switch settles
+  TEST_ASSERT_EQUAL_INT(HIGH, fake::pinLevel(IN2));
+  TEST_ASSERT_EQUAL_INT(LOW, fake::pinLevel(IN1));
+}
+
+void test_serial_motion_command_sets_profile() {
+  fake::serialInput("motion shape trapezoid\n");
+  sim::runFor(10);
+  TEST_ASSERT_EQUAL_INT(MOTION_TRAPEZOID, motionProfile.shape);
+  fake::serialInput("motion accel 80\n");
+  sim::runFor(10);
+  TEST_ASSERT_EQUAL_UINT32(80, motionProfile.accelMs);
+  TEST_ASSERT_TRUE(sim::outputContains("Motion: trapezoid, accel 80 ms"));
+  fake::serialInput("motion slow 101\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("Usage: motion"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramp_reaches_cruise_at_accel_end);
+  RUN_TEST(test_scurve_starts_and_ends_gently);
+  RUN_TEST(test_approach_window_slows_known_stroke);
+  RUN_TEST(test_step_shape_is_flat);
+  RUN_TEST(test_stroke_duty_ramps_up);
+  RUN_TEST(test_step_profile_drives_full_duty_at_once);
+  RUN_TEST(test_second_stroke_uses_learned_duration);
+  RUN_TEST(test_reversal_without_brake_phase);
+  RUN_TEST(test_serial_motion_command_sets_profile);
+  return UNITY_END();
+}
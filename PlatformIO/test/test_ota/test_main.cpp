@@ -0,0 +1,162 @@
+/*
+  Useless Boxes - OTA gate and boot validation tests (env:native)
+  -------------------------
+  The cloud's "may I start the download?" question is only answered yes
+  while the arm is parked, and from then on no new stroke starts until
+  the download ends; a freshly updated image marks itself valid after
+  running healthily (online or not), and asks the bootloader to roll back
+  when its control loop stalls. The `firmware_version` property reports
+  the state.
+  -------------------------
+*/
+#include <unity.h>
+#include <string.h>
+#include "sim_harness.h"
+#include "ota_update.h"
+
+namespace {
+  bool motorDriven() {
+    return fake::pwmDuty(EN1) > 0;
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  fake::setOtaPendingVerify(false);
+  active_box = "";                    // the cloud would replay the last test's claim
+  fake::setInput(SWITCH_PIN, LOW);
+  fake::setInput(LIMIT_PIN, HIGH);
+}
+
+void tearDown() {}
+
+void test_valid_image_reports_version() {
+  sim::boot();
+  sim::runFor(100);
+  TEST_ASSERT_EQUAL_INT(OTA_IMAGE_VALID, otaImageState());
+  TEST_ASSERT_TRUE(strstr(firmware_version.c_str(), "dev ") == firmware_version.c_str());
+  TEST_ASSERT_TRUE(strstr(firmware_version.c_str(), "app0, valid") != nullptr);
+}
+
+void test_download_waits_for_parked_arm() {
+  sim::boot();
+  sim::runFor(100);
+
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(50);
+  fake::cloudWrite(active_box, "TREVOR"); // another box claims: forward stroke
+  sim::runFor(20);
+  TEST_ASSERT_FALSE(fake::cloudOfferOta());
+  TEST_ASSERT_TRUE(sim::outputContains("OTA update waiting for the arm to park"));
+
+  fake::setInput(LIMIT_PIN, LOW);   // arm leaves the limit...
+  sim::runFor(50);
+  fake::setInput(SWITCH_PIN, LOW);  // ...knocks the switch off and returns
+  sim::runFor(200);
+  TEST_ASSERT_FALSE(fake::cloudOfferOta());
+  fake::setInput(LIMIT_PIN, HIGH);  // home
+  sim::runFor(20);
+  TEST_ASSERT_TRUE(fake::cloudOfferOta());
+  TEST_ASSERT_TRUE(sim::outputContains("OTA update starting"));
+}
+
+void test_switch_flip_mid_download_is_held() {
+  sim::boot();
+  sim::runFor(100);
+  TEST_ASSERT_TRUE(fake::cloudOfferOta());  // download confirmed, image streaming
+
+  fake::setInput(SWITCH_PIN, HIGH);
+  sim::runFor(50);
+  fake::cloudWrite(active_box, "TREVOR");   // would start a forward stroke
+  sim::runFor(200);
+  TEST_ASSERT_FALSE(motorDriven());
+  TEST_ASSERT_TRUE(otaHoldsStrokes());
+  TEST_ASSERT_TRUE(sim::outputContains("Stroke held until the OTA download ends"));
+
+  // A download that never rebooted the box gives the arm back
+  sim::runFor(OTA_DOWNLOAD_HOLD_MS);
+  TEST_ASSERT_FALSE(otaHoldsStrokes());
+  TEST_ASSERT_TRUE(sim::outputContains("strokes released"));
+  TEST_ASSERT_TRUE(motorDriven());
+  fake::setInput(LIMIT_PIN, LOW);
+  sim::runFor(50);
+  fake::setInput(SWITCH_PIN, LOW);
+  sim::runFor(200);
+  fake::setInput(LIMIT_PIN, HIGH);
+  sim::runFor(50);
+}
+
+void test_pending_image_validated_after_healthy_run() {
+  fake::setOtaPendingVerify(true);
+  sim::boot();
+  sim::runFor(100);
+  TEST_ASSERT_EQUAL_INT(OTA_IMAGE_PENDING, otaImageState());
+  TEST_ASSERT_TRUE(strstr(firmware_version.c_str(), "pending verify") != nullptr);
+
+  sim::runFor(OTA_VALIDATE_HEALTHY_MS);
+  TEST_ASSERT_EQUAL_INT(OTA_IMAGE_VALID, otaImageState());
+  TEST_ASSERT_FALSE(fake::otaPendingVerify());
+  TEST_ASSERT_FALSE(fake::otaRollbackRequested());
+  TEST_ASSERT_TRUE(strstr(firmware_version.c_str(), "valid") != nullptr);
+  TEST_ASSERT_TRUE(sim::outputContains("validated"));
+}
+
+// Home Wi-Fi down is no reason to throw away a working image
+void test_offline_image_is_kept_on_local_health() {
+  fake::setOtaPendingVerify(true);
+  sim::boot();
+  fake::setCloudConnected(false);
+  sim::runFor(OTA_VALIDATE_HEALTHY_MS + 1000);
+  TEST_ASSERT_FALSE(fake::otaRollbackRequested());
+  TEST_ASSERT_EQUAL_INT(OTA_IMAGE_VALID, otaImageState());
+  TEST_ASSERT_TRUE(sim::outputContains("validated on local health — cloud not reached yet"));
+  fake::setCloudConnected(true);
+}
+
+void test_stalled_control_loop_rolls_back() {
+  fake::setOtaPendingVerify(true);
+  sim::boot();
+  sim::runFor(1000);
+  // Only the network task keeps running
+  for (unsigned long t = 0; t <= OTA_CONTROL_STALL_MS; t += NETWORK_TASK_INTERVAL_MS) {
+    networkLoop();
+    fake::advanceMs(NETWORK_TASK_INTERVAL_MS);
+  }
+  TEST_ASSERT_TRUE(fake::otaRollbackRequested());
+  TEST_ASSERT_EQUAL_INT(OTA_IMAGE_ROLLING_BACK, otaImageState());
+  TEST_ASSERT_TRUE(sim::outputContains("control loop stalled — rolling back"));
+}
+
+// The control task (other core) stamps its pass after the network task sampled millis()
+void test_control_pass_after_the_sample_is_not_a_stall() {
+  fake::setOtaPendingVerify(true);
+  sim::boot();
+  sim::runFor(1000);
+  unsigned long now = millis();
+  otaNoteControlPass(now + 1);
+  serviceOtaUpdates(now);
+  TEST_ASSERT_FALSE(fake::otaRollbackRequested());
+  TEST_ASSERT_EQUAL_INT(OTA_IMAGE_PENDING, otaImageState());
+}
+
+void test_ota_command() {
+  fake::setOtaPendingVerify(true);
+  sim::boot();
+  fake::serialInput("ota\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("on app0: pending verify"));
+  TEST_ASSERT_TRUE(sim::outputContains("kept in"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_valid_image_reports_version);
+  RUN_TEST(test_download_waits_for_parked_arm);
+  RUN_TEST(test_switch_flip_mid_download_is_held);
+  RUN_TEST(test_pending_image_validated_after_healthy_run);
+  RUN_TEST(test_offline_image_is_kept_on_local_health);
+  RUN_TEST(test_stalled_control_loop_rolls_back);
+  RUN_TEST(test_control_pass_after_the_sample_is_not_a_stall);
+  RUN_TEST(test_ota_command);
+  return UNITY_END();
+}
@@ -0,0 +1,127 @@
+/*
+  Useless Boxes - active_box publish coalescing tests (env:native)
+  -------------------------
+  Local claims reach the cloud through a PublishCoalescer: at most one
+  `active_box` write per ACTIVE_BOX_PUBLISH_WINDOW_MS, only the latest
+  value, and nothing when peers already have it. Checked on the struct
+  and on switch toggles through the firmware.
+  -------------------------
+*/
+#include <unity.h>
+#include "sim_harness.h"
+#include "publish_coalescer.h"
+
+namespace {
+  const BoxId A = 1;
+  const BoxId B = 2;
+
+  void flipSwitch(int level) {
+    fake::setInput(SWITCH_PIN, level);
+    sim::runFor(SWITCH_DEBOUNCE_TIME + 2 * NETWORK_TASK_INTERVAL_MS); // settle, then one network pass
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  fake::setInput(SWITCH_PIN, LOW);
+  fake::setInput(LIMIT_PIN, HIGH);
+  fake::cloudWrite(active_box, "NONE");
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS + 100);
+  fake::serialOutput().clear();
+}
+
+void tearDown() {}
+
+void test_first_change_goes_out_at_once() {
+  PublishCoalescer c;
+  c.reset();
+  BoxId out = BOX_ID_NONE;
+  c.want(A);
+  TEST_ASSERT_TRUE(c.due(1000, 500, out));
+  TEST_ASSERT_EQUAL_INT(A, out);
+  TEST_ASSERT_FALSE(c.due(1001, 500, out));
+  TEST_ASSERT_EQUAL_UINT32(1, c.sent);
+}
+
+void test_changes_within_window_collapse() {
+  PublishCoalescer c;
+  c.reset();
+  BoxId out = BOX_ID_NONE;
+  c.want(A);
+  TEST_ASSERT_TRUE(c.due(0, 500, out));
+  c.want(B);
+  c.want(BOX_ID_NONE);
+  TEST_ASSERT_FALSE(c.due(499, 500, out));
+  TEST_ASSERT_TRUE(c.due(500, 500, out));
+  TEST_ASSERT_EQUAL_INT(BOX_ID_NONE, out);
+  TEST_ASSERT_EQUAL_UINT32(2, c.sent);
+  TEST_ASSERT_EQUAL_UINT32(1, c.coalesced);
+}
+
+void test_value_peers_have_is_not_sent() {
+  PublishCoalescer c;
+  c.reset();
+  BoxId out = BOX_ID_NONE;
+  c.observed(B);          // the cloud delivered B
+  c.want(B);
+  TEST_ASSERT_FALSE(c.due(0, 500, out));
+  TEST_ASSERT_EQUAL_UINT32(1, c.unchanged);
+  // toggle back to the sent value inside the window: nothing to write
+  c.want(A);
+  TEST_ASSERT_TRUE(c.due(10, 500, out));
+  c.want(BOX_ID_NONE);
+  c.want(A);
+  TEST_ASSERT_FALSE(c.due(600, 500, out));
+  TEST_ASSERT_EQUAL_UINT32(1, c.sent);
+  TEST_ASSERT_EQUAL_UINT32(2, c.unchanged);
+}
+
+void test_unsynced_cloud_value_does_not_suppress() {
+  PublishCoalescer c;
+  c.reset();
+  BoxId out = A;
+  c.want(BOX_ID_NONE);    // nothing observed yet: NONE may not be what peers have
+  TEST_ASSERT_TRUE(c.due(0, 500, out));
+  TEST_ASSERT_EQUAL_INT(BOX_ID_NONE, out);
+}
+
+void test_switch_claim_is_published() {
+  flipSwitch(HIGH);
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+}
+
+void test_fast_toggle_publishes_final_state_once_per_window() {
+  flipSwitch(HIGH);
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+  flipSwitch(LOW);
+  // the release waits for the window; peers never see an extra state
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+  flipSwitch(HIGH);
+  flipSwitch(LOW);
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS);
+  TEST_ASSERT_EQUAL_STRING("NONE", sim::cloudActive().c_str());
+}
+
+void test_toggle_back_within_window_writes_nothing_more() {
+  flipSwitch(HIGH);
+  flipSwitch(LOW);
+  flipSwitch(HIGH);
+  sim::runFor(ACTIVE_BOX_PUBLISH_WINDOW_MS);
+  TEST_ASSERT_EQUAL_STRING(BOX_NAME, sim::cloudActive().c_str());
+  fake::serialInput("peers\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("active_box writes: 1 sent, 1 coalesced, 1 unchanged"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_change_goes_out_at_once);
+  RUN_TEST(test_changes_within_window_collapse);
+  RUN_TEST(test_value_peers_have_is_not_sent);
+  RUN_TEST(test_unsynced_cloud_value_does_not_suppress);
+  RUN_TEST(test_switch_claim_is_published);
+  RUN_TEST(test_fast_toggle_publishes_final_state_once_per_window);
+  RUN_TEST(test_toggle_back_within_window_writes_nothing_more);
+  return UNITY_END();
+}
@@ -0,0 +1,105 @@
+/*
+  Useless Boxes - Long-run replay (env:native)
+  -------------------------
+  Replays REPLAY_MS of simulated time against a simple arm model: the motor
+  moves the arm, the arm drives the switch and limit inputs, and random
+  user flips and cloud claims arrive on top. After every millisecond the
+  H-bridge outputs are checked against the safety invariants, and the
+  stall watchdog must never fire on the unobstructed arm. The run
+  reports simulated time per wall-clock second as a rough benchmark.
+  -------------------------
+*/
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "sim_harness.h"
+
+namespace {
+  constexpr unsigned long REPLAY_MS = 5000000;     // ~83 min of box time
+  constexpr int ARM_TRAVEL = 400 * 1000;           // full-speed ms x 1000, limit to switch
+  constexpr int ARM_OVERRUN = 20 * 1000;           // past either end before it's a failure
+  constexpr uint32_t FLIP_CHANCE = 2000;           // 1 in N per ms: user flips the switch on
+  constexpr uint32_t CLAIM_CHANCE = 3000;          // 1 in N per ms: the cloud reports a claim
+
+  uint32_t rngState = 0x12345678;
+  uint32_t nextRandom() {
+    rngState = rngState * 1664525u + 1013904223u;
+    return rngState >> 8;
+  }
+
+  struct Arm {
+    int position = 0;        // 0 = retracted on the limit, ARM_TRAVEL = on the switch
+    bool switchOn = false;
+  };
+
+  // Arm movement this ms, 1000 at full duty (the model has no inertia)
+  int armStep(int drive) {
+    int duty = fake::pwmDuty(EN1);
+    if (duty < 0) return drive * 1000;   // EN1 driven as a plain GPIO
+    return drive * (int)((uint32_t)duty * 1000 / MOTOR_PWM_MAX_DUTY);
+  }
+
+  void applyArm(const Arm& arm) {
+    int limit = arm.position <= 0 ? HIGH : LOW;      // NC limit opens when pressed
+    int sw = arm.switchOn ? HIGH : LOW;
+    if (fake::pinLevel(LIMIT_PIN) != limit) fake::setInput(LIMIT_PIN, limit);
+    if (fake::pinLevel(SWITCH_PIN) != sw) fake::setInput(SWITCH_PIN, sw);
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+}
+
+void tearDown() {}
+
+void test_replay_keeps_motor_within_travel() {
+  Arm arm;
+  applyArm(arm);
+  sim::runFor(100);
+
+  const char* const claims[] = { "TREVOR", BOX_NAME, "NONE" };
+  unsigned long forwardStrokes = 0;
+  unsigned long returns = 0;
+  int lastDrive = 0;
+
+  auto wallStart = std::chrono::steady_clock::now();
+  for (unsigned long t = 0; t < REPLAY_MS; t++) {
+    if (!arm.switchOn && nextRandom() % FLIP_CHANCE == 0) arm.switchOn = true;
+    if (nextRandom() % CLAIM_CHANCE == 0) {
+      fake::cloudWrite(active_box, claims[nextRandom() % 3]);
+    }
+
+    TEST_ASSERT_FALSE_MESSAGE(sim::motorEnabled() && fake::pinLevel(IN1) == HIGH && fake::pinLevel(IN2) == HIGH,
+                              "IN1 and IN2 both HIGH with EN1 enabled");
+    int drive = sim::motorDrive();
+    if (drive == 1 && lastDrive != 1) forwardStrokes++;
+    if (drive == -1 && lastDrive != -1) returns++;
+    lastDrive = drive;
+
+    arm.position += armStep(drive);
+    TEST_ASSERT_TRUE_MESSAGE(arm.position <= ARM_TRAVEL + ARM_OVERRUN, "arm drove past the switch");
+    TEST_ASSERT_TRUE_MESSAGE(arm.position >= -ARM_OVERRUN, "arm drove past the limit");
+    TEST_ASSERT_FALSE_MESSAGE(motorStallFault(), "stall reported on a free-running arm");
+    if (arm.position >= ARM_TRAVEL) arm.switchOn = false; // the arm knocks it off
+    applyArm(arm);
+
+    sim::runFor(1);
+    if (fake::serialOutput().size() > 65536) fake::serialOutput().clear();
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  char summary[160];
+  snprintf(summary, sizeof(summary), "%lu ms simulated in %.2f s (%.0fx real time), %lu forward strokes, %lu returns",
+           REPLAY_MS, wallSeconds, REPLAY_MS / 1000.0 / wallSeconds, forwardStrokes, returns);
+  TEST_MESSAGE(summary);
+  TEST_ASSERT_GREATER_THAN(0, forwardStrokes);
+  TEST_ASSERT_GREATER_THAN(0, returns);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_keeps_motor_within_travel);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+/*
+  Useless Boxes - Settings persistence tests (env:native)
+  -------------------------
+  Checks the settings cache against the in-memory Preferences store:
+  changes are batched into one blob write, survive a reboot, and older or
+  corrupt layouts fall back or migrate as documented in Useless_Boxes.cpp.
+  -------------------------
+*/
+#include <unity.h>
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include "sim_harness.h"
+
+namespace {
+  const char* const NVS_NAMESPACE = "useless_box";
+
+  void resetToDefaults() {
+    fake::clearPreferences();
+    sim::boot();
+    setActiveRGBSetting(RGB_RAINBOW);
+    setInactiveRGBSetting(RGB_SOLID_RED);
+    setRGBBrightness(DEFAULT_RGB_BRIGHTNESS_PERCENTAGE);
+    setActiveBuzzerSetting(BUZZER_CHIRP);
+    setInactiveBuzzerSetting(BUZZER_SINGLE);
+    setMotorSpeed(100);
+    setBuzzerVolume(DEFAULT_BUZZER_VOLUME);
+    commitSettings();
+  }
+}
+
+void setUp() {
+  resetToDefaults();
+  fake::serialOutput().clear();
+}
+
+void tearDown() {}
+
+void test_changes_commit_once_after_delay() {
+  uint32_t writes = Preferences::writeCount();
+  setMotorSpeed(60);
+  setRGBBrightness(40);
+  setActiveBuzzerSetting(BUZZER_OFF);
+  sim::runFor(SETTINGS_COMMIT_DELAY_MS - 100);
+  TEST_ASSERT_EQUAL_UINT32(writes, Preferences::writeCount());
+  sim::runFor(200);
+  TEST_ASSERT_EQUAL_UINT32(writes + 1, Preferences::writeCount());
+}
+
+void test_unchanged_value_does_not_write() {
+  uint32_t writes = Preferences::writeCount();
+  setMotorSpeed(motorSpeed);
+  setMotorSpeed(70);
+  setMotorSpeed(100); // back to the committed value
+  sim::runFor(SETTINGS_COMMIT_DELAY_MS * 2);
+  TEST_ASSERT_EQUAL_UINT32(writes, Preferences::writeCount());
+}
+
+void test_settings_survive_reboot() {
+  setMotorSpeed(35);
+  setInactiveRGBSetting(RGB_SOLID_BLUE);
+  setBuzzerVolume(30);
+  commitSettings();
+  sim::boot();
+  TEST_ASSERT_EQUAL_INT(35, motorSpeed);
+  TEST_ASSERT_EQUAL_INT(RGB_SOLID_BLUE, inactiveRGBSetting);
+  TEST_ASSERT_EQUAL_INT(30, buzzerVolume);
+}
+
+// Schema v1 had no buzzer volume: its body loads as a prefix on the defaults
+void test_v1_record_upgrades_with_default_volume() {
+  fake::clearPreferences();
+  const uint8_t body[6] = { RGB_SOLID_GREEN, RGB_OFF, 70, BUZZER_SOS, BUZZER_OFF, 45 };
+  uint8_t raw[8 + sizeof(body)];
+  uint32_t crc = esp_rom_crc32_le(0, body, sizeof(body));
+  raw[0] = 0x55; raw[1] = 0x42;                  // magic "UB", little endian
+  raw[2] = 1;                                    // version
+  raw[3] = sizeof(body);
+  memcpy(raw + 4, &crc, sizeof(crc));
+  memcpy(raw + 8, body, sizeof(body));
+  Preferences nvs;
+  nvs.begin(NVS_NAMESPACE, false);
+  nvs.putBytes("settings", raw, sizeof(raw));
+
+  setBuzzerVolume(DEFAULT_BUZZER_VOLUME);
+  sim::boot();
+  TEST_ASSERT_EQUAL_INT(BUZZER_SOS, activeBuzzerSetting);
+  TEST_ASSERT_EQUAL_INT(45, motorSpeed);
+  TEST_ASSERT_EQUAL_INT(DEFAULT_BUZZER_VOLUME, buzzerVolume);
+
+  sim::runFor(SETTINGS_COMMIT_DELAY_MS + 100);
+  TEST_ASSERT_GREATER_THAN(sizeof(raw), nvs.getBytesLength("settings"));
+}
+
+// A newer schema appends fields: this firmware loads its prefix and leaves it alone
+void test_newer_longer_record_loads_as_prefix() {
+  fake::clearPreferences();
+  uint8_t body[120] = { RGB_SOLID_BLUE, RGB_OFF, 65, BUZZER_OFF, BUZZER_SOS, 55, 25 };
+  body[119] = 0xA5;                              // a field this firmware doesn't know
+  uint8_t raw[8 + sizeof(body)];
+  uint32_t crc = esp_rom_crc32_le(0, body, sizeof(body));
+  raw[0] = 0x55; raw[1] = 0x42;
+  raw[2] = 9;
+  raw[3] = sizeof(body);
+  memcpy(raw + 4, &crc, sizeof(crc));
+  memcpy(raw + 8, body, sizeof(body));
+  Preferences nvs;
+  nvs.begin(NVS_NAMESPACE, false);
+  nvs.putBytes("settings", raw, sizeof(raw));
+
+  sim::boot();
+  TEST_ASSERT_FALSE(sim::outputContains("unreadable"));
+  TEST_ASSERT_EQUAL_INT(RGB_SOLID_BLUE, activeRGBSetting);
+  TEST_ASSERT_EQUAL_INT(55, motorSpeed);
+  TEST_ASSERT_EQUAL_INT(25, buzzerVolume);
+  sim::runFor(SETTINGS_COMMIT_DELAY_MS + 100);
+  uint8_t kept[sizeof(raw)];
+  TEST_ASSERT_EQUAL_UINT32(sizeof(raw), nvs.getBytes("settings", kept, sizeof(kept)));
+  TEST_ASSERT_EQUAL_INT(0, memcmp(raw, kept, sizeof(raw)));
+}
+
+void test_corrupt_blob_falls_back_to_defaults() {
+  setMotorSpeed(35);
+  commitSettings();
+
+  Preferences nvs;
+  nvs.begin(NVS_NAMESPACE, false);
+  uint8_t raw[32];
+  size_t len = nvs.getBytes("settings", raw, sizeof(raw));
+  TEST_ASSERT_GREATER_THAN(0, len);
+  raw[len - 1] ^= 0xFF; // body no longer matches the CRC
+  nvs.putBytes("settings", raw, len);
+
+  setMotorSpeed(100); // defaults as seen by the next boot
+  sim::boot();
+  TEST_ASSERT_TRUE(sim::outputContains("Stored settings unreadable"));
+  TEST_ASSERT_EQUAL_INT(100, motorSpeed);
+}
+
+void test_legacy_keys_migrate_to_blob() {
+  fake::clearPreferences();
+  Preferences nvs;
+  nvs.begin(NVS_NAMESPACE, false);
+  nvs.putInt("active_rgb", RGB_SOLID_GREEN);
+  nvs.putInt("inactive_rgb", RGB_OFF);
+  nvs.putInt("rgb_brightness", 55);
+  nvs.putInt("active_buzzer", BUZZER_OFF);
+  nvs.putInt("inactive_buzzer", BUZZER_OFF);
+  nvs.putInt("motor_speed", 80);
+
+  sim::boot();
+  TEST_ASSERT_EQUAL_INT(RGB_SOLID_GREEN, activeRGBSetting);
+  TEST_ASSERT_EQUAL_INT(55, rgb_brightness_percentage);
+  TEST_ASSERT_EQUAL_INT(80, motorSpeed);
+
+  sim::runFor(SETTINGS_COMMIT_DELAY_MS + 100);
+  TEST_ASSERT_TRUE(nvs.isKey("settings"));
+  TEST_ASSERT_FALSE(nvs.isKey("motor_speed"));
+
+  sim::boot();
+  TEST_ASSERT_EQUAL_INT(80, motorSpeed);
+}
+
+void test_out_of_range_values_are_clamped() {
+  fake::clearPreferences();
+  Preferences nvs;
+  nvs.begin(NVS_NAMESPACE, false);
+  nvs.putInt("active_rgb", RGB_RAINBOW);
+  nvs.putInt("motor_speed", 250);
+  sim::boot();
+  TEST_ASSERT_TRUE(sim::outputContains("clamped"));
+  TEST_ASSERT_LESS_OR_EQUAL(100, motorSpeed);
+}
+
+// 300 narrowed to uint8_t is 44, a legal brightness: it must be rejected first
+void test_legacy_ints_are_checked_before_narrowing() {
+  fake::clearPreferences();
+  Preferences nvs;
+  nvs.begin(NVS_NAMESPACE, false);
+  nvs.putInt("active_rgb", RGB_RAINBOW);
+  nvs.putInt("rgb_brightness", 300);
+  nvs.putInt("motor_speed", 256 + 40);
+  sim::boot();
+  TEST_ASSERT_TRUE(sim::outputContains("clamped"));
+  TEST_ASSERT_EQUAL_INT(DEFAULT_RGB_BRIGHTNESS_PERCENTAGE, rgb_brightness_percentage);
+  TEST_ASSERT_EQUAL_INT(100, motorSpeed);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_changes_commit_once_after_delay);
+  RUN_TEST(test_unchanged_value_does_not_write);
+  RUN_TEST(test_settings_survive_reboot);
+  RUN_TEST(test_v1_record_upgrades_with_default_volume);
+  RUN_TEST(test_newer_longer_record_loads_as_prefix);
+  RUN_TEST(test_corrupt_blob_falls_back_to_defaults);
+  RUN_TEST(test_legacy_keys_migrate_to_blob);
+  RUN_TEST(test_out_of_range_values_are_clamped);
+  RUN_TEST(test_legacy_ints_are_checked_before_narrowing);
+  return UNITY_END();
+}
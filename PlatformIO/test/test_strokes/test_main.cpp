@@ -0,0 +1,128 @@
+/*
+  Useless Boxes - Stroke timing and stall watchdog tests (env:native)
+  -------------------------
+  Times simulated strokes into the per-direction stats, checks that a jammed
+  arm has EN1 cut at the default and at the learned timeout, that the fault
+  clears on the next input change, and that the stats reach NVS and the
+  motor_stats cloud property.
+  -------------------------
+*/
+#include <unity.h>
+#include "stroke_stats.h"
+#include "sim_harness.h"
+
+namespace {
+  // A full cycle: forward for `forwardMs`, back for `reverseMs`
+  void runCycle(unsigned long forwardMs, unsigned long reverseMs) {
+    sim::startForwardStroke(true);
+    sim::runFor(forwardMs);
+    fake::setInput(SWITCH_PIN, LOW);
+    sim::runFor(reverseMs);
+    fake::setInput(LIMIT_PIN, HIGH);
+    sim::runFor(50);
+    fake::cloudWrite(active_box, "NONE");  // TREVOR releases, so its next claim is a new value
+    sim::runFor(20);
+  }
+
+  bool enableCut() {
+    return fake::ledcPinChannel(EN1) == -1 && fake::pinLevel(EN1) == LOW;
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  sim::settleAtRest();
+  fake::cloudWrite(active_box, "NONE");
+  sim::runFor(20);
+  fake::serialInput("strokes reset\n");
+  sim::runFor(10);
+  fake::serialOutput().clear();
+}
+
+void tearDown() {}
+
+void test_welford_matches_direct_mean_and_variance() {
+  StrokeStats stats;
+  stats.reset();
+  const uint32_t samples[] = { 400, 420, 380, 410, 390 };
+  for (uint32_t ms : samples) stats.record(ms);
+  TEST_ASSERT_EQUAL_UINT32(5, stats.count);
+  TEST_ASSERT_TRUE(stats.meanMs > 399.9f && stats.meanMs < 400.1f);
+  TEST_ASSERT_TRUE(stats.variance() > 249.9f && stats.variance() < 250.1f); // 1000 / 4
+}
+
+void test_strokes_are_timed_per_direction() {
+  runCycle(400, 300);
+  runCycle(400, 300);
+  fake::serialInput("strokes\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("fwd n=2 mean=40"));
+  // The return stroke starts once the switch-off has settled
+  char reverse[32];
+  snprintf(reverse, sizeof(reverse), "rev n=2 mean=%lu", 300 - SWITCH_DEBOUNCE_TIME);
+  TEST_ASSERT_TRUE(sim::outputContains(reverse));
+}
+
+void test_jammed_arm_is_cut_at_default_timeout() {
+  sim::startForwardStroke(true);
+  sim::runFor(STROKE_STALL_DEFAULT_MS - 100);
+  TEST_ASSERT_FALSE(motorStallFault());
+  sim::runFor(200);
+  TEST_ASSERT_TRUE(motorStallFault());
+  TEST_ASSERT_TRUE(enableCut());
+  TEST_ASSERT_TRUE(sim::outputContains("Motor stall: forward stroke"));
+  sim::runFor(1000);
+  TEST_ASSERT_TRUE(enableCut()); // stays off until the inputs change
+}
+
+void test_learned_strokes_tighten_the_timeout() {
+  for (int i = 0; i < STROKE_STALL_MIN_SAMPLES; i++) runCycle(400, 300);
+  uint32_t timeout = strokeStallTimeoutMs(1);
+  TEST_ASSERT_LESS_THAN(STROKE_STALL_DEFAULT_MS, timeout);
+  TEST_ASSERT_GREATER_OR_EQUAL(STROKE_STALL_MIN_MS, timeout);
+
+  sim::startForwardStroke(true);
+  sim::runFor(timeout + 50);
+  TEST_ASSERT_TRUE(motorStallFault());
+  TEST_ASSERT_TRUE(enableCut());
+}
+
+void test_input_change_clears_fault_and_retries() {
+  sim::startForwardStroke(true);
+  sim::runFor(STROKE_STALL_DEFAULT_MS + 100);
+  TEST_ASSERT_TRUE(motorStallFault());
+  fake::setInput(SWITCH_PIN, LOW); // user frees the arm and flips the switch
+  sim::runFor(60);
+  TEST_ASSERT_FALSE(motorStallFault());
+  TEST_ASSERT_EQUAL_INT(HIGH, fake::pinLevel(IN2));  // return stroke running
+  TEST_ASSERT_FALSE(enableCut());
+}
+
+void test_stats_survive_reboot_after_save() {
+  runCycle(400, 300);
+  sim::runFor(STROKE_STATS_SAVE_INTERVAL_MS + 100);
+  sim::boot();
+  fake::serialInput("strokes\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("fwd n=1 mean=40"));
+}
+
+void test_telemetry_published_to_cloud() {
+  runCycle(400, 300);
+  TEST_ASSERT_TRUE(strstr(motor_stats.c_str(), "fwd n=1") != nullptr);
+  TEST_ASSERT_TRUE(strstr(motor_stats.c_str(), "rev n=1") != nullptr);
+  TEST_ASSERT_TRUE(strstr(motor_stats.c_str(), "FAULT") == nullptr);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_welford_matches_direct_mean_and_variance);
+  RUN_TEST(test_strokes_are_timed_per_direction);
+  RUN_TEST(test_jammed_arm_is_cut_at_default_timeout);
+  RUN_TEST(test_learned_strokes_tighten_the_timeout);
+  RUN_TEST(test_input_change_clears_fault_and_retries);
+  RUN_TEST(test_stats_survive_reboot_after_save);
+  RUN_TEST(test_telemetry_published_to_cloud);
+  return UNITY_END();
+}
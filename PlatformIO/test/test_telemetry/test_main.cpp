@@ -0,0 +1,343 @@
+/*
+  Useless Boxes - Telemetry event log tests (env:native)
+  -------------------------
+  Events land in the RAM ring from the switch, motor and claim paths and
+  leave as base64 "t2:<seq>:<wall>:<ms>:" (or "t1:<seq>:") batches in the
+  `telemetry` property. These tests decode what the box published, and
+  check the full-ring drop count, the offline NVS spill, that spilled
+  batches go out first, even after a reset, and that no batch is lost
+  when the link drops before it went out.
+  -------------------------
+*/
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "sim_harness.h"
+#include "telemetry.h"
+#include <Preferences.h>
+
+namespace {
+  struct Batch {
+    uint32_t seq = 0;
+    uint32_t baseMs = 0;
+    uint32_t dropped = 0;
+    uint64_t wallMs = 0;     // "t2:" clock pair; 0 for "t1:"
+    uint32_t clockMs = 0;
+    std::vector<TelemetryEvent> events;
+  };
+
+  bool readVarint(const std::vector<uint8_t>& in, size_t& pos, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; pos < in.size(); shift += 7) {
+      uint8_t byte = in[pos++];
+      value |= (uint32_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) return true;
+    }
+    return false;
+  }
+
+  Batch decodeBytes(const std::vector<uint8_t>& bytes) {
+    Batch batch;
+    size_t pos = 0;
+    TEST_ASSERT_TRUE(readVarint(bytes, pos, batch.seq));
+    TEST_ASSERT_TRUE(readVarint(bytes, pos, batch.baseMs));
+    TEST_ASSERT_TRUE(readVarint(bytes, pos, batch.dropped));
+    uint32_t at = batch.baseMs;
+    while (pos < bytes.size()) {
+      uint32_t delta, value;
+      TEST_ASSERT_TRUE(readVarint(bytes, pos, delta));
+      TEST_ASSERT_TRUE(pos + 2 <= bytes.size());
+      TelemetryEvent event;
+      at += delta;
+      event.atMs = at;
+      event.type = bytes[pos++];
+      event.aux = bytes[pos++];
+      TEST_ASSERT_TRUE(readVarint(bytes, pos, value));
+      event.value = (uint16_t)value;
+      batch.events.push_back(event);
+    }
+    return batch;
+  }
+
+  // Decodes the `telemetry` text the way the fleet side would
+  Batch published() {
+    std::string text = telemetry.c_str();
+    bool clocked = text.compare(0, 3, "t2:") == 0;
+    TEST_ASSERT_TRUE(clocked || text.compare(0, 3, "t1:") == 0);
+    size_t colon = text.find(':', 3);
+    TEST_ASSERT_TRUE(colon != std::string::npos);
+    uint64_t wallMs = 0;
+    uint32_t clockMs = 0;
+    if (clocked) {
+      char* end = nullptr;
+      wallMs = strtoull(text.c_str() + colon + 1, &end, 10);
+      TEST_ASSERT_EQUAL_INT(':', *end);
+      clockMs = strtoul(end + 1, &end, 10);
+      TEST_ASSERT_EQUAL_INT(':', *end);
+      colon = end - text.c_str();
+    }
+    static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::vector<uint8_t> bytes;
+    uint32_t group = 0;
+    int bits = 0;
+    for (size_t i = colon + 1; i < text.size() && text[i] != '='; i++) {
+      size_t sextet = alphabet.find(text[i]);
+      TEST_ASSERT_TRUE(sextet != std::string::npos);
+      group = (group << 6) | (uint32_t)sextet;
+      bits += 6;
+      if (bits >= 8) {
+        bits -= 8;
+        bytes.push_back((uint8_t)(group >> bits));
+      }
+    }
+    Batch batch = decodeBytes(bytes);
+    TEST_ASSERT_EQUAL_UINT32(strtoul(text.c_str() + 3, nullptr, 10), batch.seq);
+    batch.wallMs = wallMs;
+    batch.clockMs = clockMs;
+    return batch;
+  }
+
+  int countType(const Batch& batch, uint8_t type) {
+    int count = 0;
+    for (const TelemetryEvent& event : batch.events) count += event.type == type;
+    return count;
+  }
+
+  const TelemetryEvent* findType(const Batch& batch, uint8_t type) {
+    for (const TelemetryEvent& event : batch.events) {
+      if (event.type == type) return &event;
+    }
+    return nullptr;
+  }
+
+  void flush() {
+    fake::serialInput("telemetry flush\n");
+    sim::runFor(TELEMETRY_DRAIN_GAP_MS);  // exactly one batch
+  }
+}
+
+void setUp() {
+  fake::clearPreferences();
+  sim::boot();
+  fake::setInput(SWITCH_PIN, LOW);
+  fake::setInput(LIMIT_PIN, HIGH);
+  sim::runFor(100);
+}
+
+void tearDown() {}
+
+void test_encoder_packs_deltas() {
+  TelemetryEvent events[3] = {
+    { 1000, 0, TELEM_SWITCH, 1 },
+    { 1012, 100, TELEM_MOTOR_START, 1 },
+    { 1900, 880, TELEM_STROKE, 1 },
+  };
+  uint8_t out[TELEMETRY_BATCH_MAX_BYTES];
+  size_t taken = 0;
+  size_t len = encodeTelemetryBatch(out, sizeof(out), 7, 2, events, 3, &taken);
+  TEST_ASSERT_EQUAL_UINT(3, taken);
+  // header 1+2+1, then (1+1+1+1) + (1+1+1+1) + (2+1+1+2)
+  TEST_ASSERT_EQUAL_UINT(4 + 4 + 4 + 6, len);
+  Batch batch = decodeBytes(std::vector<uint8_t>(out, out + len));
+  TEST_ASSERT_EQUAL_UINT32(7, batch.seq);
+  TEST_ASSERT_EQUAL_UINT32(2, batch.dropped);
+  TEST_ASSERT_EQUAL_UINT(3, batch.events.size());
+  TEST_ASSERT_EQUAL_UINT32(1012, batch.events[1].atMs);
+  TEST_ASSERT_EQUAL_UINT32(1900, batch.events[2].atMs);
+  TEST_ASSERT_EQUAL_INT(880, batch.events[2].value);
+}
+
+void test_encoder_stops_at_whole_events() {
+  TelemetryEvent events[4] = {
+    { 5, 1, TELEM_SWITCH, 1 }, { 6, 1, TELEM_SWITCH, 0 }, { 7, 1, TELEM_SWITCH, 1 }, { 8, 1, TELEM_SWITCH, 0 },
+  };
+  uint8_t out[12];
+  size_t taken = 0;
+  size_t len = encodeTelemetryBatch(out, sizeof(out), 0, 0, events, 4, &taken);
+  TEST_ASSERT_EQUAL_UINT(2, taken);     // 3-byte header + 4 bytes each
+  TEST_ASSERT_EQUAL_UINT(11, len);
+}
+
+void test_flip_is_logged_and_uploaded_in_one_batch() {
+  fake::setInput(SWITCH_PIN, HIGH);          // claim
+  sim::runFor(500);
+  fake::cloudWrite(active_box, "TREVOR");   // another box claims: arrival, then a forward stroke
+  sim::runFor(2000);
+  fake::setInput(SWITCH_PIN, LOW);
+  sim::runFor(500);
+  unsigned long before = millis();
+  sim::runFor(TELEMETRY_UPLOAD_INTERVAL_MS);
+  TEST_ASSERT_TRUE(millis() - before >= TELEMETRY_UPLOAD_INTERVAL_MS);
+
+  Batch batch = published();
+  TEST_ASSERT_EQUAL_INT(2, countType(batch, TELEM_SWITCH));
+  TEST_ASSERT_EQUAL_INT(1, findType(batch, TELEM_SWITCH)->aux);
+  TEST_ASSERT_TRUE(countType(batch, TELEM_CLAIM_PUBLISH) >= 1);
+  const TelemetryEvent* arrival = nullptr;
+  for (const TelemetryEvent& event : batch.events) {
+    if (event.type == TELEM_CLAIM_ARRIVAL && event.aux == findBoxId("TREVOR")) arrival = &event;
+  }
+  TEST_ASSERT_NOT_NULL(arrival);
+  TEST_ASSERT_EQUAL_INT(ACTIVE_SOURCE_CLOUD, arrival->value);
+  const TelemetryEvent* start = findType(batch, TELEM_MOTOR_START);
+  TEST_ASSERT_NOT_NULL(start);
+  TEST_ASSERT_EQUAL_INT(1, start->aux);
+  TEST_ASSERT_EQUAL_INT(motorSpeed, start->value);
+  TEST_ASSERT_EQUAL_INT(0, telemetryPending());
+  // Clock pair: the fleet side maps the events' millis() stamps to wall time
+  TEST_ASSERT_TRUE(batch.wallMs > 0);
+  TEST_ASSERT_TRUE(batch.clockMs >= batch.events.back().atMs);
+  TEST_ASSERT_TRUE(batch.clockMs <= millis());
+}
+
+void test_full_ring_drops_and_reports_count() {
+  flush();  // start from an empty ring
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS);   // that batch is confirmed and leaves the ring
+  for (size_t i = 0; i < TELEMETRY_RING_CAPACITY + 5; i++) telemetryRecord(TELEM_SWITCH, 1);
+  TEST_ASSERT_EQUAL_UINT(TELEMETRY_RING_CAPACITY, telemetryPending());
+  flush();
+  Batch batch = published();
+  TEST_ASSERT_EQUAL_UINT32(5, batch.dropped);
+  TEST_ASSERT_EQUAL_UINT((TELEMETRY_BATCH_MAX_BYTES - 4) / 4, batch.events.size());  // 4-byte header and events
+  sim::runFor((TELEMETRY_RING_CAPACITY / TELEMETRY_BATCH_MAX_EVENTS + 1) * TELEMETRY_DRAIN_GAP_MS);
+  TEST_ASSERT_EQUAL_UINT(0, telemetryPending());    // drained one batch per gap, the last one confirmed
+  TEST_ASSERT_EQUAL_UINT32(0, published().dropped);
+}
+
+void test_offline_spill_goes_out_first() {
+  fake::setCloudConnected(false);
+  sim::runFor(100);
+  for (size_t i = 0; i < TELEMETRY_SPILL_THRESHOLD; i++) telemetryRecord(TELEM_STROKE, 1, (uint16_t)i);
+  uint32_t writes = Preferences::writeCount();
+  size_t before = telemetryPending();
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS + 10);
+  TEST_ASSERT_EQUAL_UINT32(writes + 1, Preferences::writeCount());
+  size_t spilledEvents = before - telemetryPending();
+  TEST_ASSERT_TRUE(spilledEvents > 0);
+  sim::runFor(10 * TELEMETRY_DRAIN_GAP_MS);
+  TEST_ASSERT_EQUAL_UINT32(writes + 1, Preferences::writeCount());  // below the threshold now
+
+  fake::setCloudConnected(true);
+  sim::runFor(100);
+  Batch batch = published();
+  TEST_ASSERT_EQUAL_UINT32(0, batch.seq);
+  TEST_ASSERT_EQUAL_UINT(spilledEvents, batch.events.size());
+  TEST_ASSERT_EQUAL_INT(1, countType(batch, TELEM_CLOUD_CONNECT));      // boot
+  TEST_ASSERT_EQUAL_INT(1, countType(batch, TELEM_CLOUD_DISCONNECT));
+  TEST_ASSERT_EQUAL_INT(0, findType(batch, TELEM_STROKE)->value);       // first recorded stroke
+  fake::serialOutput().clear();
+  fake::serialInput("telemetry\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("1 uploaded, 1 spilled (1 in NVS, 0 overwritten), next seq 1"));
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS);   // the update has gone out: the slot is freed
+  TEST_ASSERT_EQUAL_UINT32(writes + 2, Preferences::writeCount());
+  fake::serialInput("telemetry\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("1 uploaded, 1 spilled (0 in NVS, 0 overwritten), next seq 1"));
+}
+
+void test_spill_survives_reset_and_overwrites_oldest() {
+  fake::setCloudConnected(false);
+  sim::runFor(100);
+  for (int batch = 0; batch < TELEMETRY_SPILL_SLOTS + 2; batch++) {
+    while (telemetryPending() < TELEMETRY_SPILL_THRESHOLD) telemetryRecord(TELEM_SWITCH, 0);
+    sim::runFor(TELEMETRY_DRAIN_GAP_MS + 10);
+  }
+  TEST_ASSERT_TRUE(sim::outputContains("Telemetry spill full"));
+
+  sim::boot();   // NVS kept; the ring is lost
+  TEST_ASSERT_TRUE(sim::outputContains("Telemetry: 8 spilled batches waiting for the cloud"));
+  sim::runFor(100);
+  TEST_ASSERT_EQUAL_UINT32(2, published().seq);   // 0 and 1 were overwritten
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS);
+  TEST_ASSERT_EQUAL_UINT32(3, published().seq);
+  fake::serialOutput().clear();
+  fake::serialInput("telemetry\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("(7 in NVS, 0 overwritten), next seq 10"));  // 3 is still in flight
+}
+
+// Published, then the connection dropped before the update went out
+void test_spilled_batch_is_kept_until_it_went_out() {
+  fake::setCloudConnected(false);
+  sim::runFor(100);
+  while (telemetryPending() < TELEMETRY_SPILL_THRESHOLD) telemetryRecord(TELEM_SWITCH, 0);
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS + 10);
+  fake::setCloudConnected(true);
+  sim::runFor(100);
+  TEST_ASSERT_EQUAL_UINT32(0, published().seq);
+  TEST_ASSERT_TRUE(published().wallMs > 0);
+  fake::setCloudConnected(false);
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS + 10);
+
+  telemetry = "";
+  sim::boot();
+  TEST_ASSERT_TRUE(sim::outputContains("Telemetry: 1 spilled batches waiting for the cloud"));
+  sim::runFor(100);
+  Batch batch = published();
+  TEST_ASSERT_EQUAL_UINT32(0, batch.seq);      // sent again
+  TEST_ASSERT_TRUE(batch.wallMs == 0);   // "t1:": its stamps are from the previous boot
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS + 10);
+  fake::serialOutput().clear();
+  fake::serialInput("telemetry\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("(0 in NVS, 0 overwritten)"));
+}
+
+// Published from the ring, then the connection dropped before the update went out
+void test_ring_batch_is_kept_until_it_went_out() {
+  telemetryRecord(TELEM_STROKE, 1, 42);
+  flush();
+  Batch first = published();
+  TEST_ASSERT_NOT_NULL(findType(first, TELEM_STROKE));
+  fake::setCloudConnected(false);   // before the gap that confirms it
+  sim::runFor(100);
+  fake::serialOutput().clear();
+  fake::serialInput("telemetry\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("(1 in NVS, 0 overwritten)"));   // off the ring, kept in NVS
+
+  telemetry = "";
+  fake::setCloudConnected(true);
+  sim::runFor(100);
+  Batch again = published();
+  TEST_ASSERT_EQUAL_UINT32(first.seq, again.seq);   // the same batch: a duplicate, never a gap
+  TEST_ASSERT_EQUAL_UINT(first.events.size(), again.events.size());
+  TEST_ASSERT_EQUAL_INT(42, findType(again, TELEM_STROKE)->value);
+  TEST_ASSERT_EQUAL_INT(0, countType(again, TELEM_CLOUD_DISCONNECT));
+  sim::runFor(TELEMETRY_DRAIN_GAP_MS + 10);
+  fake::serialOutput().clear();
+  fake::serialInput("telemetry\n");
+  sim::runFor(10);
+  TEST_ASSERT_TRUE(sim::outputContains("(0 in NVS, 0 overwritten)"));
+}
+
+void test_reconnect_is_recorded() {
+  fake::setCloudConnected(false);
+  sim::runFor(3000);
+  fake::setCloudConnected(true);
+  sim::runFor(100);
+  flush();
+  Batch batch = published();
+  const TelemetryEvent* connect = nullptr;
+  for (const TelemetryEvent& event : batch.events) {
+    if (event.type == TELEM_CLOUD_CONNECT) connect = &event;   // the last one: after the outage
+  }
+  TEST_ASSERT_NOT_NULL(connect);
+  TEST_ASSERT_EQUAL_INT(3, connect->value);
+  TEST_ASSERT_EQUAL_INT(1, countType(batch, TELEM_CLOUD_DISCONNECT));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_encoder_packs_deltas);
+  RUN_TEST(test_encoder_stops_at_whole_events);
+  RUN_TEST(test_flip_is_logged_and_uploaded_in_one_batch);
+  RUN_TEST(test_full_ring_drops_and_reports_count);
+  RUN_TEST(test_offline_spill_goes_out_first);
+  RUN_TEST(test_spill_survives_reset_and_overwrites_oldest);
+  RUN_TEST(test_spilled_batch_is_kept_until_it_went_out);
+  RUN_TEST(test_ring_batch_is_kept_until_it_went_out);
+  RUN_TEST(test_reconnect_is_recorded);
+  return UNITY_END();
+}